@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "access_bitmaps.h"
+#include "profiling.h"
+
+#define ROARING_ARRAY_MAX 4096 // larger containers switch to a 2^16-bit bitmap
+#define ACCESS_MATRIX_QUERY "match $s isa subject, has id $sid; $p($s, $pa) isa permission; $pa($o, $a) isa access; $o has path $fp; $a has name $an; get $sid, $fp, $an;"
+
+static void roaringContainerFree(RoaringContainer* c) {
+    free(c->values);
+    free(c->bits);
+    c->values = NULL;
+    c->bits = NULL;
+}
+
+void roaringFree(Roaring* r) {
+    for (size_t i = 0; i < r->count; i++) roaringContainerFree(&r->containers[i]);
+    free(r->containers);
+    memset(r, 0, sizeof(Roaring));
+}
+
+// Returns the index of the container with the key, or -(insertion point) - 1.
+static long roaringFind(const Roaring* r, uint16_t key) {
+    long low = 0, high = (long)r->count - 1;
+    while (low <= high) {
+        long mid = (low + high) / 2;
+        if (r->containers[mid].key == key) return mid;
+        if (r->containers[mid].key < key) low = mid + 1;
+        else high = mid - 1;
+    }
+    return -low - 1;
+}
+
+// Appends a container; containers must arrive in key order. Empty containers are dropped.
+static void roaringAppend(Roaring* r, RoaringContainer c) {
+    if (c.cardinality == 0) {
+        roaringContainerFree(&c);
+        return;
+    }
+    if (r->count == r->capacity) {
+        r->capacity = r->capacity ? r->capacity * 2 : 4;
+        r->containers = realloc(r->containers, r->capacity * sizeof(RoaringContainer));
+    }
+    r->containers[r->count++] = c;
+}
+
+// Turns a bitmap container back into an array when that is smaller.
+static RoaringContainer roaringFromBits(uint16_t key, uint64_t* bits) {
+    RoaringContainer c = { key, 0, 0, NULL, bits };
+    for (int w = 0; w < ROARING_BITMAP_WORDS; w++) c.cardinality += __builtin_popcountll(bits[w]);
+    if (c.cardinality > ROARING_ARRAY_MAX) return c;
+    c.values = malloc((c.cardinality ? c.cardinality : 1) * sizeof(uint16_t));
+    c.capacity = c.cardinality;
+    uint32_t n = 0;
+    for (int w = 0; w < ROARING_BITMAP_WORDS; w++) {
+        for (uint64_t word = bits[w]; word; word &= word - 1) c.values[n++] = (uint16_t)(w * 64 + __builtin_ctzll(word));
+    }
+    free(bits);
+    c.bits = NULL;
+    return c;
+}
+
+static uint64_t* roaringToBits(const RoaringContainer* c) {
+    uint64_t* bits = calloc(ROARING_BITMAP_WORDS, sizeof(uint64_t));
+    if (c->bits) memcpy(bits, c->bits, ROARING_BITMAP_WORDS * sizeof(uint64_t));
+    else for (uint32_t i = 0; i < c->cardinality; i++) bits[c->values[i] >> 6] |= 1ull << (c->values[i] & 63);
+    return bits;
+}
+
+static bool roaringContainerContains(const RoaringContainer* c, uint16_t low) {
+    if (c->bits) return (c->bits[low >> 6] >> (low & 63)) & 1;
+    uint32_t lo = 0, hi = c->cardinality;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (c->values[mid] < low) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < c->cardinality && c->values[lo] == low;
+}
+
+bool roaringContains(const Roaring* r, uint32_t id) {
+    long at = roaringFind(r, (uint16_t)(id >> 16));
+    return at >= 0 && roaringContainerContains(&r->containers[at], (uint16_t)id);
+}
+
+void roaringAdd(Roaring* r, uint32_t id) {
+    uint16_t key = (uint16_t)(id >> 16), low = (uint16_t)id;
+    long at = roaringFind(r, key);
+    if (at < 0) {
+        at = -at - 1;
+        roaringAppend(r, (RoaringContainer){ key, 1, 1, malloc(sizeof(uint16_t)), NULL });
+        r->containers[r->count - 1].values[0] = low;
+        RoaringContainer added = r->containers[r->count - 1];
+        memmove(&r->containers[at + 1], &r->containers[at], (r->count - 1 - at) * sizeof(RoaringContainer));
+        r->containers[at] = added;
+        return;
+    }
+    RoaringContainer* c = &r->containers[at];
+    if (roaringContainerContains(c, low)) return;
+    if (c->bits) {
+        c->bits[low >> 6] |= 1ull << (low & 63);
+        c->cardinality++;
+        return;
+    }
+    if (c->cardinality == ROARING_ARRAY_MAX) {
+        c->bits = roaringToBits(c);
+        free(c->values);
+        c->values = NULL;
+        c->capacity = 0;
+        c->bits[low >> 6] |= 1ull << (low & 63);
+        c->cardinality++;
+        return;
+    }
+    if (c->cardinality == c->capacity) {
+        c->capacity = c->capacity * 2 < ROARING_ARRAY_MAX ? c->capacity * 2 : ROARING_ARRAY_MAX;
+        c->values = realloc(c->values, c->capacity * sizeof(uint16_t));
+    }
+    uint32_t i = c->cardinality;
+    while (i > 0 && c->values[i - 1] > low) {
+        c->values[i] = c->values[i - 1];
+        i--;
+    }
+    c->values[i] = low;
+    c->cardinality++;
+}
+
+uint64_t roaringCardinality(const Roaring* r) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < r->count; i++) total += r->containers[i].cardinality;
+    return total;
+}
+
+size_t roaringMemory(const Roaring* r) {
+    size_t bytes = sizeof(Roaring) + r->capacity * sizeof(RoaringContainer);
+    for (size_t i = 0; i < r->count; i++) {
+        const RoaringContainer* c = &r->containers[i];
+        bytes += c->bits ? ROARING_BITMAP_WORDS * sizeof(uint64_t) : c->capacity * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+static RoaringContainer roaringContainerOp(const RoaringContainer* a, const RoaringContainer* b, RoaringOp op) {
+    if (a->bits || b->bits) {
+        uint64_t* bits = roaringToBits(a);
+        uint64_t* other = b->bits ? b->bits : roaringToBits(b);
+        for (int w = 0; w < ROARING_BITMAP_WORDS; w++) {
+            if (op == ROARING_AND) bits[w] &= other[w];
+            else if (op == ROARING_OR) bits[w] |= other[w];
+            else bits[w] &= ~other[w];
+        }
+        if (!b->bits) free(other);
+        return roaringFromBits(a->key, bits);
+    }
+    // Two arrays: a sorted merge.
+    uint32_t limit = op == ROARING_OR ? a->cardinality + b->cardinality : a->cardinality;
+    RoaringContainer c = { a->key, 0, limit ? limit : 1, NULL, NULL };
+    c.values = malloc(c.capacity * sizeof(uint16_t));
+    uint32_t i = 0, j = 0;
+    while (i < a->cardinality || j < b->cardinality) {
+        bool takeA = j == b->cardinality || (i < a->cardinality && a->values[i] < b->values[j]);
+        bool takeB = i == a->cardinality || (j < b->cardinality && b->values[j] < a->values[i]);
+        if (takeA) {
+            if (op != ROARING_AND) c.values[c.cardinality++] = a->values[i];
+            i++;
+        } else if (takeB) {
+            if (op == ROARING_OR) c.values[c.cardinality++] = b->values[j];
+            j++;
+        } else {
+            if (op != ROARING_ANDNOT) c.values[c.cardinality++] = a->values[i];
+            i++;
+            j++;
+        }
+    }
+    if (c.cardinality > ROARING_ARRAY_MAX) {
+        uint64_t* bits = roaringToBits(&c);
+        free(c.values);
+        return (RoaringContainer){ c.key, c.cardinality, 0, NULL, bits };
+    }
+    return c;
+}
+
+static RoaringContainer roaringContainerCopy(const RoaringContainer* c) {
+    RoaringContainer copy = *c;
+    if (c->bits) {
+        copy.bits = malloc(ROARING_BITMAP_WORDS * sizeof(uint64_t));
+        memcpy(copy.bits, c->bits, ROARING_BITMAP_WORDS * sizeof(uint64_t));
+    } else {
+        copy.capacity = c->cardinality ? c->cardinality : 1;
+        copy.values = malloc(copy.capacity * sizeof(uint16_t));
+        memcpy(copy.values, c->values, c->cardinality * sizeof(uint16_t));
+    }
+    return copy;
+}
+
+// out = a op b; out must be empty and distinct from the inputs.
+static void roaringCombine(const Roaring* a, const Roaring* b, Roaring* out, RoaringOp op) {
+    size_t i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        if (j == b->count || (i < a->count && a->containers[i].key < b->containers[j].key)) {
+            if (op != ROARING_AND) roaringAppend(out, roaringContainerCopy(&a->containers[i]));
+            i++;
+        } else if (i == a->count || b->containers[j].key < a->containers[i].key) {
+            if (op == ROARING_OR) roaringAppend(out, roaringContainerCopy(&b->containers[j]));
+            j++;
+        } else {
+            roaringAppend(out, roaringContainerOp(&a->containers[i], &b->containers[j], op));
+            i++;
+            j++;
+        }
+    }
+}
+
+// Cardinality of a AND b without materialising the result.
+uint64_t roaringAndCardinality(const Roaring* a, const Roaring* b) {
+    uint64_t total = 0;
+    for (size_t i = 0, j = 0; i < a->count && j < b->count;) {
+        const RoaringContainer* x = &a->containers[i];
+        const RoaringContainer* y = &b->containers[j];
+        if (x->key < y->key) i++;
+        else if (y->key < x->key) j++;
+        else {
+            if (x->bits && y->bits) {
+                for (int w = 0; w < ROARING_BITMAP_WORDS; w++) total += __builtin_popcountll(x->bits[w] & y->bits[w]);
+            } else {
+                const RoaringContainer* small = x->bits ? y : x;
+                const RoaringContainer* large = x->bits ? x : y;
+                for (uint32_t k = 0; k < small->cardinality; k++) total += roaringContainerContains(large, small->values[k]);
+            }
+            i++;
+            j++;
+        }
+    }
+    return total;
+}
+
+void roaringForEach(const Roaring* r, void (*visit)(uint32_t id, void* context), void* context) {
+    for (size_t i = 0; i < r->count; i++) {
+        const RoaringContainer* c = &r->containers[i];
+        uint32_t high = (uint32_t)c->key << 16;
+        if (!c->bits) {
+            for (uint32_t k = 0; k < c->cardinality; k++) visit(high | c->values[k], context);
+            continue;
+        }
+        for (int w = 0; w < ROARING_BITMAP_WORDS; w++) {
+            for (uint64_t word = c->bits[w]; word; word &= word - 1) visit(high | (uint32_t)(w * 64 + __builtin_ctzll(word)), context);
+        }
+    }
+}
+
+static uint32_t accessMatrixObjectId(AccessMatrix* matrix, const char* path) {
+    uintptr_t id = (uintptr_t)stringMapGet(&matrix->objectIds, path);
+    if (id != 0) return (uint32_t)(id - 1);
+    if (matrix->objectCount == matrix->objectCapacity) {
+        matrix->objectCapacity = matrix->objectCapacity ? matrix->objectCapacity * 2 : 1024;
+        matrix->paths = realloc(matrix->paths, matrix->objectCapacity * sizeof(char*));
+    }
+    matrix->paths[matrix->objectCount] = strdup(path);
+    stringMapPut(&matrix->objectIds, path, (void*)(uintptr_t)(matrix->objectCount + 1));
+    return (uint32_t)matrix->objectCount++;
+}
+
+// Returns NULL when the pair has no bitmap and create is off, or when its key does not fit; such a pair
+// can never have been added, so treating it as empty is correct.
+static Roaring* accessMatrixBitmap(AccessMatrix* matrix, const char* subject, const char* action, bool create) {
+    char key[512];
+    int written = snprintf(key, sizeof(key), "%s\t%s", subject, action);
+    if (written < 0 || (size_t)written >= sizeof(key)) return NULL;
+    Roaring* bitmap = stringMapGet(&matrix->bitmaps, key);
+    if (bitmap == NULL && create) {
+        bitmap = calloc(1, sizeof(Roaring));
+        stringMapPut(&matrix->bitmaps, key, bitmap);
+    }
+    return bitmap;
+}
+
+void accessMatrixInit(AccessMatrix* matrix) {
+    memset(matrix, 0, sizeof(AccessMatrix));
+    stringMapInit(&matrix->objectIds, 1024);
+    stringMapInit(&matrix->bitmaps, 256);
+}
+
+// Returns false, adding nothing, if the subject and action are too long to key a bitmap.
+bool accessMatrixAdd(AccessMatrix* matrix, const char* subject, const char* action, const char* path) {
+    Roaring* bitmap = accessMatrixBitmap(matrix, subject, action, true);
+    if (bitmap == NULL) return false;
+    uint32_t id = accessMatrixObjectId(matrix, path);
+    if (roaringContains(bitmap, id)) return true;
+    roaringAdd(bitmap, id);
+    matrix->permissions++;
+    return true;
+}
+
+static void roaringDrop(void* value) {
+    roaringFree((Roaring*)value);
+    free(value);
+}
+
+void accessMatrixFree(AccessMatrix* matrix) {
+    for (size_t i = 0; i < matrix->objectCount; i++) free(matrix->paths[i]);
+    free(matrix->paths);
+    stringMapFree(&matrix->objectIds, NULL);
+    stringMapFree(&matrix->bitmaps, roaringDrop);
+}
+
+size_t accessMatrixMemory(const AccessMatrix* matrix) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < matrix->bitmaps.capacity; i++) {
+        if (matrix->bitmaps.keys[i] != NULL) bytes += roaringMemory(matrix->bitmaps.values[i]);
+    }
+    return bytes;
+}
+
+// Combines the object sets of two (subject, action) pairs, e.g. files viewable by A but not B with
+// ROARING_ANDNOT. Pairs without permissions act as empty sets. The caller frees the result.
+Roaring accessMatrixQuery(AccessMatrix* matrix, const char* subjectA, const char* actionA, const char* subjectB, const char* actionB, RoaringOp op) {
+    Roaring empty = {0}, result = {0};
+    Roaring* a = accessMatrixBitmap(matrix, subjectA, actionA, false);
+    Roaring* b = accessMatrixBitmap(matrix, subjectB, actionB, false);
+    roaringCombine(a ? a : &empty, b ? b : &empty, &result, op);
+    return result;
+}
+
+// Loads every (subject, action, object) permission in one read transaction.
+bool accessMatrixLoad(DatabaseManager* dbManager, const char* dbName, bool inference, AccessMatrix* matrix) {
+    Options* opts = options_new();
+    options_set_infer(opts, inference);
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(opts);
+        return false;
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        session_close(session);
+        options_drop(opts);
+        return false;
+    }
+    accessMatrixInit(matrix);
+    ConceptMapIterator* response = query_get(tx, ACCESS_MATRIX_QUERY, opts);
+    ConceptMap* cm = NULL;
+    const char* vars[] = { "sid", "an", "fp" };
+    char* values[3];
+    bool added = true;
+    while (added && response != NULL && (cm = concept_map_iterator_next(response)) != NULL) {
+        for (int v = 0; v < 3; v++) {
+            Concept* attribute = concept_map_get(cm, vars[v]);
+            Concept* value = attribute_get_value(attribute);
+            values[v] = value_get_string(value);
+            concept_drop(value);
+            concept_drop(attribute);
+        }
+        if (!(added = accessMatrixAdd(matrix, values[0], values[1], values[2]))) {
+            fprintf(stderr, "Subject %s and action %s are too long for the access matrix.\n", values[0], values[1]);
+        }
+        for (int v = 0; v < 3; v++) string_free(values[v]);
+        concept_map_drop(cm);
+    }
+    bool loaded = added && response != NULL && !FAILED();
+    if (!loaded) fprintf(stderr, "Failed to load permissions.\n");
+    concept_map_iterator_drop(response);
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+    return loaded;
+}
+
+// Fills a synthetic matrix: each subject can view a random share of the files, some densely clustered
+// (bitmap containers) and some sparse (array containers), then times set operations between subjects.
+void benchmarkAccessBitmaps(size_t files, int subjects) {
+    AccessMatrix matrix;
+    accessMatrixInit(&matrix);
+    char subject[32], path[32];
+    for (size_t f = 0; f < files; f++) {
+        snprintf(path, sizeof(path), "file%zu", f);
+        accessMatrixObjectId(&matrix, path);
+    }
+    unsigned int seed = 42;
+    double started = monotonicSeconds();
+    Roaring** bitmaps = malloc(subjects * sizeof(Roaring*));
+    for (int s = 0; s < subjects; s++) {
+        snprintf(subject, sizeof(subject), "subject%d", s);
+        bitmaps[s] = accessMatrixBitmap(&matrix, subject, "view_file", true);
+        double density = s % 4 == 0 ? 0.5 : 0.002 * (1 + s % 7);
+        for (size_t f = 0; f < files; f++) {
+            if (rand_r(&seed) < density * RAND_MAX) {
+                roaringAdd(bitmaps[s], (uint32_t)f);
+                matrix.permissions++;
+            }
+        }
+    }
+    double loadSeconds = monotonicSeconds() - started;
+    size_t bytes = accessMatrixMemory(&matrix);
+    printf("Access bitmap benchmark (%zu files, %d subjects)\n", files, subjects);
+    printf("  %zu permissions loaded in %.3f s, %zu bytes (%.2f bits per permission)\n",
+           matrix.permissions, loadSeconds, bytes, matrix.permissions ? 8.0 * bytes / matrix.permissions : 0.0);
+
+    const char* names[] = { "AND", "OR", "ANDNOT" };
+    for (int op = ROARING_AND; op <= ROARING_ANDNOT; op++) {
+        uint64_t total = 0;
+        size_t pairs = 0;
+        started = monotonicSeconds();
+        for (int a = 0; a < subjects; a++) {
+            for (int b = a + 1; b < subjects && b < a + 8; b++) {
+                Roaring result = {0};
+                roaringCombine(bitmaps[a], bitmaps[b], &result, (RoaringOp)op);
+                total += roaringCardinality(&result);
+                roaringFree(&result);
+                pairs++;
+            }
+        }
+        double seconds = monotonicSeconds() - started;
+        printf("  %-6s %zu pairs, %.1f us per query (%llu ids)\n", names[op], pairs, seconds / pairs * 1e6, (unsigned long long)total);
+    }
+    free(bitmaps);
+    accessMatrixFree(&matrix);
+}
@@ -0,0 +1,55 @@
+#ifndef TUTORIAL_ACCESS_BITMAPS_H
+#define TUTORIAL_ACCESS_BITMAPS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "string_map.h"
+
+#define ROARING_BITMAP_WORDS 1024
+
+// One chunk of 2^16 ids sharing the high 16 bits: a sorted array of low halves, or a bitmap.
+typedef struct {
+    uint16_t key;
+    uint32_t cardinality;
+    uint32_t capacity; // array capacity; unused for bitmaps
+    uint16_t* values;
+    uint64_t* bits;
+} RoaringContainer;
+
+// Roaring-style compressed bitmap over 32-bit ids, with containers sorted by key.
+typedef struct {
+    RoaringContainer* containers;
+    size_t count;
+    size_t capacity;
+} Roaring;
+
+typedef enum { ROARING_AND, ROARING_OR, ROARING_ANDNOT } RoaringOp;
+
+// Permissions as one bitmap of object ids per (subject id, action name). Object paths get dense ids in
+// load order.
+typedef struct {
+    StringMap objectIds; // path -> id + 1
+    char** paths;        // id -> path
+    size_t objectCount;
+    size_t objectCapacity;
+    StringMap bitmaps;   // "subject\taction" -> Roaring*
+    size_t permissions;
+} AccessMatrix;
+
+void roaringFree(Roaring* r);
+bool roaringContains(const Roaring* r, uint32_t id);
+void roaringAdd(Roaring* r, uint32_t id);
+uint64_t roaringCardinality(const Roaring* r);
+size_t roaringMemory(const Roaring* r);
+uint64_t roaringAndCardinality(const Roaring* a, const Roaring* b);
+void roaringForEach(const Roaring* r, void (*visit)(uint32_t id, void* context), void* context);
+void accessMatrixInit(AccessMatrix* matrix);
+bool accessMatrixAdd(AccessMatrix* matrix, const char* subject, const char* action, const char* path);
+void accessMatrixFree(AccessMatrix* matrix);
+size_t accessMatrixMemory(const AccessMatrix* matrix);
+Roaring accessMatrixQuery(AccessMatrix* matrix, const char* subjectA, const char* actionA, const char* subjectB, const char* actionB, RoaringOp op);
+bool accessMatrixLoad(DatabaseManager* dbManager, const char* dbName, bool inference, AccessMatrix* matrix);
+void benchmarkAccessBitmaps(size_t files, int subjects);
+
+#endif
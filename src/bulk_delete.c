@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "bulk_delete.h"
+#include "typeql_escape.h"
+#include "profiling.h"
+#include "write_listeners.h"
+
+#define BULK_DELETE_PAGE_SIZE 5000
+#define BULK_DELETE_TX_SIZE 500
+#define BULK_DELETE_SESSIONS 4
+
+typedef struct {
+    Session* session;
+    char** paths;
+    size_t count;
+    size_t txSize;
+    size_t deleted;
+    size_t failed;
+} DeleteWorker;
+
+// Counts and deletes the files with each path in the same transaction, so deleted reflects the files
+// that were actually there rather than the paths attempted.
+static void* deleteWorker(void* arg) {
+    DeleteWorker* worker = (DeleteWorker*)arg;
+    Options* opts = options_new();
+    ConceptPromise** counts = malloc(worker->txSize * sizeof(ConceptPromise*));
+    VoidPromise** promises = malloc(worker->txSize * sizeof(VoidPromise*));
+    long* matched = malloc(worker->txSize * sizeof(long));
+    size_t querySize = 1024;
+    char* query = malloc(querySize);
+    for (size_t start = 0; start < worker->count; start += worker->txSize) {
+        size_t end = start + worker->txSize < worker->count ? start + worker->txSize : worker->count;
+        Transaction* tx = transaction_new(worker->session, Write, opts);
+        if (tx == NULL || FAILED()) {
+            worker->failed += end - start;
+            continue;
+        }
+        for (size_t i = start; i < end; i++) {
+            char* path = escapeTypeQLCopy(worker->paths[i]);
+            if (strlen(path) + 64 > querySize) query = realloc(query, querySize = strlen(path) + 64);
+            snprintf(query, querySize, "match $f isa file, has path '%s'; get $f; count;", path);
+            counts[i - start] = query_get_aggregate(tx, query, opts);
+            snprintf(query, querySize, "match $f isa file, has path '%s'; delete $f isa file;", path);
+            promises[i - start] = query_delete(tx, query, opts);
+            free(path);
+        }
+        bool txFailed = false;
+        size_t deleted = 0;
+        for (size_t i = 0; i < end - start; i++) {
+            Concept* count = counts[i] != NULL ? concept_promise_resolve(counts[i]) : NULL;
+            if (count == NULL || FAILED()) txFailed = true;
+            matched[i] = count != NULL ? (long)value_get_long(count) : 0;
+            deleted += matched[i];
+            if (count != NULL) concept_drop(count);
+            if (promises[i] == NULL) txFailed = true;
+            else void_promise_resolve(promises[i]);
+            if (FAILED()) txFailed = true;
+        }
+        if (txFailed) {
+            transaction_close(tx);
+            worker->failed += end - start;
+            continue;
+        }
+        void_promise_resolve(transaction_commit(tx));
+        if (FAILED()) {
+            worker->failed += end - start;
+            continue;
+        }
+        for (size_t i = start; i < end; i++) {
+            if (matched[i - start] > 0) notifyFileDeleted(worker->paths[i]);
+        }
+        worker->deleted += deleted;
+    }
+    free(query);
+    free(matched);
+    free(promises);
+    free(counts);
+    options_drop(opts);
+    return NULL;
+}
+
+// Reads one page of matching paths, ordered by path and strictly after lastPath (keyset pagination).
+// regex must already be escaped for a `like` string.
+// Returns the number read, or -1 if the page could not be read.
+static long readDeletePage(Session* session, const char* regex, const char* lastPath, char** paths, size_t pageSize) {
+    Options* opts = options_new();
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        options_drop(opts);
+        return -1;
+    }
+    char* after = lastPath != NULL ? escapeTypeQLCopy(lastPath) : NULL;
+    size_t querySize = strlen(regex) + (after != NULL ? strlen(after) : 0) + 160;
+    char* query = malloc(querySize);
+    if (after == NULL) snprintf(query, querySize, "match $f isa file, has path $p; $p like '%s'; get $p; sort $p asc; limit %zu;", regex, pageSize);
+    else snprintf(query, querySize, "match $f isa file, has path $p; $p like '%s'; $p > '%s'; get $p; sort $p asc; limit %zu;", regex, after, pageSize);
+    ConceptMapIterator* response = query_get(tx, query, opts);
+    long count = 0;
+    ConceptMap* cm = NULL;
+    while (response != NULL && (cm = concept_map_iterator_next(response)) != NULL) {
+        Concept* pathConcept = concept_map_get(cm, "p");
+        Concept* pathValue = attribute_get_value(pathConcept);
+        char* path = value_get_string(pathValue);
+        paths[count++] = strdup(path);
+        string_free(path);
+        concept_drop(pathValue);
+        concept_drop(pathConcept);
+        concept_map_drop(cm);
+    }
+    if (response == NULL || FAILED()) {
+        fprintf(stderr, "Failed to read matching files.\n");
+        while (count > 0) free(paths[--count]);
+        count = -1;
+    }
+    concept_map_iterator_drop(response);
+    transaction_close(tx);
+    free(query);
+    free(after);
+    options_drop(opts);
+    return count;
+}
+
+// Deletes every file whose path matches the pattern: a literal prefix when isPrefix is set, a TypeQL
+// regex otherwise. Pages are split across parallel sessions and deleted in transactions of txSize files.
+BulkDeleteStats bulkDeleteFiles(DatabaseManager* dbManager, const char* dbName, const char* pattern, bool isPrefix, size_t pageSize, size_t txSize, int sessions) {
+    BulkDeleteStats stats = {0};
+    if (pageSize == 0 || txSize == 0 || sessions <= 0) {
+        fprintf(stderr, "Bulk delete needs a positive page size, transaction size and session count.\n");
+        return stats;
+    }
+    double started = monotonicSeconds();
+    char regex[512];
+    if (isPrefix ? !prefixToTypeQLRegex(pattern, regex, sizeof(regex)) : !escapeTypeQLRegex(pattern, regex, sizeof(regex))) {
+        fprintf(stderr, "Path %s is too long or malformed: %s\n", isPrefix ? "prefix" : "regex", pattern);
+        return stats;
+    }
+
+    Options* opts = options_new();
+    DeleteWorker* workers = calloc(sessions, sizeof(DeleteWorker));
+    pthread_t* threads = malloc(sessions * sizeof(pthread_t));
+    for (int w = 0; w < sessions; w++) {
+        workers[w].session = session_new(dbManager, dbName, Data, opts);
+        if (workers[w].session == NULL || FAILED()) {
+            fprintf(stderr, "Failed to open session.\n");
+            exit(EXIT_FAILURE);
+        }
+        workers[w].txSize = txSize;
+    }
+
+    char** page = malloc(pageSize * sizeof(char*));
+    char* lastPath = NULL;
+    long count = 0;
+    bool complete = true;
+    while ((count = readDeletePage(workers[0].session, regex, lastPath, page, pageSize)) > 0) {
+        size_t rows = (size_t)count;
+        size_t share = (rows + sessions - 1) / sessions;
+        for (int w = 0; w < sessions; w++) {
+            size_t from = w * share < rows ? w * share : rows;
+            workers[w].paths = page + from;
+            workers[w].count = from + share < rows ? share : rows - from;
+            pthread_create(&threads[w], NULL, deleteWorker, &workers[w]);
+        }
+        for (int w = 0; w < sessions; w++) pthread_join(threads[w], NULL);
+
+        free(lastPath);
+        lastPath = page[count - 1];
+        for (long i = 0; i + 1 < count; i++) free(page[i]);
+        stats.pages++;
+        stats.deleted = 0;
+        stats.failed = 0;
+        for (int w = 0; w < sessions; w++) {
+            stats.deleted += workers[w].deleted;
+            stats.failed += workers[w].failed;
+        }
+        double elapsed = monotonicSeconds() - started;
+        printf("Page %zu: %zu files deleted, %zu failed (%.0f files/s).\n", stats.pages, stats.deleted, stats.failed, elapsed > 0 ? stats.deleted / elapsed : 0.0);
+        if ((size_t)count < pageSize) break;
+    }
+    if (count < 0) {
+        fprintf(stderr, "Stopped after %zu pages: the next page of matching files could not be read.\n", stats.pages);
+        complete = false;
+    }
+    free(lastPath);
+    free(page);
+    for (int w = 0; w < sessions; w++) session_close(workers[w].session);
+    free(threads);
+    free(workers);
+    options_drop(opts);
+    stats.seconds = monotonicSeconds() - started;
+    printf("Bulk delete %s. Deleted: %zu, failed: %zu in %.2f s.\n", complete ? "complete" : "incomplete", stats.deleted, stats.failed, stats.seconds);
+    return stats;
+}
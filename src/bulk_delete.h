@@ -0,0 +1,16 @@
+#ifndef TUTORIAL_BULK_DELETE_H
+#define TUTORIAL_BULK_DELETE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t deleted;
+    size_t failed;
+    size_t pages;
+    double seconds;
+} BulkDeleteStats;
+
+BulkDeleteStats bulkDeleteFiles(DatabaseManager* dbManager, const char* dbName, const char* pattern, bool isPrefix, size_t pageSize, size_t txSize, int sessions);
+
+#endif
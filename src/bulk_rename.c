@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "bulk_rename.h"
+#include "typeql_escape.h"
+#include "profiling.h"
+#include "write_listeners.h"
+#include "string_map.h"
+
+#define BULK_RENAME_BATCH_SIZE 500
+#define BULK_RENAME_PARTITIONS 4
+#define BULK_RENAME_CHUNK_PER_PARTITION 16 // batches buffered per partition before dispatch
+
+typedef struct {
+    char* oldPath;
+    char* newPath;
+} PathRename;
+
+typedef struct {
+    DatabaseManager* dbManager;
+    const char* dbName;
+    PathRename* renames;
+    size_t count;
+    size_t capacity;
+    size_t batchSize;
+    BulkRenameStats stats;
+} RenamePartition;
+
+// Runs one partition's renames in its own session: each batch is a single write transaction in which
+// all match/delete/insert queries are dispatched before any answers are drained.
+static void* renamePartitionWorker(void* arg) {
+    RenamePartition* part = (RenamePartition*)arg;
+    Options* opts = options_new();
+    Session* session = session_new(part->dbManager, part->dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        part->stats.failed += part->count;
+        options_drop(opts);
+        return NULL;
+    }
+    ConceptMapIterator** responses = malloc(part->batchSize * sizeof(ConceptMapIterator*));
+    bool* matched = malloc(part->batchSize * sizeof(bool));
+    size_t querySize = 1024;
+    char* query = malloc(querySize);
+    for (size_t start = 0; start < part->count; start += part->batchSize) {
+        size_t end = start + part->batchSize < part->count ? start + part->batchSize : part->count;
+        Transaction* tx = transaction_new(session, Write, opts);
+        if (tx == NULL || FAILED()) {
+            fprintf(stderr, "Failed to start transaction.\n");
+            part->stats.failed += end - start;
+            continue;
+        }
+        bool batchFailed = false;
+        for (size_t i = start; i < end; i++) {
+            char* oldPath = escapeTypeQLCopy(part->renames[i].oldPath);
+            char* newPath = escapeTypeQLCopy(part->renames[i].newPath);
+            size_t needed = strlen(oldPath) + strlen(newPath) + 160;
+            if (needed > querySize) query = realloc(query, querySize = needed);
+            snprintf(query, querySize, "match $f isa file, has path $old_path; $old_path = '%s'; delete $f has $old_path; insert $f has path $new_path; $new_path = '%s';", oldPath, newPath);
+            free(oldPath);
+            free(newPath);
+            responses[i - start] = query_update(tx, query, opts);
+            if (responses[i - start] == NULL || FAILED()) batchFailed = true;
+        }
+        size_t renamed = 0;
+        size_t unmatched = 0;
+        for (size_t i = 0; i < end - start; i++) {
+            if (responses[i] == NULL) continue;
+            int count = 0;
+            ConceptMap* cm = NULL;
+            while ((cm = concept_map_iterator_next(responses[i])) != NULL) {
+                concept_map_drop(cm);
+                count++;
+            }
+            if (FAILED()) batchFailed = true;
+            concept_map_iterator_drop(responses[i]);
+            matched[i] = count > 0;
+            if (count > 0) renamed++;
+            else unmatched++;
+        }
+        if (batchFailed) {
+            transaction_close(tx);
+            part->stats.failed += end - start;
+            continue;
+        }
+        void_promise_resolve(transaction_commit(tx));
+        if (FAILED()) {
+            part->stats.failed += end - start;
+            continue;
+        }
+        for (size_t i = start; i < end; i++) {
+            if (matched[i - start]) notifyFilePathUpdated(part->renames[i].oldPath, part->renames[i].newPath);
+        }
+        part->stats.renamed += renamed;
+        part->stats.unmatched += unmatched;
+    }
+    free(query);
+    free(matched);
+    free(responses);
+    session_close(session);
+    options_drop(opts);
+    return NULL;
+}
+
+static void runRenamePartitions(RenamePartition* parts, int partitions) {
+    pthread_t* threads = malloc(partitions * sizeof(pthread_t));
+    for (int p = 0; p < partitions; p++) pthread_create(&threads[p], NULL, renamePartitionWorker, &parts[p]);
+    for (int p = 0; p < partitions; p++) pthread_join(threads[p], NULL);
+    free(threads);
+    for (int p = 0; p < partitions; p++) {
+        for (size_t i = 0; i < parts[p].count; i++) {
+            free(parts[p].renames[i].oldPath);
+            free(parts[p].renames[i].newPath);
+        }
+        parts[p].count = 0;
+    }
+}
+
+// Reads "old-path<TAB>new-path" lines from the mapping stream. Renames are partitioned by a hash of the
+// old path, except that renames sharing a path with an earlier one in the same chunk (a chain such as
+// a->b, b->c) follow it to its partition, where a single session applies them in file order. A rename
+// that would join two partitions' chains first waits for the buffered chunk to finish.
+BulkRenameStats bulkRenameFilePaths(DatabaseManager* dbManager, const char* dbName, FILE* mapping, size_t batchSize, int partitions) {
+    BulkRenameStats total = {0};
+    if (batchSize == 0 || partitions <= 0) {
+        fprintf(stderr, "Bulk rename needs a positive batch size and partition count.\n");
+        return total;
+    }
+    double started = monotonicSeconds();
+    size_t chunkSize = batchSize * BULK_RENAME_CHUNK_PER_PARTITION;
+    RenamePartition* parts = calloc(partitions, sizeof(RenamePartition));
+    for (int p = 0; p < partitions; p++) {
+        parts[p].dbManager = dbManager;
+        parts[p].dbName = dbName;
+        parts[p].batchSize = batchSize;
+        parts[p].capacity = chunkSize;
+        parts[p].renames = malloc(chunkSize * sizeof(PathRename));
+    }
+    StringMap chains; // path -> partition + 1, for paths renamed in the buffered chunk
+    stringMapInit(&chains, chunkSize);
+
+    char* line = NULL;
+    size_t lineCapacity = 0;
+    while (getline(&line, &lineCapacity, mapping) != -1) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* separator = strchr(line, '\t');
+        if (line[0] == '\0' || line[0] == '#') continue;
+        if (separator == NULL) {
+            fprintf(stderr, "Skipping malformed mapping line: %s\n", line);
+            continue;
+        }
+        *separator = '\0';
+        const char* newPath = separator + 1;
+        uintptr_t oldChain = (uintptr_t)stringMapGet(&chains, line), newChain = (uintptr_t)stringMapGet(&chains, newPath);
+        if (oldChain != 0 && newChain != 0 && oldChain != newChain) {
+            runRenamePartitions(parts, partitions);
+            stringMapFree(&chains, NULL);
+            stringMapInit(&chains, chunkSize);
+            oldChain = newChain = 0;
+        }
+        int p = oldChain != 0 ? (int)oldChain - 1 : newChain != 0 ? (int)newChain - 1 : (int)(hashPath(line) % partitions);
+        stringMapPut(&chains, line, (void*)(uintptr_t)(p + 1));
+        stringMapPut(&chains, newPath, (void*)(uintptr_t)(p + 1));
+        RenamePartition* part = &parts[p];
+        part->renames[part->count].oldPath = strdup(line);
+        part->renames[part->count].newPath = strdup(newPath);
+        if (++part->count == part->capacity) {
+            runRenamePartitions(parts, partitions);
+            stringMapFree(&chains, NULL);
+            stringMapInit(&chains, chunkSize);
+        }
+    }
+    free(line);
+    runRenamePartitions(parts, partitions);
+    stringMapFree(&chains, NULL);
+
+    for (int p = 0; p < partitions; p++) {
+        total.renamed += parts[p].stats.renamed;
+        total.unmatched += parts[p].stats.unmatched;
+        total.failed += parts[p].stats.failed;
+        free(parts[p].renames);
+    }
+    free(parts);
+    total.seconds = monotonicSeconds() - started;
+    size_t processed = total.renamed + total.unmatched + total.failed;
+    printf("Bulk rename complete. Renamed: %zu, unmatched: %zu, failed: %zu in %.2f s (%.0f renames/s).\n",
+        total.renamed, total.unmatched, total.failed, total.seconds, total.seconds > 0 ? processed / total.seconds : 0.0);
+    return total;
+}
@@ -0,0 +1,16 @@
+#ifndef TUTORIAL_BULK_RENAME_H
+#define TUTORIAL_BULK_RENAME_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct {
+    size_t renamed;
+    size_t unmatched;
+    size_t failed;
+    double seconds;
+} BulkRenameStats;
+
+BulkRenameStats bulkRenameFilePaths(DatabaseManager* dbManager, const char* dbName, FILE* mapping, size_t batchSize, int partitions);
+
+#endif
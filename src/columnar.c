@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "columnar.h"
+
+ColumnBatch* columnBatchNew(const char* const* vars, size_t varCount) {
+    ColumnBatch* batch = calloc(1, sizeof(ColumnBatch));
+    batch->columnCount = varCount;
+    batch->columns = calloc(varCount, sizeof(Column));
+    for (size_t c = 0; c < varCount; c++) batch->columns[c].name = strdup(vars[c]);
+    return batch;
+}
+
+void columnBatchDrop(ColumnBatch* batch) {
+    for (size_t c = 0; c < batch->columnCount; c++) {
+        Column* column = &batch->columns[c];
+        free(column->name);
+        free(column->valid);
+        free(column->longs);
+        free(column->doubles);
+        free(column->offsets);
+        free(column->data);
+    }
+    free(batch->columns);
+    free(batch);
+}
+
+// Empties the batch for reuse while keeping its buffers and column kinds.
+void columnBatchClear(ColumnBatch* batch) {
+    batch->rows = 0;
+    for (size_t c = 0; c < batch->columnCount; c++) {
+        batch->columns[c].dataSize = 0;
+        batch->columns[c].nulls = 0;
+        if (batch->columns[c].offsets != NULL) batch->columns[c].offsets[0] = 0;
+    }
+}
+
+bool columnKindIsString(ColumnKind kind) {
+    return kind == COLUMN_STRING || kind == COLUMN_IID;
+}
+
+static void columnAllocate(Column* column, size_t capacity) {
+    column->valid = realloc(column->valid, capacity);
+    if (column->kind == COLUMN_DOUBLE) column->doubles = realloc(column->doubles, capacity * sizeof(double));
+    else if (columnKindIsString(column->kind)) column->offsets = realloc(column->offsets, (capacity + 1) * sizeof(int32_t));
+    else if (column->kind != COLUMN_NULL) column->longs = realloc(column->longs, capacity * sizeof(int64_t));
+}
+
+// Fixes the column kind once its first value arrives; earlier rows become zero-valued nulls.
+static void columnSetKind(Column* column, ColumnKind kind, size_t rows, size_t capacity) {
+    column->kind = kind;
+    columnAllocate(column, capacity);
+    if (kind == COLUMN_DOUBLE) memset(column->doubles, 0, rows * sizeof(double));
+    else if (columnKindIsString(kind)) memset(column->offsets, 0, (rows + 1) * sizeof(int32_t));
+    else memset(column->longs, 0, rows * sizeof(int64_t));
+}
+
+static void columnAppendString(Column* column, size_t row, const char* value, size_t len) {
+    if (column->dataSize + len > column->dataCapacity) {
+        column->dataCapacity = (column->dataSize + len) * 2;
+        column->data = realloc(column->data, column->dataCapacity);
+    }
+    memcpy(column->data + column->dataSize, value, len);
+    column->dataSize += len;
+    column->offsets[row + 1] = (int32_t)column->dataSize;
+}
+
+static void columnAppendNull(Column* column, size_t row) {
+    column->valid[row] = 0;
+    column->nulls++;
+    if (column->kind == COLUMN_DOUBLE) column->doubles[row] = 0;
+    else if (columnKindIsString(column->kind)) column->offsets[row + 1] = column->offsets[row];
+    else if (column->kind != COLUMN_NULL) column->longs[row] = 0;
+}
+
+static ColumnKind conceptColumnKind(const Concept* value) {
+    if (value_is_string(value)) return COLUMN_STRING;
+    if (value_is_long(value)) return COLUMN_LONG;
+    if (value_is_double(value)) return COLUMN_DOUBLE;
+    if (value_is_boolean(value)) return COLUMN_BOOL;
+    return COLUMN_DATETIME;
+}
+
+static void columnAppendConcept(Column* column, size_t row, size_t capacity, Concept* concept) {
+    if (concept == NULL) {
+        columnAppendNull(column, row);
+        return;
+    }
+    Concept* value = NULL;
+    ColumnKind kind = COLUMN_IID;
+    if (concept_is_attribute(concept)) value = attribute_get_value(concept);
+    else if (concept_is_value(concept)) value = concept;
+    if (value != NULL) kind = conceptColumnKind(value);
+    if (column->kind == COLUMN_NULL) columnSetKind(column, kind, row, capacity);
+
+    if (kind != column->kind) columnAppendNull(column, row);
+    else {
+        column->valid[row] = 1;
+        if (kind == COLUMN_STRING || kind == COLUMN_IID) {
+            char* text = kind == COLUMN_STRING ? value_get_string(value) : thing_get_iid(concept);
+            if (text == NULL) columnAppendNull(column, row);
+            else columnAppendString(column, row, text, strlen(text));
+            string_free(text);
+        }
+        else if (kind == COLUMN_LONG) column->longs[row] = value_get_long(value);
+        else if (kind == COLUMN_BOOL) column->longs[row] = value_get_boolean(value);
+        else if (kind == COLUMN_DATETIME) column->longs[row] = value_get_date_time_as_millis(value);
+        else column->doubles[row] = value_get_double(value);
+    }
+    if (value != NULL && value != concept) concept_drop(value);
+}
+
+// Drains up to maxRows answers (all when maxRows is 0) into the batch and returns how many were added.
+// A read error sets batch->failed.
+size_t materializeConceptMaps(ConceptMapIterator* it, ColumnBatch* batch, size_t maxRows) {
+    size_t added = 0;
+    ConceptMap* cm = NULL;
+    while ((maxRows == 0 || added < maxRows) && (cm = concept_map_iterator_next(it)) != NULL) {
+        if (batch->rows == batch->capacity) {
+            batch->capacity = batch->capacity ? batch->capacity * 2 : 1024;
+            for (size_t c = 0; c < batch->columnCount; c++) columnAllocate(&batch->columns[c], batch->capacity);
+        }
+        for (size_t c = 0; c < batch->columnCount; c++) {
+            Concept* concept = concept_map_get(cm, batch->columns[c].name);
+            columnAppendConcept(&batch->columns[c], batch->rows, batch->capacity, concept);
+            if (concept != NULL) concept_drop(concept);
+        }
+        concept_map_drop(cm);
+        batch->rows++;
+        added++;
+    }
+    if (FAILED()) {
+        fprintf(stderr, "Failed to read query answers.\n");
+        batch->failed = true;
+    }
+    return added;
+}
+
+// True while some column has seen no value and so has no kind yet.
+bool columnBatchHasNullKind(const ColumnBatch* batch) {
+    for (size_t c = 0; c < batch->columnCount; c++) {
+        if (batch->columns[c].kind == COLUMN_NULL) return true;
+    }
+    return false;
+}
+
+Column* columnBatchColumn(ColumnBatch* batch, const char* name) {
+    for (size_t c = 0; c < batch->columnCount; c++) {
+        if (strcmp(batch->columns[c].name, name) == 0) return &batch->columns[c];
+    }
+    return NULL;
+}
+
+// Returns the row's string bytes (not NUL-terminated) and their length.
+const char* columnString(const Column* column, size_t row, size_t* len) {
+    *len = (size_t)(column->offsets[row + 1] - column->offsets[row]);
+    return column->data + column->offsets[row];
+}
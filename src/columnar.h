@@ -0,0 +1,44 @@
+#ifndef TUTORIAL_COLUMNAR_H
+#define TUTORIAL_COLUMNAR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { COLUMN_NULL, COLUMN_STRING, COLUMN_IID, COLUMN_LONG, COLUMN_DOUBLE, COLUMN_BOOL, COLUMN_DATETIME } ColumnKind;
+
+// One variable's values in row order. The kind is fixed by the first non-null value: strings and
+// IIDs live in data with Arrow-style offsets (row i spans offsets[i]..offsets[i + 1]), longs, bools
+// and datetimes (epoch millis) in longs, doubles in doubles. Rows whose concept is missing or of a
+// different kind are null (valid[i] == 0).
+typedef struct {
+    char* name;
+    ColumnKind kind;
+    uint8_t* valid;
+    int64_t* longs;
+    double* doubles;
+    int32_t* offsets;
+    char* data;
+    size_t dataSize;
+    size_t dataCapacity;
+    size_t nulls;
+} Column;
+
+typedef struct {
+    size_t rows;
+    size_t capacity;
+    size_t columnCount;
+    Column* columns;
+    bool failed; // reading answers into the batch failed; kept until the batch is dropped
+} ColumnBatch;
+
+ColumnBatch* columnBatchNew(const char* const* vars, size_t varCount);
+void columnBatchDrop(ColumnBatch* batch);
+void columnBatchClear(ColumnBatch* batch);
+bool columnKindIsString(ColumnKind kind);
+size_t materializeConceptMaps(ConceptMapIterator* it, ColumnBatch* batch, size_t maxRows);
+bool columnBatchHasNullKind(const ColumnBatch* batch);
+Column* columnBatchColumn(ColumnBatch* batch, const char* name);
+const char* columnString(const Column* column, size_t row, size_t* len);
+
+#endif
@@ -0,0 +1,684 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "datalog.h"
+#include "profiling.h"
+
+#define DATALOG_INFERRED 0x80000000u // relation ids of derived facts; never collides with a symbol
+
+uint32_t datalogSymbol(DatalogProgram* program, const char* text) {
+    uintptr_t symbol = (uintptr_t)stringMapGet(&program->symbols, text);
+    if (symbol != 0) return (uint32_t)(symbol - 1);
+    if (program->symbolCount == program->symbolCapacity) {
+        program->symbolCapacity = program->symbolCapacity ? program->symbolCapacity * 2 : 1024;
+        program->names = realloc(program->names, program->symbolCapacity * sizeof(char*));
+    }
+    program->names[program->symbolCount] = strdup(text);
+    stringMapPut(&program->symbols, text, (void*)(uintptr_t)(program->symbolCount + 1));
+    return (uint32_t)program->symbolCount++;
+}
+
+uint32_t datalogValueSymbol(DatalogProgram* program, const char* value) {
+    char text[1024];
+    snprintf(text, sizeof(text), "=%s", value);
+    return datalogSymbol(program, text);
+}
+
+uint64_t datalogHashColumns(const uint32_t* tuple, uint32_t mask) {
+    uint64_t hash = 1469598103934665603ull;
+    for (int c = 0; c < DATALOG_MAX_ARITY; c++) {
+        if (mask & (1u << c)) hash = (hash ^ tuple[c]) * 1099511628211ull;
+    }
+    return hash ^ (hash >> 29);
+}
+
+static bool datalogEqualColumns(const uint32_t* a, const uint32_t* b, uint32_t mask) {
+    for (int c = 0; c < DATALOG_MAX_ARITY; c++) {
+        if ((mask & (1u << c)) && a[c] != b[c]) return false;
+    }
+    return true;
+}
+
+// Returns the slot holding the tuple, or the empty slot where it belongs.
+static size_t datalogSlot(const DatalogRelation* relation, const uint32_t* tuple) {
+    uint32_t mask = (1u << relation->arity) - 1;
+    size_t slot = datalogHashColumns(tuple, mask) & (relation->slotCapacity - 1);
+    while (relation->slots[slot] != 0) {
+        if (datalogEqualColumns(relation->tuples + (size_t)(relation->slots[slot] - 1) * relation->arity, tuple, mask)) break;
+        slot = (slot + 1) & (relation->slotCapacity - 1);
+    }
+    return slot;
+}
+
+// Adds the tuple unless it is already present. Returns whether it was added.
+bool datalogInsert(DatalogRelation* relation, const uint32_t* tuple) {
+    if ((relation->count + 1) * 2 > relation->slotCapacity) {
+        relation->slotCapacity = relation->slotCapacity ? relation->slotCapacity * 2 : 64;
+        free(relation->slots);
+        relation->slots = calloc(relation->slotCapacity, sizeof(uint32_t));
+        for (size_t t = 0; t < relation->count; t++) {
+            relation->slots[datalogSlot(relation, relation->tuples + t * relation->arity)] = (uint32_t)t + 1;
+        }
+    }
+    size_t slot = datalogSlot(relation, tuple);
+    if (relation->slots[slot] != 0) {
+        uint8_t* removed = relation->removed + relation->slots[slot] - 1;
+        if (!*removed) return false;
+        *removed = 0;
+        return true;
+    }
+    if (relation->count == relation->capacity) {
+        relation->capacity = relation->capacity ? relation->capacity * 2 : 64;
+        relation->tuples = realloc(relation->tuples, relation->capacity * relation->arity * sizeof(uint32_t));
+        relation->removed = realloc(relation->removed, relation->capacity);
+    }
+    memcpy(relation->tuples + relation->count * relation->arity, tuple, relation->arity * sizeof(uint32_t));
+    relation->removed[relation->count] = 0;
+    relation->slots[slot] = (uint32_t)++relation->count;
+    return true;
+}
+
+// Returns the position of the tuple, or -1 if it is absent or removed.
+long datalogFind(const DatalogRelation* relation, const uint32_t* tuple) {
+    if (relation->slotCapacity == 0) return -1;
+    uint32_t at = relation->slots[datalogSlot(relation, tuple)];
+    return at != 0 && !relation->removed[at - 1] ? (long)at - 1 : -1;
+}
+
+// Tombstones the tuple in place, so positions and indexes stay valid. Returns whether it was present.
+bool datalogRemove(DatalogRelation* relation, const uint32_t* tuple) {
+    long at = datalogFind(relation, tuple);
+    if (at < 0) return false;
+    relation->removed[at] = 1;
+    return true;
+}
+
+// Returns a hash index on the masked columns covering every tuple, extending or rebuilding it as needed.
+DatalogIndex* datalogIndex(DatalogRelation* relation, uint32_t mask) {
+    DatalogIndex* index = NULL;
+    for (int i = 0; i < relation->indexCount; i++) {
+        if (relation->indexes[i].mask == mask) index = &relation->indexes[i];
+    }
+    if (index == NULL) {
+        if (relation->indexCount == DATALOG_MAX_INDEXES) return NULL;
+        index = &relation->indexes[relation->indexCount++];
+        memset(index, 0, sizeof(DatalogIndex));
+        index->mask = mask;
+    }
+    if (index->built == relation->count && index->buckets > 0) return index;
+    if (index->buckets == 0 || relation->count * 2 > index->buckets) {
+        free(index->heads);
+        index->buckets = 64;
+        while (index->buckets < relation->count * 2) index->buckets *= 2;
+        index->heads = calloc(index->buckets, sizeof(uint32_t));
+        index->built = 0;
+    }
+    index->next = realloc(index->next, relation->capacity * sizeof(uint32_t));
+    for (size_t t = index->built; t < relation->count; t++) {
+        size_t bucket = datalogHashColumns(relation->tuples + t * relation->arity, mask) & (index->buckets - 1);
+        index->next[t] = index->heads[bucket];
+        index->heads[bucket] = (uint32_t)t + 1;
+    }
+    index->built = relation->count;
+    return index;
+}
+
+// Whether some tuple agrees with this one on the masked columns.
+static bool datalogContains(DatalogRelation* relation, const uint32_t* tuple, uint32_t mask) {
+    DatalogIndex* index = datalogIndex(relation, mask);
+    if (index == NULL || index->buckets == 0) return false;
+    size_t bucket = datalogHashColumns(tuple, mask) & (index->buckets - 1);
+    for (uint32_t t = index->heads[bucket]; t != 0; t = index->next[t - 1]) {
+        if (!relation->removed[t - 1] && datalogEqualColumns(relation->tuples + (size_t)(t - 1) * relation->arity, tuple, mask)) return true;
+    }
+    return false;
+}
+
+DatalogRelation* datalogRelation(DatalogProgram* program, DatalogKind kind, const char* type, char** roles, int roleCount) {
+    for (size_t i = 0; i < program->relationCount; i++) {
+        DatalogRelation* r = program->relations[i];
+        if (r->kind != kind || strcmp(r->type, type) != 0 || (kind == DATALOG_RELATION && r->arity != roleCount + 1)) continue;
+        bool same = true;
+        for (int k = 0; k < roleCount && same; k++) same = strcmp(r->roles[k], roles[k]) == 0;
+        if (same) return r;
+    }
+    DatalogRelation* relation = calloc(1, sizeof(DatalogRelation));
+    relation->kind = kind;
+    relation->type = strdup(type);
+    relation->arity = kind == DATALOG_ISA ? 1 : kind == DATALOG_HAS ? 2 : roleCount + 1;
+    for (int k = 0; k < roleCount; k++) relation->roles[k] = strdup(roles[k]);
+    program->relations = realloc(program->relations, (program->relationCount + 1) * sizeof(DatalogRelation*));
+    program->relations[program->relationCount++] = relation;
+    return relation;
+}
+
+void typeqlNext(TypeQLLexer* lexer) {
+    while (*lexer->at == ' ' || *lexer->at == '\n' || *lexer->at == '\t' || *lexer->at == '\r') lexer->at++;
+    size_t len = 0;
+    char c = *lexer->at;
+    if (c == '\0') {
+        lexer->kind = 0;
+    } else if (c == '"' || c == '\'') {
+        lexer->at++;
+        while (*lexer->at && *lexer->at != c) {
+            if (*lexer->at == '\\' && lexer->at[1]) lexer->at++;
+            if (len + 1 < sizeof(lexer->token)) lexer->token[len++] = *lexer->at;
+            lexer->at++;
+        }
+        if (*lexer->at) lexer->at++;
+        lexer->kind = '"';
+    } else if (c == '$' || c == '_' || c == '-' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+        lexer->kind = c == '$' ? '$' : 'a';
+        if (c == '$') lexer->at++;
+        while (*lexer->at == '_' || *lexer->at == '-' || *lexer->at == '!' || (*lexer->at >= 'a' && *lexer->at <= 'z') || (*lexer->at >= 'A' && *lexer->at <= 'Z') || (*lexer->at >= '0' && *lexer->at <= '9')) {
+            if (len + 1 < sizeof(lexer->token)) lexer->token[len++] = *lexer->at;
+            lexer->at++;
+        }
+    } else {
+        lexer->kind = c;
+        lexer->token[len++] = c;
+        lexer->at++;
+    }
+    lexer->token[len] = '\0';
+}
+
+typedef struct {
+    char* names[DATALOG_MAX_VARS];
+    int count;
+} DatalogVars;
+
+static int datalogVar(DatalogVars* vars, const char* name) {
+    for (int v = 0; v < vars->count; v++) {
+        if (strcmp(vars->names[v], name) == 0) return v;
+    }
+    if (vars->count == DATALOG_MAX_VARS) return -1;
+    vars->names[vars->count] = strdup(name);
+    return vars->count++;
+}
+
+static bool datalogTerm(DatalogProgram* program, DatalogVars* vars, TypeQLLexer* lexer, DatalogTerm* term) {
+    if (lexer->kind == '$') {
+        int v = datalogVar(vars, lexer->token);
+        *term = (DatalogTerm){ true, (uint32_t)v };
+        return v >= 0;
+    }
+    if (lexer->kind != '"') return false;
+    *term = (DatalogTerm){ false, datalogValueSymbol(program, lexer->token) };
+    return true;
+}
+
+// Parses "{ statement; ... }" into atoms. Supports isa, has with a variable or string constant, and
+// relations with role-qualified players. Anything else (values, negation, disjunction) is rejected.
+static int datalogParsePattern(DatalogProgram* program, DatalogVars* vars, const char* pattern, DatalogAtom* atoms, int capacity) {
+    TypeQLLexer lexer = { .at = pattern };
+    char* roles[DATALOG_MAX_ARITY];
+    char* players[DATALOG_MAX_ARITY];
+    int roleCount = 0;
+    int count = 0;
+    typeqlNext(&lexer);
+    if (lexer.kind == '{') typeqlNext(&lexer);
+    while (lexer.kind != 0 && lexer.kind != '}') {
+        char subject[256] = "";
+        if (lexer.kind == '$') {
+            snprintf(subject, sizeof(subject), "%s", lexer.token);
+            typeqlNext(&lexer);
+        }
+        bool isRelation = lexer.kind == '(';
+        if (isRelation) {
+            typeqlNext(&lexer);
+            while (lexer.kind == 'a' && roleCount < DATALOG_MAX_ARITY - 1) {
+                char role[sizeof(lexer.token)];
+                memcpy(role, lexer.token, sizeof(role));
+                typeqlNext(&lexer);
+                if (lexer.kind != ':') goto fail;
+                typeqlNext(&lexer);
+                if (lexer.kind != '$') goto fail;
+                roles[roleCount] = strdup(role);
+                players[roleCount++] = strdup(lexer.token);
+                typeqlNext(&lexer);
+                if (lexer.kind == ',') typeqlNext(&lexer);
+            }
+            if (lexer.kind != ')' || roleCount == 0) goto fail;
+            typeqlNext(&lexer);
+            // Sort role players by role name so every pattern over the relation maps to the same columns.
+            for (int i = 1; i < roleCount; i++) {
+                for (int j = i; j > 0 && strcmp(roles[j - 1], roles[j]) > 0; j--) {
+                    char* role = roles[j]; roles[j] = roles[j - 1]; roles[j - 1] = role;
+                    char* player = players[j]; players[j] = players[j - 1]; players[j - 1] = player;
+                }
+            }
+        }
+        if (subject[0] == '\0') snprintf(subject, sizeof(subject), "#%d", vars->count); // cannot clash with a TypeQL name
+        bool typed = false;
+        while (lexer.kind == 'a' && count < capacity) {
+            DatalogAtom* atom = &atoms[count];
+            if (strcmp(lexer.token, "isa") == 0 || strcmp(lexer.token, "isa!") == 0) {
+                typeqlNext(&lexer);
+                if (lexer.kind != 'a') goto fail;
+                if (isRelation) {
+                    atom->relation = datalogRelation(program, DATALOG_RELATION, lexer.token, roles, roleCount);
+                    for (int k = 0; k < roleCount; k++) atom->terms[k] = (DatalogTerm){ true, (uint32_t)datalogVar(vars, players[k]) };
+                    atom->terms[roleCount] = (DatalogTerm){ true, (uint32_t)datalogVar(vars, subject) };
+                } else {
+                    atom->relation = datalogRelation(program, DATALOG_ISA, lexer.token, NULL, 0);
+                    atom->terms[0] = (DatalogTerm){ true, (uint32_t)datalogVar(vars, subject) };
+                }
+                typed = true;
+            } else if (strcmp(lexer.token, "has") == 0) {
+                typeqlNext(&lexer);
+                if (lexer.kind != 'a') goto fail;
+                atom->relation = datalogRelation(program, DATALOG_HAS, lexer.token, NULL, 0);
+                atom->terms[0] = (DatalogTerm){ true, (uint32_t)datalogVar(vars, subject) };
+                typeqlNext(&lexer);
+                if (!datalogTerm(program, vars, &lexer, &atom->terms[1])) goto fail;
+            } else goto fail;
+            count++;
+            typeqlNext(&lexer);
+            if (lexer.kind == ',') typeqlNext(&lexer);
+        }
+        for (int k = 0; k < roleCount; k++) {
+            free(roles[k]);
+            free(players[k]);
+        }
+        roleCount = 0;
+        if ((isRelation && !typed) || lexer.kind != ';') return -1;
+        typeqlNext(&lexer);
+    }
+    for (int a = 0; a < count; a++) {
+        for (int c = 0; c < atoms[a].relation->arity; c++) {
+            if (atoms[a].terms[c].isVar && atoms[a].terms[c].value >= DATALOG_MAX_VARS) return -1;
+        }
+    }
+    return count;
+fail:
+    for (int k = 0; k < roleCount; k++) {
+        free(roles[k]);
+        free(players[k]);
+    }
+    return -1;
+}
+
+// Adds a rule given its when and then patterns. The conclusion must be a single relation or has.
+static bool datalogAddRule(DatalogProgram* program, const char* label, const char* when, const char* then) {
+    DatalogRule rule = { 0 };
+    DatalogVars vars = { 0 };
+    rule.bodyCount = datalogParsePattern(program, &vars, when, rule.body, DATALOG_MAX_ATOMS);
+    DatalogAtom heads[2];
+    int headCount = rule.bodyCount > 0 ? datalogParsePattern(program, &vars, then, heads, 2) : -1;
+    rule.varCount = vars.count;
+    for (int v = 0; v < vars.count; v++) free(vars.names[v]);
+    if (headCount != 1 || heads[0].relation->kind == DATALOG_ISA) {
+        fprintf(stderr, "Rule %s uses patterns the local reasoner does not support; skipped.\n", label);
+        return false;
+    }
+    rule.head = heads[0];
+    // Every head column must be bound by the body, except the id of a concluded relation.
+    int headColumns = rule.head.relation->kind == DATALOG_RELATION ? rule.head.relation->arity - 1 : rule.head.relation->arity;
+    for (int c = 0; c < headColumns; c++) {
+        if (!rule.head.terms[c].isVar) continue;
+        bool bound = false;
+        for (int a = 0; a < rule.bodyCount && !bound; a++) {
+            for (int k = 0; k < rule.body[a].relation->arity && !bound; k++) {
+                bound = rule.body[a].terms[k].isVar && rule.body[a].terms[k].value == rule.head.terms[c].value;
+            }
+        }
+        if (!bound) {
+            fprintf(stderr, "Rule %s concludes an unbound variable; skipped.\n", label);
+            return false;
+        }
+    }
+    rule.label = strdup(label);
+    program->rules = realloc(program->rules, (program->ruleCount + 1) * sizeof(DatalogRule));
+    program->rules[program->ruleCount++] = rule;
+    return true;
+}
+
+static char* datalogConceptSymbolText(Concept* concept, char* buffer, size_t size) {
+    if (!concept_is_attribute(concept)) {
+        char* iid = thing_get_iid(concept);
+        snprintf(buffer, size, "%s", iid);
+        string_free(iid);
+        return buffer;
+    }
+    Concept* value = attribute_get_value(concept);
+    if (value_is_string(value)) {
+        char* text = value_get_string(value);
+        snprintf(buffer, size, "=%s", text);
+        string_free(text);
+    } else if (value_is_long(value)) snprintf(buffer, size, "=%lld", (long long)value_get_long(value));
+    else if (value_is_double(value)) snprintf(buffer, size, "=%.17g", value_get_double(value));
+    else if (value_is_boolean(value)) snprintf(buffer, size, "=%s", value_get_boolean(value) ? "true" : "false");
+    else snprintf(buffer, size, "=%lld", (long long)value_get_date_time_as_millis(value));
+    concept_drop(value);
+    return buffer;
+}
+
+// Loads the explicit facts of one predicate with inference off.
+static bool datalogLoadRelation(DatalogProgram* program, Transaction* tx, Options* opts, DatalogRelation* relation) {
+    char query[1024];
+    char vars[DATALOG_MAX_ARITY][16];
+    if (relation->kind == DATALOG_ISA) {
+        snprintf(query, sizeof(query), "match $c0 isa %s; get $c0;", relation->type);
+    } else if (relation->kind == DATALOG_HAS) {
+        snprintf(query, sizeof(query), "match $c0 has %s $c1; get $c0, $c1;", relation->type);
+    } else {
+        size_t len = (size_t)snprintf(query, sizeof(query), "match $c%d (", relation->arity - 1);
+        for (int k = 0; k < relation->arity - 1; k++) {
+            len += (size_t)snprintf(query + len, sizeof(query) - len, "%s%s: $c%d", k ? ", " : "", relation->roles[k], k);
+        }
+        snprintf(query + len, sizeof(query) - len, ") isa %s; get;", relation->type);
+    }
+    for (int c = 0; c < relation->arity; c++) snprintf(vars[c], sizeof(vars[c]), "c%d", c);
+    ConceptMapIterator* response = query_get(tx, query, opts);
+    if (response == NULL || FAILED()) return false;
+    ConceptMap* cm = NULL;
+    uint32_t tuple[DATALOG_MAX_ARITY];
+    char text[1024];
+    while ((cm = concept_map_iterator_next(response)) != NULL) {
+        for (int c = 0; c < relation->arity; c++) {
+            Concept* concept = concept_map_get(cm, vars[c]);
+            tuple[c] = datalogSymbol(program, datalogConceptSymbolText(concept, text, sizeof(text)));
+            concept_drop(concept);
+        }
+        datalogInsert(relation, tuple);
+        concept_map_drop(cm);
+    }
+    concept_map_iterator_drop(response);
+    return !FAILED();
+}
+
+static void datalogConclude(DatalogJoin* join) {
+    DatalogAtom* head = &join->rule->head;
+    int arity = head->relation->arity;
+    if (join->pendingCount == join->pendingCapacity) {
+        join->pendingCapacity = join->pendingCapacity ? join->pendingCapacity * 2 : 64;
+        join->pending = realloc(join->pending, join->pendingCapacity * arity * sizeof(uint32_t));
+    }
+    uint32_t* tuple = join->pending + join->pendingCount++ * arity;
+    for (int c = 0; c < arity; c++) {
+        DatalogTerm term = head->terms[c];
+        tuple[c] = !term.isVar ? term.value : join->bound[term.value] ? join->binding[term.value] : 0;
+    }
+    if (head->relation->kind == DATALOG_RELATION) tuple[arity - 1] = 0; // assigned when the tuple is added
+}
+
+// Binds the atom's variables against one tuple; returns the variables it newly bound in newlyBound.
+static bool datalogMatch(DatalogJoin* join, const DatalogAtom* atom, const uint32_t* tuple, uint32_t* newlyBound) {
+    *newlyBound = 0;
+    for (int c = 0; c < atom->relation->arity; c++) {
+        DatalogTerm term = atom->terms[c];
+        if (!term.isVar) {
+            if (tuple[c] != term.value) return false;
+        } else if (join->bound[term.value]) {
+            if (join->binding[term.value] != tuple[c]) return false;
+        } else {
+            join->bound[term.value] = true;
+            join->binding[term.value] = tuple[c];
+            *newlyBound |= 1u << term.value;
+        }
+    }
+    return true;
+}
+
+static void datalogUnbind(DatalogJoin* join, uint32_t newlyBound) {
+    for (int v = 0; newlyBound; v++, newlyBound >>= 1) {
+        if (newlyBound & 1) join->bound[v] = false;
+    }
+}
+
+static bool datalogSkip(const DatalogJoin* join, int bodyAtom, const DatalogRelation* relation, size_t tuple) {
+    if (relation->removed[tuple]) return true;
+    return relation == join->excludedRelation && tuple == join->excludedTuple && bodyAtom < join->deltaAtom;
+}
+
+// Nested-loop join in the chosen atom order, probing a hash index on the bound columns of each atom.
+void datalogJoinFrom(DatalogJoin* join, int depth) {
+    DatalogRule* rule = join->rule;
+    if (depth == rule->bodyCount) {
+        datalogConclude(join);
+        return;
+    }
+    const DatalogAtom* atom = &rule->body[join->order[depth]];
+    DatalogRelation* relation = atom->relation;
+    uint32_t newlyBound;
+    int bodyAtom = join->order[depth];
+    if (bodyAtom == join->deltaAtom) {
+        for (size_t t = join->deltaFrom; t < join->deltaTo; t++) {
+            if (relation->removed[t]) continue;
+            if (datalogMatch(join, atom, relation->tuples + t * relation->arity, &newlyBound)) datalogJoinFrom(join, depth + 1);
+            datalogUnbind(join, newlyBound);
+        }
+        return;
+    }
+    uint32_t mask = 0;
+    uint32_t key[DATALOG_MAX_ARITY] = {0};
+    for (int c = 0; c < relation->arity; c++) {
+        DatalogTerm term = atom->terms[c];
+        if (!term.isVar || join->bound[term.value]) {
+            mask |= 1u << c;
+            key[c] = term.isVar ? join->binding[term.value] : term.value;
+        }
+    }
+    DatalogIndex* index = mask ? datalogIndex(relation, mask) : NULL;
+    if (index == NULL) {
+        for (size_t t = 0; t < relation->count; t++) {
+            if (datalogSkip(join, bodyAtom, relation, t)) continue;
+            if (datalogMatch(join, atom, relation->tuples + t * relation->arity, &newlyBound)) datalogJoinFrom(join, depth + 1);
+            datalogUnbind(join, newlyBound);
+        }
+        return;
+    }
+    size_t bucket = datalogHashColumns(key, mask) & (index->buckets - 1);
+    for (uint32_t t = index->heads[bucket]; t != 0; t = index->next[t - 1]) {
+        const uint32_t* tuple = relation->tuples + (size_t)(t - 1) * relation->arity;
+        if (datalogSkip(join, bodyAtom, relation, t - 1) || !datalogEqualColumns(tuple, key, mask)) continue;
+        if (datalogMatch(join, atom, tuple, &newlyBound)) datalogJoinFrom(join, depth + 1);
+        datalogUnbind(join, newlyBound);
+    }
+}
+
+// Orders the body greedily: the delta atom first, then whichever atom shares the most bound variables,
+// smaller relations first on ties.
+void datalogPlan(DatalogJoin* join) {
+    DatalogRule* rule = join->rule;
+    bool used[DATALOG_MAX_ATOMS] = {0};
+    bool bound[DATALOG_MAX_VARS] = {0};
+    for (int depth = 0; depth < rule->bodyCount; depth++) {
+        int best = -1;
+        long bestScore = 0;
+        for (int a = 0; a < rule->bodyCount; a++) {
+            if (used[a]) continue;
+            long score = 0;
+            for (int c = 0; c < rule->body[a].relation->arity; c++) {
+                DatalogTerm term = rule->body[a].terms[c];
+                if (!term.isVar || bound[term.value]) score += 1L << 40;
+            }
+            score -= (long)rule->body[a].relation->count;
+            if (a == join->deltaAtom) score = LONG_MAX;
+            if (best < 0 || score > bestScore) {
+                best = a;
+                bestScore = score;
+            }
+        }
+        used[best] = true;
+        join->order[depth] = best;
+        for (int c = 0; c < rule->body[best].relation->arity; c++) {
+            if (rule->body[best].terms[c].isVar) bound[rule->body[best].terms[c].value] = true;
+        }
+    }
+}
+
+// Semi-naive evaluation to a fixpoint: after the first round, every rule is only re-joined with one body
+// atom restricted to the facts that are new since the previous round.
+static void datalogEvaluate(DatalogProgram* program) {
+    DatalogJoin* joins = calloc(program->ruleCount, sizeof(DatalogJoin));
+    for (size_t r = 0; r < program->relationCount; r++) program->relations[r]->deltaStart = 0;
+    bool changed = true;
+    for (program->rounds = 0; changed; program->rounds++) {
+        for (size_t i = 0; i < program->ruleCount; i++) {
+            DatalogJoin* join = &joins[i];
+            join->program = program;
+            join->rule = &program->rules[i];
+            join->pendingCount = 0;
+            for (int a = program->rounds == 0 ? -1 : 0; a < join->rule->bodyCount; a++) {
+                if (a >= 0 && join->rule->body[a].relation->deltaStart == join->rule->body[a].relation->count) continue;
+                join->deltaAtom = a;
+                if (a >= 0) {
+                    join->deltaFrom = join->rule->body[a].relation->deltaStart;
+                    join->deltaTo = join->rule->body[a].relation->count;
+                }
+                datalogPlan(join);
+                datalogJoinFrom(join, 0);
+                if (program->rounds == 0) break;
+            }
+        }
+        for (size_t r = 0; r < program->relationCount; r++) program->relations[r]->deltaStart = program->relations[r]->count;
+        changed = false;
+        for (size_t i = 0; i < program->ruleCount; i++) {
+            DatalogRelation* relation = program->rules[i].head.relation;
+            for (size_t t = 0; t < joins[i].pendingCount; t++) {
+                uint32_t* tuple = joins[i].pending + t * relation->arity;
+                if (relation->kind == DATALOG_RELATION) {
+                    if (datalogContains(relation, tuple, (1u << (relation->arity - 1)) - 1)) continue;
+                    tuple[relation->arity - 1] = DATALOG_INFERRED | program->inferredCount++;
+                }
+                if (!datalogInsert(relation, tuple)) continue;
+                relation->derived++;
+                changed = true;
+            }
+        }
+    }
+    for (size_t i = 0; i < program->ruleCount; i++) free(joins[i].pending);
+    free(joins);
+}
+
+void datalogFree(DatalogProgram* program) {
+    for (size_t r = 0; r < program->relationCount; r++) {
+        DatalogRelation* relation = program->relations[r];
+        free(relation->type);
+        for (int k = 0; k < relation->arity; k++) free(relation->roles[k]);
+        free(relation->tuples);
+        free(relation->removed);
+        free(relation->slots);
+        for (int i = 0; i < relation->indexCount; i++) {
+            free(relation->indexes[i].heads);
+            free(relation->indexes[i].next);
+        }
+        free(relation);
+    }
+    for (size_t i = 0; i < program->ruleCount; i++) free(program->rules[i].label);
+    for (size_t s = 0; s < program->symbolCount; s++) free(program->names[s]);
+    free(program->names);
+    free(program->relations);
+    free(program->rules);
+    stringMapFree(&program->symbols, NULL);
+}
+
+// Reads the schema's rules and the explicit facts their patterns use from one read transaction, plus
+// has facts for any extra attribute types the caller needs to look instances up by.
+bool datalogLoad(DatalogProgram* program, DatabaseManager* dbManager, const char* dbName, const char** attributes, size_t attributeCount) {
+    memset(program, 0, sizeof(DatalogProgram));
+    stringMapInit(&program->symbols, 4096);
+    Options* opts = options_new();
+    options_set_infer(opts, false);
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(opts);
+        return false;
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        session_close(session);
+        options_drop(opts);
+        return false;
+    }
+    RuleIterator* rules = logic_manager_get_rules(tx);
+    Rule* rule = NULL;
+    while (rules != NULL && (rule = rule_iterator_next(rules)) != NULL) {
+        char* label = rule_get_label(rule);
+        char* when = rule_get_when(rule);
+        char* then = rule_get_then(rule);
+        datalogAddRule(program, label, when, then);
+        string_free(then);
+        string_free(when);
+        string_free(label);
+        rule_drop(rule);
+    }
+    bool loaded = rules != NULL && !FAILED();
+    rule_iterator_drop(rules);
+    for (size_t a = 0; a < attributeCount; a++) datalogRelation(program, DATALOG_HAS, attributes[a], NULL, 0);
+    for (size_t r = 0; loaded && r < program->relationCount; r++) {
+        loaded = datalogLoadRelation(program, tx, opts, program->relations[r]);
+    }
+    if (!loaded) fprintf(stderr, "Failed to load rules and facts for local reasoning.\n");
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+    return loaded;
+}
+
+static int compareU64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Distinct (first, second) column pairs of a relation's live tuples: what a get of two role players counts.
+static size_t datalogDistinctPairs(const DatalogRelation* relation) {
+    uint64_t* pairs = malloc((relation->count + 1) * sizeof(uint64_t));
+    size_t count = 0;
+    for (size_t t = 0; t < relation->count; t++) {
+        if (relation->removed != NULL && relation->removed[t]) continue;
+        const uint32_t* tuple = relation->tuples + t * relation->arity;
+        pairs[count++] = (uint64_t)tuple[0] << 32 | tuple[1];
+    }
+    qsort(pairs, count, sizeof(uint64_t), compareU64);
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; i++) distinct += i == 0 || pairs[i] != pairs[i - 1];
+    free(pairs);
+    return distinct;
+}
+
+// Compares local evaluation of the schema's rules with server-side inference of the same permissions.
+void benchmarkDatalog(DatabaseManager* dbManager, const char* dbName) {
+    DatalogProgram program;
+    double started = monotonicSeconds();
+    if (!datalogLoad(&program, dbManager, dbName, NULL, 0)) return;
+    double loaded = monotonicSeconds();
+    datalogEvaluate(&program);
+    double evaluated = monotonicSeconds();
+    printf("Datalog benchmark: %zu rules over %zu predicates, %.3f s to load, %.3f ms to evaluate in %zu rounds\n",
+           program.ruleCount, program.relationCount, loaded - started, (evaluated - loaded) * 1e3, program.rounds);
+    for (size_t r = 0; r < program.relationCount; r++) {
+        DatalogRelation* relation = program.relations[r];
+        if (relation->derived > 0) printf("  %s: %zu facts, %zu inferred\n", relation->type, relation->count, relation->derived);
+    }
+
+    // The server counterpart: the same permissions with inference on. Both sides must agree.
+    char* permissionRoles[] = { "access", "subject" };
+    size_t localPermissions = datalogDistinctPairs(datalogRelation(&program, DATALOG_RELATION, "permission", permissionRoles, 2));
+    Options* opts = options_new();
+    options_set_infer(opts, true);
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    Transaction* tx = session != NULL && !FAILED() ? transaction_new(session, Read, opts) : NULL;
+    if (tx != NULL && !FAILED()) {
+        started = monotonicSeconds();
+        Concept* count = concept_promise_resolve(query_get_aggregate(tx, "match (subject: $s, access: $a) isa permission; get $s, $a; count;", opts));
+        if (count != NULL && !FAILED()) {
+            long long serverPermissions = (long long)value_get_long(count);
+            printf("  server inference: %lld permissions in %.3f ms\n", serverPermissions, (monotonicSeconds() - started) * 1e3);
+            if (serverPermissions != (long long)localPermissions) {
+                fprintf(stderr, "Error: the local reasoner derived %zu permissions, the server inferred %lld.\n", localPermissions, serverPermissions);
+            }
+            concept_drop(count);
+        }
+        transaction_close(tx);
+    }
+    if (session != NULL) session_close(session);
+    options_drop(opts);
+    datalogFree(&program);
+}
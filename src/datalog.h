@@ -0,0 +1,115 @@
+#ifndef TUTORIAL_DATALOG_H
+#define TUTORIAL_DATALOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "string_map.h"
+
+#define DATALOG_MAX_ARITY 8
+#define DATALOG_MAX_ATOMS 16
+#define DATALOG_MAX_VARS 32
+#define DATALOG_MAX_INDEXES 8
+
+// Facts are tuples of interned symbols. Instance columns hold IIDs and value columns hold "=" + the
+// value, so a rule constant can never match an IID.
+typedef enum { DATALOG_ISA, DATALOG_HAS, DATALOG_RELATION } DatalogKind;
+
+typedef struct {
+    uint32_t mask; // columns the index is keyed on
+    uint32_t* heads; // bucket -> tuple + 1
+    uint32_t* next;  // tuple -> next tuple in the bucket + 1
+    size_t buckets;
+    size_t built;    // tuples indexed so far
+} DatalogIndex;
+
+// One predicate. ISA is [instance], HAS is [owner, value] and RELATION is [players in role-name order,
+// relation]. Like the server, a concluded relation is only added if no relation with the same players
+// exists yet.
+typedef struct {
+    DatalogKind kind;
+    char* type;
+    char* roles[DATALOG_MAX_ARITY];
+    int arity;
+    uint32_t* tuples;
+    size_t count;
+    size_t capacity;
+    size_t deltaStart; // tuples from deltaStart on are new since the previous round
+    uint8_t* removed;  // tombstones left by datalogRemove; a re-insert revives the tuple
+    uint32_t* slots;   // dedupe set: tuple + 1
+    size_t slotCapacity;
+    DatalogIndex indexes[DATALOG_MAX_INDEXES];
+    int indexCount;
+    size_t derived;
+} DatalogRelation;
+
+typedef struct {
+    bool isVar;
+    uint32_t value; // variable number or symbol
+} DatalogTerm;
+
+typedef struct {
+    DatalogRelation* relation;
+    DatalogTerm terms[DATALOG_MAX_ARITY];
+} DatalogAtom;
+
+typedef struct {
+    char* label;
+    DatalogAtom body[DATALOG_MAX_ATOMS];
+    int bodyCount;
+    DatalogAtom head;
+    int varCount;
+} DatalogRule;
+
+typedef struct {
+    StringMap symbols; // text -> symbol + 1
+    char** names;
+    size_t symbolCount;
+    size_t symbolCapacity;
+    DatalogRelation** relations;
+    size_t relationCount;
+    DatalogRule* rules;
+    size_t ruleCount;
+    uint32_t inferredCount;
+    size_t rounds;
+} DatalogProgram;
+
+// A tokenizer for the conjunctive TypeQL patterns returned by rule_get_when and rule_get_then.
+typedef struct {
+    const char* at;
+    char token[256];
+    char kind; // '$' variable, 'a' label, '"' string, 0 at the end, otherwise the punctuation character
+} TypeQLLexer;
+
+typedef struct {
+    DatalogProgram* program;
+    DatalogRule* rule;
+    int order[DATALOG_MAX_ATOMS];
+    int deltaAtom; // -1 to join the full relations
+    size_t deltaFrom; // tuples of the delta atom's relation to join it with
+    size_t deltaTo;
+    const DatalogRelation* excludedRelation; // body atoms before the delta atom skip this one tuple
+    size_t excludedTuple;
+    uint32_t binding[DATALOG_MAX_VARS];
+    bool bound[DATALOG_MAX_VARS];
+    uint32_t* pending; // concluded head tuples, added after the round
+    size_t pendingCount;
+    size_t pendingCapacity;
+} DatalogJoin;
+
+uint32_t datalogSymbol(DatalogProgram* program, const char* text);
+uint32_t datalogValueSymbol(DatalogProgram* program, const char* value);
+uint64_t datalogHashColumns(const uint32_t* tuple, uint32_t mask);
+bool datalogInsert(DatalogRelation* relation, const uint32_t* tuple);
+long datalogFind(const DatalogRelation* relation, const uint32_t* tuple);
+bool datalogRemove(DatalogRelation* relation, const uint32_t* tuple);
+DatalogIndex* datalogIndex(DatalogRelation* relation, uint32_t mask);
+DatalogRelation* datalogRelation(DatalogProgram* program, DatalogKind kind, const char* type, char** roles, int roleCount);
+void typeqlNext(TypeQLLexer* lexer);
+void datalogJoinFrom(DatalogJoin* join, int depth);
+void datalogPlan(DatalogJoin* join);
+void datalogFree(DatalogProgram* program);
+bool datalogLoad(DatalogProgram* program, DatabaseManager* dbManager, const char* dbName, const char** attributes, size_t attributeCount);
+void benchmarkDatalog(DatabaseManager* dbManager, const char* dbName);
+
+#endif
@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "executor.h"
+#include "typeql_escape.h"
+#include "profiling.h"
+#include "write_listeners.h"
+
+Future* futureNew(void) {
+    Future* future = calloc(1, sizeof(Future));
+    pthread_mutex_init(&future->lock, NULL);
+    pthread_cond_init(&future->done, NULL);
+    return future;
+}
+
+void futureDrop(Future* future) {
+    pthread_mutex_destroy(&future->lock);
+    pthread_cond_destroy(&future->done);
+    free(future->error);
+    free(future);
+}
+
+static void executorEnqueue(Executor* executor, TaskFn fn, void* arg, Future* future) {
+    Task* task = malloc(sizeof(Task));
+    task->fn = fn;
+    task->arg = arg;
+    task->future = future;
+    task->next = NULL;
+    pthread_mutex_lock(&executor->lock);
+    if (executor->tail) executor->tail->next = task;
+    else executor->head = task;
+    executor->tail = task;
+    pthread_cond_signal(&executor->available);
+    pthread_mutex_unlock(&executor->lock);
+}
+
+static void futureFail(Future* future, const char* error);
+
+// Sets the result, or the error when error is not NULL, and runs or fails the continuation.
+static void futureSettle(Future* future, void* result, const char* error) {
+    pthread_mutex_lock(&future->lock);
+    future->result = result;
+    future->error = error != NULL ? strdup(error) : NULL;
+    future->ready = true;
+    Executor* thenExecutor = future->thenExecutor;
+    TaskFn thenFn = future->thenFn;
+    Future* thenFuture = future->thenFuture;
+    pthread_cond_broadcast(&future->done);
+    pthread_mutex_unlock(&future->lock);
+    if (thenExecutor == NULL) return;
+    if (error != NULL) futureFail(thenFuture, error);
+    else executorEnqueue(thenExecutor, thenFn, result, thenFuture);
+}
+
+void futureComplete(Future* future, void* result) {
+    futureSettle(future, result, NULL);
+}
+
+static void futureFail(Future* future, const char* error) {
+    futureSettle(future, NULL, error);
+}
+
+static void* executorWorker(void* arg) {
+    Executor* executor = (Executor*)arg;
+    for (;;) {
+        pthread_mutex_lock(&executor->lock);
+        while (executor->head == NULL && !executor->stopping) pthread_cond_wait(&executor->available, &executor->lock);
+        Task* task = executor->head;
+        if (task == NULL) {
+            pthread_mutex_unlock(&executor->lock);
+            return NULL;
+        }
+        executor->head = task->next;
+        if (executor->head == NULL) executor->tail = NULL;
+        pthread_mutex_unlock(&executor->lock);
+        void* result = task->fn(task->arg);
+        if (task->future != NULL) futureComplete(task->future, result);
+        free(task);
+    }
+}
+
+Executor* executorNew(int threadCount) {
+    Executor* executor = calloc(1, sizeof(Executor));
+    pthread_mutex_init(&executor->lock, NULL);
+    pthread_cond_init(&executor->available, NULL);
+    executor->threadCount = threadCount;
+    executor->threads = malloc(threadCount * sizeof(pthread_t));
+    for (int i = 0; i < threadCount; i++) pthread_create(&executor->threads[i], NULL, executorWorker, executor);
+    return executor;
+}
+
+// Drains all queued tasks, then stops and frees the pool. Workflows still running keep requeueing
+// themselves, so await them first.
+void executorShutdown(Executor* executor) {
+    pthread_mutex_lock(&executor->lock);
+    executor->stopping = true;
+    pthread_cond_broadcast(&executor->available);
+    pthread_mutex_unlock(&executor->lock);
+    for (int i = 0; i < executor->threadCount; i++) pthread_join(executor->threads[i], NULL);
+    pthread_mutex_destroy(&executor->lock);
+    pthread_cond_destroy(&executor->available);
+    free(executor->threads);
+    free(executor);
+}
+
+Future* executorSubmit(Executor* executor, TaskFn fn, void* arg) {
+    Future* future = futureNew();
+    executorEnqueue(executor, fn, arg, future);
+    return future;
+}
+
+void* futureAwait(Future* future) {
+    pthread_mutex_lock(&future->lock);
+    while (!future->ready) pthread_cond_wait(&future->done, &future->lock);
+    void* result = future->result;
+    pthread_mutex_unlock(&future->lock);
+    return result;
+}
+
+// The error of a settled future, or NULL if it completed normally.
+const char* futureError(Future* future) {
+    futureAwait(future);
+    return future->error;
+}
+
+// Schedules fn on the executor with the future's result as its argument once that result is available.
+// If the future fails, fn does not run and the returned future fails with the same error. At most one
+// continuation can be attached to a future.
+Future* futureThen(Executor* executor, Future* future, TaskFn fn) {
+    Future* next = futureNew();
+    pthread_mutex_lock(&future->lock);
+    bool ready = future->ready;
+    if (!ready) {
+        future->thenExecutor = executor;
+        future->thenFn = fn;
+        future->thenFuture = next;
+    }
+    pthread_mutex_unlock(&future->lock);
+    if (ready && future->error != NULL) futureFail(next, future->error);
+    else if (ready) executorEnqueue(executor, fn, future->result, next);
+    return next;
+}
+
+// Records the pending driver error (or what, if there is none) as the workflow's failure.
+static WorkflowStatus workflowFail(Workflow* workflow, const char* what) {
+    if (check_error()) {
+        Error* error = get_last_error();
+        char* errcode = error_code(error);
+        char* errmsg = error_message(error);
+        snprintf(workflow->error, sizeof(workflow->error), "%s: %s: %s", what, errcode, errmsg);
+        string_free(errmsg);
+        string_free(errcode);
+        error_drop(error);
+    } else snprintf(workflow->error, sizeof(workflow->error), "%s", what);
+    return WORKFLOW_FAILED;
+}
+
+static void workflowRelease(Workflow* workflow) {
+    if (workflow->answers != NULL) concept_map_iterator_drop(workflow->answers);
+    if (workflow->moreAnswers != NULL) concept_map_iterator_drop(workflow->moreAnswers);
+    if (workflow->documents != NULL) string_iterator_drop(workflow->documents);
+    if (workflow->commit != NULL) {
+        void_promise_resolve(workflow->commit); // promises are only freed on resolution
+        if (check_error()) error_drop(get_last_error());
+    }
+    if (workflow->tx != NULL) transaction_close(workflow->tx);
+    options_drop(workflow->opts);
+    workflow->answers = workflow->moreAnswers = NULL;
+    workflow->documents = NULL;
+    workflow->commit = NULL;
+    workflow->tx = NULL;
+    workflow->opts = NULL;
+}
+
+static void* workflowRun(void* arg) {
+    Workflow* workflow = (Workflow*)arg;
+    WorkflowStatus status = workflow->step(workflow);
+    if (status == WORKFLOW_YIELD) {
+        executorEnqueue(workflow->executor, workflowRun, workflow, NULL);
+        return NULL;
+    }
+    workflowRelease(workflow);
+    if (status == WORKFLOW_DONE) futureComplete(workflow->future, (void*)(intptr_t)workflow->result);
+    else futureFail(workflow->future, workflow->error);
+    return NULL;
+}
+
+// Starts the workflow on the executor. The workflow must stay alive until its future settles.
+Future* workflowStart(Executor* executor, Workflow* workflow, WorkflowStep step, Session* session) {
+    workflow->step = step;
+    workflow->state = 0;
+    workflow->executor = executor;
+    workflow->session = session;
+    workflow->opts = options_new();
+    workflow->future = futureNew();
+    executorEnqueue(executor, workflowRun, workflow, NULL);
+    return workflow->future;
+}
+
+static long drainConceptMaps(ConceptMapIterator* answers) {
+    long count = 0;
+    ConceptMap* cm = NULL;
+    while ((cm = concept_map_iterator_next(answers)) != NULL) {
+        concept_map_drop(cm);
+        count++;
+    }
+    return count;
+}
+
+// fetchAllUsers: completes with the number of users.
+static WorkflowStatus fetchAllUsersStep(Workflow* workflow) {
+    if (workflow->state++ == 0) {
+        workflow->tx = transaction_new(workflow->session, Read, workflow->opts);
+        if (workflow->tx == NULL || check_error()) return workflowFail(workflow, "Failed to start transaction");
+        workflow->documents = query_fetch(workflow->tx, "match $u isa user; fetch $u: full-name, email;", workflow->opts);
+        if (workflow->documents == NULL || check_error()) return workflowFail(workflow, "Failed to fetch users");
+        return WORKFLOW_YIELD;
+    }
+    char* document = NULL;
+    while ((document = string_iterator_next(workflow->documents)) != NULL) {
+        string_free(document);
+        workflow->result++;
+    }
+    return check_error() ? workflowFail(workflow, "Failed to read users") : WORKFLOW_DONE;
+}
+
+// getFilesByUser: completes with the number of files the user can view, or fails when the name does
+// not identify exactly one user. As in getFilesByUser, the files query is sent with the user check
+// only when inference is off.
+static WorkflowStatus getFilesByUserStep(Workflow* workflow) {
+    char query[512];
+    switch (workflow->state++) {
+    case 0: {
+        options_set_infer(workflow->opts, workflow->inference);
+        workflow->tx = transaction_new(workflow->session, Read, workflow->opts);
+        if (workflow->tx == NULL || check_error()) return workflowFail(workflow, "Failed to start transaction");
+        char name[256];
+        if (!escapeTypeQL(workflow->name, name, sizeof(name))) return workflowFail(workflow, "User name is too long");
+        snprintf(query, sizeof(query), "match $u isa user, has full-name '%s'; get;", name);
+        workflow->answers = query_get(workflow->tx, query, workflow->opts);
+        if (workflow->answers == NULL || check_error()) return workflowFail(workflow, "Failed to look up the user");
+        if (workflow->inference) return WORKFLOW_YIELD;
+        // Without inference the files query is dispatched right away.
+    }
+    // fall through
+    case 1: {
+        if (workflow->inference) { // the user check comes first
+            long users = drainConceptMaps(workflow->answers);
+            if (check_error()) return workflowFail(workflow, "Failed to look up the user");
+            if (users != 1) return workflowFail(workflow, users == 0 ? "No users found with that name" : "Found more than one user with that name");
+            concept_map_iterator_drop(workflow->answers);
+            workflow->answers = NULL;
+        }
+        char name[256];
+        escapeTypeQL(workflow->name, name, sizeof(name));
+        snprintf(query, sizeof(query), "match $fn == '%s'; $u isa user, has full-name $fn; $p($u, $pa) isa permission; $o isa object, has path $fp; $pa($o, $va) isa access; $va isa action, has name 'view_file'; get $fp;", name);
+        workflow->moreAnswers = query_get(workflow->tx, query, workflow->opts);
+        if (workflow->moreAnswers == NULL || check_error()) return workflowFail(workflow, "Failed to look up files");
+        workflow->state = 2;
+        return WORKFLOW_YIELD;
+    }
+    default:
+        if (workflow->answers != NULL) {
+            long users = drainConceptMaps(workflow->answers);
+            if (check_error()) return workflowFail(workflow, "Failed to look up the user");
+            if (users != 1) return workflowFail(workflow, users == 0 ? "No users found with that name" : "Found more than one user with that name");
+        }
+        workflow->result = drainConceptMaps(workflow->moreAnswers);
+        return check_error() ? workflowFail(workflow, "Failed to read files") : WORKFLOW_DONE;
+    }
+}
+
+// updateFilePath: completes with the number of files renamed once the commit has succeeded.
+WorkflowStatus updateFilePathStep(Workflow* workflow) {
+    switch (workflow->state++) {
+    case 0: {
+        workflow->tx = transaction_new(workflow->session, Write, workflow->opts);
+        if (workflow->tx == NULL || check_error()) return workflowFail(workflow, "Failed to start transaction");
+        char* oldPath = escapeTypeQLCopy(workflow->oldPath);
+        char* newPath = escapeTypeQLCopy(workflow->newPath);
+        size_t size = strlen(oldPath) + strlen(newPath) + 160;
+        char* query = malloc(size);
+        snprintf(query, size, "match $f isa file, has path $old_path; $old_path = '%s'; delete $f has $old_path; insert $f has path $new_path; $new_path = '%s';", oldPath, newPath);
+        workflow->answers = query_update(workflow->tx, query, workflow->opts);
+        free(query);
+        free(newPath);
+        free(oldPath);
+        if (workflow->answers == NULL || check_error()) return workflowFail(workflow, "Failed to update the file path");
+        return WORKFLOW_YIELD;
+    }
+    case 1:
+        workflow->result = drainConceptMaps(workflow->answers);
+        if (check_error()) return workflowFail(workflow, "Failed to update the file path");
+        concept_map_iterator_drop(workflow->answers);
+        workflow->answers = NULL;
+        workflow->commit = transaction_commit(workflow->tx);
+        workflow->tx = NULL; // committing consumes the transaction
+        if (workflow->commit == NULL || check_error()) return workflowFail(workflow, "Failed to commit");
+        return WORKFLOW_YIELD;
+    default:
+        void_promise_resolve(workflow->commit);
+        workflow->commit = NULL;
+        if (check_error()) return workflowFail(workflow, "Failed to commit");
+        if (workflow->result > 0) notifyFilePathUpdated(workflow->oldPath, workflow->newPath);
+        return WORKFLOW_DONE;
+    }
+}
+
+// Runs many read workflows at once on a few threads over one shared session.
+void benchmarkWorkflows(DatabaseManager* dbManager, const char* dbName, const char* name, int workflowCount, int threads) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        options_drop(opts);
+        return;
+    }
+    Executor* executor = executorNew(threads);
+    Workflow* workflows = calloc(workflowCount, sizeof(Workflow));
+    Future** futures = malloc(workflowCount * sizeof(Future*));
+    double started = monotonicSeconds();
+    for (int i = 0; i < workflowCount; i++) {
+        workflows[i].name = name;
+        futures[i] = workflowStart(executor, &workflows[i], i % 2 ? getFilesByUserStep : fetchAllUsersStep, session);
+    }
+    int failed = 0;
+    long answers = 0;
+    for (int i = 0; i < workflowCount; i++) {
+        answers += (long)(intptr_t)futureAwait(futures[i]);
+        if (futureError(futures[i]) != NULL && failed++ == 0) fprintf(stderr, "Workflow failed: %s\n", futureError(futures[i]));
+        futureDrop(futures[i]);
+    }
+    double elapsed = monotonicSeconds() - started;
+    printf("Workflow benchmark: %d workflows on %d threads in %.3f s (%.0f workflows/s, %ld answers, %d failed)\n",
+           workflowCount, threads, elapsed, elapsed > 0 ? workflowCount / elapsed : 0.0, answers, failed);
+    executorShutdown(executor);
+    free(futures);
+    free(workflows);
+    session_close(session);
+    options_drop(opts);
+}
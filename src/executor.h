@@ -0,0 +1,81 @@
+#ifndef TUTORIAL_EXECUTOR_H
+#define TUTORIAL_EXECUTOR_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef void* (*TaskFn)(void* arg);
+typedef struct Executor Executor;
+
+typedef struct Future {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    bool ready;
+    void* result;
+    char* error;            // set instead of result when the task failed
+    Executor* thenExecutor; // continuation scheduled when the result is set
+    TaskFn thenFn;
+    struct Future* thenFuture;
+} Future;
+
+typedef struct Task {
+    TaskFn fn;
+    void* arg;
+    Future* future; // NULL for tasks that complete their own future, such as workflow steps
+    struct Task* next;
+} Task;
+
+struct Executor {
+    pthread_t* threads;
+    int threadCount;
+    Task* head;
+    Task* tail;
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    bool stopping;
+};
+
+typedef enum { WORKFLOW_DONE, WORKFLOW_YIELD, WORKFLOW_FAILED } WorkflowStatus;
+typedef struct Workflow Workflow;
+typedef WorkflowStatus (*WorkflowStep)(Workflow* workflow);
+
+// A tutorial workflow written as a state machine over driver promises and iterators. A step dispatches
+// its queries, which sends them without waiting for answers, and yields; the executor requeues the
+// workflow behind every other runnable step, so by the time it resolves the promise or drains the
+// iterator the answers have usually arrived. A few threads thereby keep the queries of thousands of
+// workflows in flight, where a blocking task would hold a thread per workflow. Driver errors fail the
+// workflow's future instead of exiting.
+struct Workflow {
+    WorkflowStep step;
+    int state;
+    Executor* executor;
+    Future* future;    // completes with result, or fails with error
+    Session* session;  // shared; owned by the caller
+    Options* opts;
+    Transaction* tx;
+    ConceptMapIterator* answers;
+    ConceptMapIterator* moreAnswers;
+    StringIterator* documents;
+    VoidPromise* commit;
+    const char* name;
+    const char* oldPath;
+    const char* newPath;
+    bool inference;
+    long result;
+    char error[256];
+};
+
+Future* futureNew(void);
+void futureDrop(Future* future);
+void futureComplete(Future* future, void* result);
+Executor* executorNew(int threadCount);
+void executorShutdown(Executor* executor);
+Future* executorSubmit(Executor* executor, TaskFn fn, void* arg);
+void* futureAwait(Future* future);
+const char* futureError(Future* future);
+Future* futureThen(Executor* executor, Future* future, TaskFn fn);
+Future* workflowStart(Executor* executor, Workflow* workflow, WorkflowStep step, Session* session);
+WorkflowStatus updateFilePathStep(Workflow* workflow);
+void benchmarkWorkflows(DatabaseManager* dbManager, const char* dbName, const char* name, int workflowCount, int threads);
+
+#endif
@@ -0,0 +1,511 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "export.h"
+#include "profiling.h"
+#include "columnar.h"
+#include "output_sink.h"
+
+#define EXPORT_BATCH_ROWS 65536
+#define EXPORT_SETTLE_BATCHES 15 // extra batches read ahead to type sparse Arrow columns
+#define EXPORT_BUFFER_SIZE (1 << 20)
+#define EXPORT_MAX_THREADS 16
+
+static void formatIsoMillis(int64_t millis, char* out, size_t size) {
+    time_t seconds = (time_t)(millis >= 0 ? millis / 1000 : (millis - 999) / 1000);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    size_t len = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(out + len, size - len, ".%03d", (int)(millis - (int64_t)seconds * 1000));
+}
+
+static void encodeCsvString(ByteBuffer* out, const char* text, size_t len) {
+    bool quote = false;
+    for (size_t i = 0; i < len && !quote; i++) quote = text[i] == ',' || text[i] == '"' || text[i] == '\r' || text[i] == '\n';
+    if (!quote) {
+        byteBufferAppend(out, text, len);
+        return;
+    }
+    byteBufferAppend(out, "\"", 1);
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '"') byteBufferAppend(out, "\"\"", 2);
+        else byteBufferAppend(out, &text[i], 1);
+    }
+    byteBufferAppend(out, "\"", 1);
+}
+
+static void encodeCell(ByteBuffer* out, const Column* column, size_t row, ExportFormat format) {
+    char scratch[48];
+    if (!column->valid[row]) {
+        if (format == EXPORT_NDJSON) byteBufferAppend(out, "null", 4);
+        return;
+    }
+    size_t len = 0;
+    switch (column->kind) {
+        case COLUMN_STRING: case COLUMN_IID: {
+            const char* text = columnString(column, row, &len);
+            if (format == EXPORT_NDJSON) encodeJsonString(out, text, len);
+            else encodeCsvString(out, text, len);
+            return;
+        }
+        case COLUMN_LONG: len = snprintf(scratch, sizeof(scratch), "%lld", (long long)column->longs[row]); break;
+        case COLUMN_DOUBLE: len = snprintf(scratch, sizeof(scratch), "%.17g", column->doubles[row]); break;
+        case COLUMN_BOOL: len = snprintf(scratch, sizeof(scratch), "%s", column->longs[row] ? "true" : "false"); break;
+        case COLUMN_DATETIME:
+            formatIsoMillis(column->longs[row], scratch, sizeof(scratch));
+            if (format == EXPORT_NDJSON) encodeJsonString(out, scratch, strlen(scratch));
+            else byteBufferAppend(out, scratch, strlen(scratch));
+            return;
+        default: return;
+    }
+    byteBufferAppend(out, scratch, len);
+}
+
+static void encodeRows(ByteBuffer* out, const ColumnBatch* batch, size_t from, size_t to, ExportFormat format) {
+    for (size_t row = from; row < to; row++) {
+        if (format == EXPORT_NDJSON) byteBufferAppend(out, "{", 1);
+        for (size_t c = 0; c < batch->columnCount; c++) {
+            if (c > 0) byteBufferAppend(out, ",", 1);
+            if (format == EXPORT_NDJSON) {
+                encodeJsonString(out, batch->columns[c].name, strlen(batch->columns[c].name));
+                byteBufferAppend(out, ":", 1);
+            }
+            encodeCell(out, &batch->columns[c], row, format);
+        }
+        byteBufferAppend(out, format == EXPORT_NDJSON ? "}\n" : "\n", format == EXPORT_NDJSON ? 2 : 1);
+    }
+}
+
+// Minimal front-to-back FlatBuffers writer for Arrow IPC metadata. Each table's vtable is written
+// just before it, and children are written after their parent so every uoffset points forward.
+typedef enum { FB_ABSENT, FB_SCALAR, FB_OFFSET } FbFieldKind;
+
+typedef struct {
+    FbFieldKind kind;
+    uint8_t size;
+    uint64_t value;
+    size_t position; // set by fbTable for FB_OFFSET fields, to be patched with fbPatch
+} FbField;
+
+static size_t fbTable(ByteBuffer* b, FbField* fields, int count) {
+    uint16_t vtable[2 + 16] = {0};
+    uint16_t offset = 4;
+    uint8_t alignment = 4;
+    for (int f = 0; f < count; f++) {
+        if (fields[f].kind == FB_ABSENT) continue;
+        uint8_t size = fields[f].kind == FB_OFFSET ? 4 : fields[f].size;
+        offset = (uint16_t)((offset + size - 1) / size * size);
+        vtable[2 + f] = offset;
+        offset += size;
+        if (size > alignment) alignment = size;
+    }
+    vtable[0] = (uint16_t)(4 + 2 * count);
+    vtable[1] = (uint16_t)((offset + 3) / 4 * 4);
+    byteBufferPad(b, 2);
+    size_t vtablePosition = b->size;
+    byteBufferAppend(b, vtable, vtable[0]);
+    byteBufferPad(b, alignment);
+    size_t tablePosition = b->size;
+    int32_t soffset = (int32_t)(tablePosition - vtablePosition);
+    byteBufferReserve(b, vtable[1]);
+    memset(b->data + tablePosition, 0, vtable[1]);
+    b->size += vtable[1];
+    byteBufferPatch(b, tablePosition, &soffset, 4);
+    for (int f = 0; f < count; f++) {
+        if (fields[f].kind == FB_ABSENT) continue;
+        fields[f].position = tablePosition + vtable[2 + f];
+        if (fields[f].kind == FB_SCALAR) byteBufferPatch(b, fields[f].position, &fields[f].value, fields[f].size); // little-endian
+    }
+    return tablePosition;
+}
+
+static void fbPatch(ByteBuffer* b, size_t fieldPosition, size_t target) {
+    uint32_t offset = (uint32_t)(target - fieldPosition);
+    byteBufferPatch(b, fieldPosition, &offset, 4);
+}
+
+// Starts a vector whose elements are aligned to elementAlignment and returns the element start.
+static size_t fbVector(ByteBuffer* b, uint32_t count, size_t elementSize, size_t elementAlignment, size_t* vectorPosition) {
+    size_t alignment = elementAlignment > 4 ? elementAlignment : 4;
+    while ((b->size + 4) % alignment != 0 || b->size % 4 != 0) byteBufferAppend(b, "", 1);
+    *vectorPosition = b->size;
+    byteBufferAppend(b, &count, 4);
+    size_t elements = b->size;
+    byteBufferReserve(b, count * elementSize);
+    memset(b->data + elements, 0, count * elementSize);
+    b->size += count * elementSize;
+    return elements;
+}
+
+static size_t fbString(ByteBuffer* b, const char* text) {
+    byteBufferPad(b, 4);
+    size_t position = b->size;
+    uint32_t len = (uint32_t)strlen(text);
+    byteBufferAppend(b, &len, 4);
+    byteBufferAppend(b, text, len + 1);
+    return position;
+}
+
+enum { ARROW_HEADER_SCHEMA = 1, ARROW_HEADER_RECORD_BATCH = 3 };
+enum { ARROW_TYPE_INT = 2, ARROW_TYPE_FLOATING_POINT = 3, ARROW_TYPE_UTF8 = 5, ARROW_TYPE_BOOL = 6, ARROW_TYPE_TIMESTAMP = 10, ARROW_TYPE_NULL = 1 };
+
+// Writes the Message table and returns the position of its header offset field for patching; the
+// position of the bodyLength field is stored in bodyLengthField when it is not NULL.
+static size_t arrowMessage(ByteBuffer* b, uint8_t headerType, int64_t bodyLength, size_t* bodyLengthField) {
+    size_t root = b->size;
+    byteBufferAppend(b, "\0\0\0\0", 4);
+    FbField message[] = {
+        {FB_SCALAR, 2, 4, 0},                 // version: V5
+        {FB_SCALAR, 1, headerType, 0},        // header_type
+        {FB_OFFSET, 4, 0, 0},                 // header
+        {FB_SCALAR, 8, (uint64_t)bodyLength, 0},
+    };
+    fbPatch(b, root, fbTable(b, message, 4));
+    if (bodyLengthField != NULL) *bodyLengthField = message[3].position;
+    return message[2].position;
+}
+
+static void arrowSchemaMetadata(ByteBuffer* b, const ColumnBatch* batch) {
+    size_t headerField = arrowMessage(b, ARROW_HEADER_SCHEMA, 0, NULL);
+    FbField schema[] = {{FB_SCALAR, 2, 0, 0}, {FB_OFFSET, 4, 0, 0}}; // endianness: little, fields
+    fbPatch(b, headerField, fbTable(b, schema, 2));
+    size_t vectorPosition;
+    size_t elements = fbVector(b, (uint32_t)batch->columnCount, 4, 4, &vectorPosition);
+    fbPatch(b, schema[1].position, vectorPosition);
+    for (size_t c = 0; c < batch->columnCount; c++) {
+        const Column* column = &batch->columns[c];
+        uint8_t type = ARROW_TYPE_NULL;
+        switch (column->kind) {
+            case COLUMN_STRING: case COLUMN_IID: type = ARROW_TYPE_UTF8; break;
+            case COLUMN_LONG: type = ARROW_TYPE_INT; break;
+            case COLUMN_DOUBLE: type = ARROW_TYPE_FLOATING_POINT; break;
+            case COLUMN_BOOL: type = ARROW_TYPE_BOOL; break;
+            case COLUMN_DATETIME: type = ARROW_TYPE_TIMESTAMP; break;
+            default: break;
+        }
+        FbField field[] = {{FB_OFFSET, 4, 0, 0}, {FB_SCALAR, 1, 1, 0}, {FB_SCALAR, 1, type, 0}, {FB_OFFSET, 4, 0, 0}, {FB_ABSENT, 0, 0, 0}, {FB_OFFSET, 4, 0, 0}};
+        fbPatch(b, elements + 4 * c, fbTable(b, field, 6));
+        fbPatch(b, field[0].position, fbString(b, column->name));
+        FbField typeFields[2] = {{FB_ABSENT, 0, 0, 0}, {FB_ABSENT, 0, 0, 0}};
+        int typeFieldCount = 0;
+        if (type == ARROW_TYPE_INT) {
+            typeFields[0] = (FbField){FB_SCALAR, 4, 64, 0}; // bitWidth
+            typeFields[1] = (FbField){FB_SCALAR, 1, 1, 0};  // is_signed
+            typeFieldCount = 2;
+        } else if (type == ARROW_TYPE_FLOATING_POINT || type == ARROW_TYPE_TIMESTAMP) {
+            typeFields[0] = (FbField){FB_SCALAR, 2, type == ARROW_TYPE_FLOATING_POINT ? 2 : 1, 0}; // DOUBLE / MILLISECOND
+            typeFieldCount = 1;
+        }
+        fbPatch(b, field[3].position, fbTable(b, typeFields, typeFieldCount));
+        size_t childrenPosition;
+        fbVector(b, 0, 4, 4, &childrenPosition);
+        fbPatch(b, field[5].position, childrenPosition);
+    }
+}
+
+static void arrowAppendBuffer(ByteBuffer* body, ByteBuffer* meta, size_t* bufferSlot, const void* data, size_t len) {
+    int64_t entry[2] = {(int64_t)body->size, (int64_t)len};
+    byteBufferPatch(meta, *bufferSlot, entry, sizeof(entry));
+    *bufferSlot += sizeof(entry);
+    if (len > 0) byteBufferAppend(body, data, len);
+    byteBufferPad(body, 8);
+}
+
+static void arrowBitmap(ByteBuffer* scratch, size_t rows, const uint8_t* bytes, const int64_t* values) {
+    scratch->size = 0;
+    byteBufferReserve(scratch, (rows + 7) / 8);
+    memset(scratch->data, 0, (rows + 7) / 8);
+    for (size_t row = 0; row < rows; row++) {
+        if (bytes != NULL ? bytes[row] : values[row] != 0) scratch->data[row / 8] |= (char)(1 << (row % 8));
+    }
+    scratch->size = (rows + 7) / 8;
+}
+
+static void arrowRecordBatch(ByteBuffer* meta, ByteBuffer* body, ByteBuffer* scratch, const ColumnBatch* batch) {
+    size_t buffers = 0;
+    for (size_t c = 0; c < batch->columnCount; c++) buffers += columnKindIsString(batch->columns[c].kind) ? 3 : batch->columns[c].kind == COLUMN_NULL ? 0 : 2;
+    size_t bodyLengthField;
+    size_t headerField = arrowMessage(meta, ARROW_HEADER_RECORD_BATCH, 0, &bodyLengthField);
+    FbField recordBatch[] = {{FB_SCALAR, 8, batch->rows, 0}, {FB_OFFSET, 4, 0, 0}, {FB_OFFSET, 4, 0, 0}};
+    fbPatch(meta, headerField, fbTable(meta, recordBatch, 3));
+    size_t nodesPosition;
+    size_t nodes = fbVector(meta, (uint32_t)batch->columnCount, 16, 8, &nodesPosition);
+    fbPatch(meta, recordBatch[1].position, nodesPosition);
+    size_t buffersPosition;
+    size_t bufferSlot = fbVector(meta, (uint32_t)buffers, 16, 8, &buffersPosition);
+    fbPatch(meta, recordBatch[2].position, buffersPosition);
+
+    body->size = 0;
+    for (size_t c = 0; c < batch->columnCount; c++) {
+        const Column* column = &batch->columns[c];
+        int64_t node[2] = {(int64_t)batch->rows, (int64_t)(column->kind == COLUMN_NULL ? batch->rows : column->nulls)};
+        byteBufferPatch(meta, nodes + 16 * c, node, sizeof(node));
+        if (column->kind == COLUMN_NULL) continue;
+        arrowBitmap(scratch, batch->rows, column->valid, NULL);
+        arrowAppendBuffer(body, meta, &bufferSlot, scratch->data, scratch->size);
+        if (columnKindIsString(column->kind)) {
+            arrowAppendBuffer(body, meta, &bufferSlot, column->offsets, (batch->rows + 1) * sizeof(int32_t));
+            arrowAppendBuffer(body, meta, &bufferSlot, column->data, (size_t)column->offsets[batch->rows]);
+        } else if (column->kind == COLUMN_BOOL) {
+            arrowBitmap(scratch, batch->rows, NULL, column->longs);
+            arrowAppendBuffer(body, meta, &bufferSlot, scratch->data, scratch->size);
+        } else if (column->kind == COLUMN_DOUBLE) {
+            arrowAppendBuffer(body, meta, &bufferSlot, column->doubles, batch->rows * sizeof(double));
+        } else {
+            arrowAppendBuffer(body, meta, &bufferSlot, column->longs, batch->rows * sizeof(int64_t));
+        }
+    }
+    int64_t bodyLength = (int64_t)body->size;
+    byteBufferPatch(meta, bodyLengthField, &bodyLength, 8);
+}
+
+typedef struct {
+    FILE* file;
+    char* path;
+    ExportFormat format;
+    int threads;
+    OutputSink sink;
+    ByteBuffer parts[EXPORT_MAX_THREADS]; // per-thread encoding buffers
+    ByteBuffer meta;
+    ByteBuffer body;
+    ByteBuffer scratch;
+    ColumnBatch* schema; // column names, and for Arrow the kinds declared in the schema
+    bool started;
+    bool failed; // the export stopped early; the partial file is removed on close
+    size_t rows;
+    double openedAt;
+} Exporter;
+
+typedef struct {
+    ByteBuffer* out;
+    const ColumnBatch* batch;
+    size_t from;
+    size_t to;
+    ExportFormat format;
+} EncodeJob;
+
+static void* encodeJob(void* arg) {
+    EncodeJob* job = (EncodeJob*)arg;
+    job->out->size = 0;
+    encodeRows(job->out, job->batch, job->from, job->to, job->format);
+    return NULL;
+}
+
+static void exporterWrite(Exporter* exporter, const void* data, size_t len) {
+    sinkWrite(&exporter->sink, data, len);
+}
+
+// Writes an encapsulated IPC message: continuation marker, padded metadata length, metadata, body.
+static void exporterWriteArrowMessage(Exporter* exporter, ByteBuffer* meta, const ByteBuffer* body) {
+    byteBufferPad(meta, 8);
+    uint32_t prefix[2] = {0xFFFFFFFFu, (uint32_t)meta->size};
+    exporterWrite(exporter, prefix, sizeof(prefix));
+    exporterWrite(exporter, meta->data, meta->size);
+    if (body != NULL) exporterWrite(exporter, body->data, body->size);
+}
+
+// vars names the columns of the batches to come, so an empty result still gets its CSV header or Arrow
+// schema; NDJSON exports pass no columns.
+static Exporter* exporterOpen(const char* path, ExportFormat format, int threads, const char* const* vars, size_t varCount) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open export file %s.\n", path);
+        return NULL;
+    }
+    Exporter* exporter = calloc(1, sizeof(Exporter));
+    exporter->file = file;
+    exporter->path = strdup(path);
+    sinkInit(&exporter->sink, fileno(file), EXPORT_BUFFER_SIZE, true, NULL);
+    exporter->format = format;
+    exporter->threads = threads < 1 ? 1 : threads > EXPORT_MAX_THREADS ? EXPORT_MAX_THREADS : threads;
+    exporter->schema = columnBatchNew(vars, varCount);
+    exporter->openedAt = monotonicSeconds();
+    return exporter;
+}
+
+// Writes the Arrow schema or CSV header for the columns in schema.
+static void exporterWriteHeader(Exporter* exporter, const ColumnBatch* schema) {
+    if (exporter->format == EXPORT_ARROW) {
+        exporter->meta.size = 0;
+        arrowSchemaMetadata(&exporter->meta, schema);
+        exporterWriteArrowMessage(exporter, &exporter->meta, NULL);
+    } else if (exporter->format == EXPORT_CSV) {
+        ByteBuffer* header = &exporter->parts[0];
+        header->size = 0;
+        for (size_t c = 0; c < schema->columnCount; c++) {
+            if (c > 0) byteBufferAppend(header, ",", 1);
+            encodeCsvString(header, schema->columns[c].name, strlen(schema->columns[c].name));
+        }
+        byteBufferAppend(header, "\n", 1);
+        exporterWrite(exporter, header->data, header->size);
+    }
+    exporter->started = true;
+}
+
+// Arrow batches must match the schema's column types: a column declared Null cannot carry values later.
+static bool exporterBatchMatchesSchema(const Exporter* exporter, const ColumnBatch* batch) {
+    if (batch->columnCount != exporter->schema->columnCount) return false;
+    for (size_t c = 0; c < batch->columnCount; c++) {
+        if (batch->columns[c].kind != exporter->schema->columns[c].kind) return false;
+    }
+    return true;
+}
+
+// Appends a batch. For Arrow, the column types are taken from the first batch, so columns that are
+// entirely null in it are declared Null; later batches must keep those types or they are rejected.
+static bool exporterWriteBatch(Exporter* exporter, const ColumnBatch* batch) {
+    if (exporter->format == EXPORT_ARROW) {
+        if (!exporter->started) {
+            for (size_t c = 0; c < batch->columnCount && c < exporter->schema->columnCount; c++) exporter->schema->columns[c].kind = batch->columns[c].kind;
+            exporterWriteHeader(exporter, exporter->schema);
+        }
+        if (!exporterBatchMatchesSchema(exporter, batch)) {
+            fprintf(stderr, "Export batch does not match the Arrow schema; a column that was null throughout the first batch has values.\n");
+            return false;
+        }
+        exporter->meta.size = 0;
+        arrowRecordBatch(&exporter->meta, &exporter->body, &exporter->scratch, batch);
+        exporterWriteArrowMessage(exporter, &exporter->meta, &exporter->body);
+    } else {
+        if (!exporter->started) exporterWriteHeader(exporter, exporter->schema);
+        int threads = batch->rows >= 4096 ? exporter->threads : 1;
+        EncodeJob jobs[EXPORT_MAX_THREADS];
+        pthread_t workers[EXPORT_MAX_THREADS];
+        size_t share = (batch->rows + threads - 1) / threads;
+        for (int t = 0; t < threads; t++) {
+            size_t from = t * share < batch->rows ? t * share : batch->rows;
+            jobs[t] = (EncodeJob){&exporter->parts[t], batch, from, from + share < batch->rows ? from + share : batch->rows, exporter->format};
+            if (threads > 1) pthread_create(&workers[t], NULL, encodeJob, &jobs[t]);
+            else encodeJob(&jobs[t]);
+        }
+        for (int t = 0; t < threads; t++) {
+            if (threads > 1) pthread_join(workers[t], NULL);
+            exporterWrite(exporter, exporter->parts[t].data, exporter->parts[t].size);
+        }
+    }
+    exporter->rows += batch->rows;
+    return true;
+}
+
+// Appends one fetch answer as an NDJSON line.
+static void exporterWriteJson(Exporter* exporter, const char* json) {
+    exporterWrite(exporter, json, strlen(json));
+    exporterWrite(exporter, "\n", 1);
+    exporter->rows++;
+}
+
+// Finishes the file and returns the number of rows written, or EXPORT_FAILED after removing the file if
+// the export stopped early.
+static size_t exporterClose(Exporter* exporter) {
+    if (!exporter->failed && !exporter->started) exporterWriteHeader(exporter, exporter->schema);
+    if (!exporter->failed && exporter->format == EXPORT_ARROW) {
+        uint32_t endOfStream[2] = {0xFFFFFFFFu, 0};
+        exporterWrite(exporter, endOfStream, sizeof(endOfStream));
+    }
+    sinkClose(&exporter->sink);
+    fclose(exporter->file);
+    double seconds = monotonicSeconds() - exporter->openedAt;
+    size_t rows = exporter->rows;
+    if (exporter->failed) {
+        remove(exporter->path);
+        fprintf(stderr, "Export to %s failed; the partial file was removed.\n", exporter->path);
+        rows = EXPORT_FAILED;
+    } else {
+        printf("Exported %zu rows in %.2f s (%.0f rows/s).\n", rows, seconds, seconds > 0 ? rows / seconds : 0.0);
+    }
+    free(exporter->path);
+    for (int t = 0; t < EXPORT_MAX_THREADS; t++) byteBufferFree(&exporter->parts[t]);
+    byteBufferFree(&exporter->meta);
+    byteBufferFree(&exporter->body);
+    byteBufferFree(&exporter->scratch);
+    columnBatchDrop(exporter->schema);
+    free(exporter);
+    return rows;
+}
+
+// Streams a get query into a file, EXPORT_BATCH_ROWS answers at a time. For Arrow, the first batch is
+// extended by up to EXPORT_SETTLE_BATCHES more reads while some column has no value yet, so sparse
+// columns get their real type in the schema. Returns the number of rows exported, or EXPORT_FAILED if
+// the query failed or a later batch did not match the schema; no file is left behind then.
+size_t exportQueryGet(DatabaseManager* dbManager, const char* dbName, const char* query, const char* const* vars, size_t varCount, bool inference, const char* path, ExportFormat format, int threads) {
+    Options* opts = options_new();
+    options_set_infer(opts, inference);
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        session_close(session);
+        exit(EXIT_FAILURE);
+    }
+    size_t rows = EXPORT_FAILED;
+    ConceptMapIterator* it = query_get(tx, query, opts);
+    Exporter* exporter = it != NULL && !FAILED() ? exporterOpen(path, format, threads, vars, varCount) : NULL;
+    if (exporter != NULL) {
+        ColumnBatch* batch = columnBatchNew(vars, varCount);
+        int settle = format == EXPORT_ARROW ? EXPORT_SETTLE_BATCHES : 0;
+        while (materializeConceptMaps(it, batch, EXPORT_BATCH_ROWS) > 0) {
+            for (; settle > 0 && columnBatchHasNullKind(batch); settle--) {
+                if (materializeConceptMaps(it, batch, EXPORT_BATCH_ROWS) == 0) break;
+            }
+            settle = 0;
+            if (!exporterWriteBatch(exporter, batch)) {
+                exporter->failed = true;
+                break;
+            }
+            columnBatchClear(batch);
+        }
+        if (batch->failed) exporter->failed = true;
+        columnBatchDrop(batch);
+        rows = exporterClose(exporter);
+    }
+    concept_map_iterator_drop(it);
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+    return rows;
+}
+
+// Streams fetch answers into an NDJSON file, one answer per line. Returns the number of rows exported,
+// or EXPORT_FAILED.
+size_t exportQueryFetch(DatabaseManager* dbManager, const char* dbName, const char* query, const char* path) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        session_close(session);
+        exit(EXIT_FAILURE);
+    }
+    size_t rows = EXPORT_FAILED;
+    StringIterator* it = query_fetch(tx, query, opts);
+    Exporter* exporter = it != NULL && !FAILED() ? exporterOpen(path, EXPORT_NDJSON, 1, NULL, 0) : NULL;
+    if (exporter != NULL) {
+        char* answer = NULL;
+        while ((answer = string_iterator_next(it)) != NULL) {
+            exporterWriteJson(exporter, answer);
+            string_free(answer);
+        }
+        if (FAILED()) {
+            fprintf(stderr, "Export query failed.\n");
+            exporter->failed = true;
+        }
+        rows = exporterClose(exporter);
+    }
+    string_iterator_drop(it);
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+    return rows;
+}
@@ -0,0 +1,15 @@
+#ifndef TUTORIAL_EXPORT_H
+#define TUTORIAL_EXPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum { EXPORT_NDJSON, EXPORT_CSV, EXPORT_ARROW } ExportFormat;
+
+// Returned by the exports when they fail; the partial file is removed.
+#define EXPORT_FAILED ((size_t)-1)
+
+size_t exportQueryGet(DatabaseManager* dbManager, const char* dbName, const char* query, const char* const* vars, size_t varCount, bool inference, const char* path, ExportFormat format, int threads);
+size_t exportQueryFetch(DatabaseManager* dbManager, const char* dbName, const char* query, const char* path);
+
+#endif
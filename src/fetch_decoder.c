@@ -0,0 +1,312 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/typedb_driver.h"
+#include "../include/cJSON.h"
+#include "tutorial.h"
+#include "fetch_decoder.h"
+#include "profiling.h"
+
+typedef enum { FIELD_STRING, FIELD_LONG, FIELD_DOUBLE, FIELD_BOOL } FetchFieldKind;
+
+// Maps the first value of one fetched attribute (answer[var][attribute][0].value) to a struct member.
+typedef struct {
+    const char* var;
+    const char* attribute;
+    FetchFieldKind kind;
+    size_t offset;
+    size_t capacity; // destination buffer size for FIELD_STRING
+} FetchField;
+
+static const FetchField USER_RECORD_FIELDS[] = {
+    {"u", "full-name", FIELD_STRING, offsetof(UserRecord, fullName), sizeof(((UserRecord*)0)->fullName)},
+    {"u", "email", FIELD_STRING, offsetof(UserRecord, email), sizeof(((UserRecord*)0)->email)},
+};
+#define USER_RECORD_FIELD_COUNT (sizeof(USER_RECORD_FIELDS) / sizeof(USER_RECORD_FIELDS[0]))
+
+typedef struct {
+    const char* p;
+} JsonCursor;
+
+static void jsonSkipWhitespace(JsonCursor* c) {
+    while (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r') c->p++;
+}
+
+static bool jsonExpect(JsonCursor* c, char ch) {
+    jsonSkipWhitespace(c);
+    if (*c->p != ch) return false;
+    c->p++;
+    return true;
+}
+
+// Scans a string token and returns its raw (still escaped) contents.
+static bool jsonRawString(JsonCursor* c, const char** start, size_t* len) {
+    if (!jsonExpect(c, '"')) return false;
+    *start = c->p;
+    while (*c->p != '"') {
+        if (*c->p == '\0') return false;
+        if (*c->p == '\\' && c->p[1] != '\0') c->p++;
+        c->p++;
+    }
+    *len = (size_t)(c->p - *start);
+    c->p++;
+    return true;
+}
+
+static bool jsonKeyEquals(const char* start, size_t len, const char* name) {
+    return strlen(name) == len && memcmp(start, name, len) == 0;
+}
+
+static size_t utf8Encode(uint32_t cp, char* out) {
+    if (cp < 0x80) { out[0] = (char)cp; return 1; }
+    if (cp < 0x800) { out[0] = (char)(0xC0 | (cp >> 6)); out[1] = (char)(0x80 | (cp & 0x3F)); return 2; }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12)); out[1] = (char)(0x80 | ((cp >> 6) & 0x3F)); out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18)); out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static bool jsonHex4(const char* p, uint32_t* value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        char h = p[i];
+        int digit = h >= '0' && h <= '9' ? h - '0' : h >= 'a' && h <= 'f' ? h - 'a' + 10 : h >= 'A' && h <= 'F' ? h - 'A' + 10 : -1;
+        if (digit < 0) return false;
+        *value = (*value << 4) | (uint32_t)digit;
+    }
+    return true;
+}
+
+// Unescapes a raw JSON string into out, truncating to capacity - 1 bytes.
+bool jsonUnescape(const char* raw, size_t len, char* out, size_t capacity) {
+    size_t n = 0;
+    char utf8[4];
+    for (size_t i = 0; i < len; i++) {
+        const char* chunk = &raw[i];
+        size_t chunkLen = 1;
+        if (raw[i] == '\\') {
+            if (++i >= len) return false;
+            switch (raw[i]) {
+                case '"': case '\\': case '/': chunk = &raw[i]; break;
+                case 'b': chunk = "\b"; break;
+                case 'f': chunk = "\f"; break;
+                case 'n': chunk = "\n"; break;
+                case 'r': chunk = "\r"; break;
+                case 't': chunk = "\t"; break;
+                case 'u': {
+                    uint32_t cp;
+                    if (i + 4 >= len || !jsonHex4(&raw[i + 1], &cp)) return false;
+                    i += 4;
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        uint32_t low;
+                        if (i + 6 >= len || raw[i + 1] != '\\' || raw[i + 2] != 'u' || !jsonHex4(&raw[i + 3], &low)) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                    chunkLen = utf8Encode(cp, utf8);
+                    chunk = utf8;
+                    break;
+                }
+                default: return false;
+            }
+        }
+        if (n + chunkLen < capacity) {
+            memcpy(out + n, chunk, chunkLen);
+            n += chunkLen;
+        }
+    }
+    if (capacity > 0) out[n] = '\0';
+    return true;
+}
+
+static bool jsonSkipValue(JsonCursor* c) {
+    jsonSkipWhitespace(c);
+    const char* start;
+    size_t len;
+    switch (*c->p) {
+        case '"': return jsonRawString(c, &start, &len);
+        case '{': case '[': {
+            char close = *c->p == '{' ? '}' : ']';
+            c->p++;
+            if (jsonExpect(c, close)) return true;
+            do {
+                if (close == '}' && (!jsonRawString(c, &start, &len) || !jsonExpect(c, ':'))) return false;
+                if (!jsonSkipValue(c)) return false;
+            } while (jsonExpect(c, ','));
+            return jsonExpect(c, close);
+        }
+        default:
+            if (*c->p == '\0') return false;
+            while (*c->p && !strchr(",}] \t\r\n", *c->p)) c->p++;
+            return true;
+    }
+}
+
+static bool jsonDecodeScalar(JsonCursor* c, const FetchField* field, void* out) {
+    char* dest = (char*)out + field->offset;
+    jsonSkipWhitespace(c);
+    const char* start = c->p;
+    if (field->kind == FIELD_STRING) {
+        size_t len;
+        return jsonRawString(c, &start, &len) && jsonUnescape(start, len, dest, field->capacity);
+    }
+    if (!jsonSkipValue(c)) return false;
+    char* end = NULL;
+    switch (field->kind) {
+        case FIELD_LONG: *(int64_t*)dest = strtoll(start, &end, 10); break;
+        case FIELD_DOUBLE: *(double*)dest = strtod(start, &end); break;
+        default:
+            *(bool*)dest = strncmp(start, "true", 4) == 0;
+            end = (char*)start + (*(bool*)dest ? 4 : strncmp(start, "false", 5) == 0 ? 5 : 0);
+    }
+    return end == c->p;
+}
+
+// Decodes the first element of an attribute array: [{"value": ..., "value_type": ..., "type": {...}}, ...].
+static bool jsonDecodeAttribute(JsonCursor* c, const FetchField* field, void* out, bool* found) {
+    const char* key;
+    size_t keyLen;
+    if (!jsonExpect(c, '[')) return false;
+    if (jsonExpect(c, ']')) return true;
+    if (!jsonExpect(c, '{')) return false;
+    if (!jsonExpect(c, '}')) {
+        do {
+            if (!jsonRawString(c, &key, &keyLen) || !jsonExpect(c, ':')) return false;
+            if (jsonKeyEquals(key, keyLen, "value")) {
+                if (!jsonDecodeScalar(c, field, out)) return false;
+                *found = true;
+            } else if (!jsonSkipValue(c)) return false;
+        } while (jsonExpect(c, ','));
+        if (!jsonExpect(c, '}')) return false;
+    }
+    while (jsonExpect(c, ',')) {
+        if (!jsonSkipValue(c)) return false;
+    }
+    return jsonExpect(c, ']');
+}
+
+// Decodes one fetch answer straight into out without building a tree. Keys are compared unescaped,
+// which holds for TypeQL variable names and type labels. Returns the number of fields set, or -1 if
+// the answer is malformed.
+static int decodeFetchAnswer(const char* json, const FetchField* fields, size_t fieldCount, void* out) {
+    JsonCursor c = { json };
+    const char* var;
+    const char* attribute;
+    size_t varLen;
+    size_t attributeLen;
+    int decoded = 0;
+    if (!jsonExpect(&c, '{')) return -1;
+    if (jsonExpect(&c, '}')) return 0;
+    do {
+        if (!jsonRawString(&c, &var, &varLen) || !jsonExpect(&c, ':')) return -1;
+        jsonSkipWhitespace(&c);
+        bool wanted = false;
+        for (size_t f = 0; f < fieldCount; f++) wanted |= jsonKeyEquals(var, varLen, fields[f].var);
+        if (!wanted || *c.p != '{') {
+            if (!jsonSkipValue(&c)) return -1;
+            continue;
+        }
+        c.p++;
+        if (jsonExpect(&c, '}')) continue;
+        do {
+            if (!jsonRawString(&c, &attribute, &attributeLen) || !jsonExpect(&c, ':')) return -1;
+            const FetchField* field = NULL;
+            for (size_t f = 0; f < fieldCount && field == NULL; f++) {
+                if (jsonKeyEquals(var, varLen, fields[f].var) && jsonKeyEquals(attribute, attributeLen, fields[f].attribute)) field = &fields[f];
+            }
+            jsonSkipWhitespace(&c);
+            if (field == NULL || *c.p != '[') {
+                if (!jsonSkipValue(&c)) return -1;
+                continue;
+            }
+            bool found = false;
+            if (!jsonDecodeAttribute(&c, field, out, &found)) return -1;
+            decoded += found;
+        } while (jsonExpect(&c, ','));
+        if (!jsonExpect(&c, '}')) return -1;
+    } while (jsonExpect(&c, ','));
+    return jsonExpect(&c, '}') ? decoded : -1;
+}
+
+// Fetches all users into a caller-owned array of UserRecord; returns the number of records.
+size_t fetchUserRecords(DatabaseManager* dbManager, const char* dbName, UserRecord** records) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        session_close(session);
+        exit(EXIT_FAILURE);
+    }
+    StringIterator* it = query_fetch(tx, "match $u isa user; fetch $u: full-name, email;", opts);
+    size_t count = 0;
+    size_t capacity = 0;
+    *records = NULL;
+    char* answer = NULL;
+    while (it != NULL && (answer = string_iterator_next(it)) != NULL) {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            *records = realloc(*records, capacity * sizeof(UserRecord));
+        }
+        memset(&(*records)[count], 0, sizeof(UserRecord));
+        if (decodeFetchAnswer(answer, USER_RECORD_FIELDS, USER_RECORD_FIELD_COUNT, &(*records)[count]) >= 0) count++;
+        else fprintf(stderr, "Skipping malformed answer: %s\n", answer);
+        string_free(answer);
+    }
+    if (FAILED()) fprintf(stderr, "Query failed.\n");
+    string_iterator_drop(it);
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+    return count;
+}
+
+// Compares decodeFetchAnswer with cJSON_Parse plus a tree walk on synthetic user answers.
+void benchmarkFetchDecoder(size_t answers) {
+    const size_t distinct = 1024;
+    char** samples = malloc(distinct * sizeof(char*));
+    size_t bytes = 0;
+    for (size_t i = 0; i < distinct; i++) {
+        samples[i] = malloc(512);
+        snprintf(samples[i], 512, "{\"u\": {\"email\": [{\"value\": \"user%zu@typedb.com\", \"value_type\": \"string\", \"type\": {\"label\": \"email\", \"root\": \"attribute\"}}], \"full-name\": [{\"value\": \"User \\u00c9 %zu\", \"value_type\": \"string\", \"type\": {\"label\": \"full-name\", \"root\": \"attribute\"}}], \"type\": {\"label\": \"person\", \"root\": \"entity\"}}}", i, i);
+        bytes += strlen(samples[i]);
+    }
+    UserRecord record;
+    size_t checksum = 0;
+    double started = monotonicSeconds();
+    for (size_t i = 0; i < answers; i++) {
+        if (decodeFetchAnswer(samples[i % distinct], USER_RECORD_FIELDS, USER_RECORD_FIELD_COUNT, &record) == 2) checksum += record.email[4];
+    }
+    double decoderSeconds = monotonicSeconds() - started;
+
+    started = monotonicSeconds();
+    for (size_t i = 0; i < answers; i++) {
+        cJSON* root = cJSON_Parse(samples[i % distinct]);
+        cJSON* user = cJSON_GetObjectItemCaseSensitive(root, "u");
+        const char* fullName = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(user, "full-name"), 0), "value"));
+        const char* email = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(user, "email"), 0), "value"));
+        if (fullName != NULL && email != NULL) {
+            snprintf(record.fullName, sizeof(record.fullName), "%s", fullName);
+            snprintf(record.email, sizeof(record.email), "%s", email);
+            checksum += record.email[4];
+        }
+        cJSON_Delete(root);
+    }
+    double cjsonSeconds = monotonicSeconds() - started;
+
+    double megabytes = (double)bytes / distinct * answers / 1e6;
+    printf("Fetch decoder benchmark (%zu answers, checksum %zu)\n", answers, checksum);
+    printf("  streaming decoder: %.3f s, %.0f answers/s, %.1f MB/s\n", decoderSeconds, answers / decoderSeconds, megabytes / decoderSeconds);
+    printf("  cJSON_Parse:       %.3f s, %.0f answers/s, %.1f MB/s\n", cjsonSeconds, answers / cjsonSeconds, megabytes / cjsonSeconds);
+    for (size_t i = 0; i < distinct; i++) free(samples[i]);
+    free(samples);
+}
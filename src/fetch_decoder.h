@@ -0,0 +1,18 @@
+#ifndef TUTORIAL_FETCH_DECODER_H
+#define TUTORIAL_FETCH_DECODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DECODER_BENCHMARK_ANSWERS 1000000
+
+typedef struct {
+    char fullName[128];
+    char email[128];
+} UserRecord;
+
+bool jsonUnescape(const char* raw, size_t len, char* out, size_t capacity);
+size_t fetchUserRecords(DatabaseManager* dbManager, const char* dbName, UserRecord** records);
+void benchmarkFetchDecoder(size_t answers);
+
+#endif
@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "group_commit.h"
+#include "typeql_escape.h"
+#include "profiling.h"
+#include "write_listeners.h"
+#include "permission_index.h"
+
+#define GROUP_COMMIT_MAX_OPS 256
+#define GROUP_COMMIT_MAX_DELAY_US 2000
+
+static void writeQueueInit(WriteQueue* queue) {
+    atomic_store(&queue->stub.next, NULL);
+    atomic_store(&queue->head, &queue->stub);
+    queue->tail = &queue->stub;
+}
+
+static void writeQueuePush(WriteQueue* queue, GroupWrite* op) {
+    atomic_store(&op->next, NULL);
+    GroupWrite* prev = atomic_exchange(&queue->head, op);
+    atomic_store(&prev->next, op);
+}
+
+// Returns NULL when the queue is empty or a producer is between its two push steps.
+static GroupWrite* writeQueuePop(WriteQueue* queue) {
+    GroupWrite* tail = queue->tail;
+    GroupWrite* next = atomic_load(&tail->next);
+    if (tail == &queue->stub) {
+        if (next == NULL) return NULL;
+        queue->tail = next;
+        tail = next;
+        next = atomic_load(&next->next);
+    }
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load(&queue->head)) return NULL;
+    writeQueuePush(queue, &queue->stub);
+    next = atomic_load(&tail->next);
+    if (next == NULL) return NULL;
+    queue->tail = next;
+    return tail;
+}
+
+static bool writeQueueEmpty(WriteQueue* queue) {
+    return queue->tail == &queue->stub && atomic_load(&queue->stub.next) == NULL;
+}
+
+// Sleeps until an operation is queued, the writer is stopped or the deadline (if any) passes.
+static void groupWriterWait(GroupWriter* writer, const struct timespec* deadline) {
+    pthread_mutex_lock(&writer->lock);
+    atomic_store(&writer->sleeping, true);
+    while (writeQueueEmpty(&writer->queue) && !atomic_load(&writer->stopping)) {
+        if (deadline == NULL) pthread_cond_wait(&writer->wakeup, &writer->lock);
+        else if (pthread_cond_timedwait(&writer->wakeup, &writer->lock, deadline) == ETIMEDOUT) break;
+    }
+    atomic_store(&writer->sleeping, false);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+static long groupWriteExecute(Transaction* tx, GroupWrite* op, Options* opts) {
+    if (op->kind == GROUP_WRITE_DELETE) {
+        VoidPromise* promise = query_delete(tx, op->query, opts);
+        if (promise != NULL) void_promise_resolve(promise);
+        return promise == NULL || FAILED() ? -1 : 0;
+    }
+    ConceptMapIterator* response = op->kind == GROUP_WRITE_INSERT ? query_insert(tx, op->query, opts) : query_update(tx, op->query, opts);
+    if (response == NULL || FAILED()) return -1;
+    long count = 0;
+    ConceptMap* conceptMap = NULL;
+    while ((conceptMap = concept_map_iterator_next(response)) != NULL) {
+        if (op->email != NULL && op->iid == NULL) op->iid = conceptMapIid(conceptMap, "p");
+        concept_map_drop(conceptMap);
+        count++;
+    }
+    concept_map_iterator_drop(response);
+    return FAILED() ? -1 : count;
+}
+
+static void groupWriteNotify(const GroupWrite* op) {
+    if (op->result <= 0) return;
+    if (op->iid != NULL) notifyUserInserted(op->iid, op->name, op->email);
+    if (op->oldPath != NULL) notifyFilePathUpdated(op->oldPath, op->newPath);
+}
+
+// Runs the operations in one transaction with one commit, then notifies the write listeners. Returns
+// false, without committing, as soon as any of them fails.
+static bool runWriteBatch(Session* session, GroupWrite** ops, size_t count, Options* opts) {
+    Transaction* tx = transaction_new(session, Write, opts);
+    if (tx == NULL || FAILED()) return false;
+    for (size_t i = 0; i < count; i++) {
+        if (ops[i]->iid != NULL) string_free(ops[i]->iid);
+        ops[i]->iid = NULL;
+        ops[i]->result = groupWriteExecute(tx, ops[i], opts);
+        if (ops[i]->result < 0) {
+            transaction_close(tx);
+            return false;
+        }
+    }
+    void_promise_resolve(transaction_commit(tx));
+    if (FAILED()) return false;
+    for (size_t i = 0; i < count; i++) groupWriteNotify(ops[i]);
+    return true;
+}
+
+static void* groupWriterThread(void* arg) {
+    GroupWriter* writer = (GroupWriter*)arg;
+    Options* opts = options_new();
+    GroupWrite** batch = malloc(writer->maxOps * sizeof(GroupWrite*));
+    for (;;) {
+        GroupWrite* op = writeQueuePop(&writer->queue);
+        if (op == NULL) {
+            if (atomic_load(&writer->stopping) && writeQueueEmpty(&writer->queue)) break;
+            groupWriterWait(writer, NULL);
+            continue;
+        }
+        // The first operation opens the batch window: collect up to maxOps or until maxDelayUs passes.
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += writer->maxDelayUs * 1000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        size_t count = 0;
+        batch[count++] = op;
+        while (count < writer->maxOps) {
+            if ((op = writeQueuePop(&writer->queue)) != NULL) {
+                batch[count++] = op;
+                continue;
+            }
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            if (atomic_load(&writer->stopping) || now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) break;
+            groupWriterWait(writer, &deadline);
+        }
+        // One failing operation must not fail its neighbours, so a failed batch is retried op by op.
+        if (!runWriteBatch(writer->session, batch, count, opts)) {
+            writer->fallbacks++;
+            for (size_t i = 0; i < count; i++) {
+                if (!runWriteBatch(writer->session, &batch[i], 1, opts)) batch[i]->result = -1;
+            }
+        }
+        writer->batches++;
+        writer->ops += count;
+        for (size_t i = 0; i < count; i++) futureComplete(batch[i]->future, batch[i]);
+    }
+    free(batch);
+    options_drop(opts);
+    return NULL;
+}
+
+GroupWriter* groupWriterNew(DatabaseManager* dbManager, const char* dbName, size_t maxOps, long maxDelayUs) {
+    Options* opts = options_new();
+    GroupWriter* writer = calloc(1, sizeof(GroupWriter));
+    writer->session = session_new(dbManager, dbName, Data, opts);
+    options_drop(opts);
+    if (writer->session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    writeQueueInit(&writer->queue);
+    writer->maxOps = maxOps;
+    writer->maxDelayUs = maxDelayUs;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wakeup, NULL);
+    pthread_create(&writer->thread, NULL, groupWriterThread, writer);
+    return writer;
+}
+
+static GroupWrite* groupWriteNew(GroupWriteKind kind, const char* query) {
+    GroupWrite* op = calloc(1, sizeof(GroupWrite));
+    op->kind = kind;
+    op->query = strdup(query);
+    op->future = futureNew();
+    return op;
+}
+
+static void groupWriterQueue(GroupWriter* writer, GroupWrite* op) {
+    writeQueuePush(&writer->queue, op);
+    if (atomic_load(&writer->sleeping)) {
+        pthread_mutex_lock(&writer->lock);
+        pthread_cond_signal(&writer->wakeup);
+        pthread_mutex_unlock(&writer->lock);
+    }
+}
+
+// Queues a write query and returns immediately. Await op->future, read op->result, then groupWriteDrop.
+GroupWrite* groupWriterSubmit(GroupWriter* writer, GroupWriteKind kind, const char* query) {
+    GroupWrite* op = groupWriteNew(kind, query);
+    groupWriterQueue(writer, op);
+    return op;
+}
+
+static void groupWriteDrop(GroupWrite* op) {
+    futureDrop(op->future);
+    free(op->query);
+    free(op->name);
+    free(op->email);
+    if (op->iid != NULL) string_free(op->iid);
+    free(op->oldPath);
+    free(op->newPath);
+    free(op);
+}
+
+// Queues the write, blocks until it has committed (or failed), drops it and returns its result.
+static long groupWriterRun(GroupWriter* writer, GroupWrite* op) {
+    groupWriterQueue(writer, op);
+    futureAwait(op->future);
+    long result = op->result;
+    groupWriteDrop(op);
+    return result;
+}
+
+long groupWriterExecute(GroupWriter* writer, GroupWriteKind kind, const char* query) {
+    return groupWriterRun(writer, groupWriteNew(kind, query));
+}
+
+static GroupWrite* groupInsertUserWrite(const char* name, const char* email) {
+    char* escapedName = escapeTypeQLCopy(name);
+    char* escapedEmail = escapeTypeQLCopy(email);
+    size_t size = strlen(escapedName) + strlen(escapedEmail) + 128;
+    char* query = malloc(size);
+    snprintf(query, size, "insert $p isa person, has full-name $fn, has email $e; $fn == '%s'; $e == '%s';", escapedName, escapedEmail);
+    GroupWrite* op = groupWriteNew(GROUP_WRITE_INSERT, query);
+    op->name = strdup(name);
+    op->email = strdup(email);
+    free(query);
+    free(escapedEmail);
+    free(escapedName);
+    return op;
+}
+
+long groupInsertUser(GroupWriter* writer, const char* name, const char* email) {
+    return groupWriterRun(writer, groupInsertUserWrite(name, email));
+}
+
+long groupUpdateFilePath(GroupWriter* writer, const char* oldPath, const char* newPath) {
+    char* escapedOld = escapeTypeQLCopy(oldPath);
+    char* escapedNew = escapeTypeQLCopy(newPath);
+    size_t size = strlen(escapedOld) + strlen(escapedNew) + 160;
+    char* query = malloc(size);
+    snprintf(query, size, "match $f isa file, has path $old_path; $old_path = '%s'; delete $f has $old_path; insert $f has path $new_path; $new_path = '%s';", escapedOld, escapedNew);
+    GroupWrite* op = groupWriteNew(GROUP_WRITE_UPDATE, query);
+    op->oldPath = strdup(oldPath);
+    op->newPath = strdup(newPath);
+    free(query);
+    free(escapedNew);
+    free(escapedOld);
+    return groupWriterRun(writer, op);
+}
+
+// Commits everything still queued, then stops the writer thread and closes its session.
+void groupWriterShutdown(GroupWriter* writer) {
+    pthread_mutex_lock(&writer->lock);
+    atomic_store(&writer->stopping, true);
+    pthread_cond_signal(&writer->wakeup);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+    printf("Group commit: %zu writes in %zu transactions (%zu batches retried per write).\n", writer->ops, writer->batches, writer->fallbacks);
+    session_close(writer->session);
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->wakeup);
+    free(writer);
+}
+
+typedef struct {
+    GroupWriter* writer; // NULL to commit every write in its own transaction
+    Session* session;
+    int thread;
+    size_t writes;
+    size_t failed;
+} GroupCommitBenchmarkArgs;
+
+static void* groupCommitBenchmarkWorker(void* arg) {
+    GroupCommitBenchmarkArgs* args = (GroupCommitBenchmarkArgs*)arg;
+    Options* opts = options_new();
+    char name[64], email[64];
+    for (size_t i = 0; i < args->writes; i++) {
+        snprintf(name, sizeof(name), "Group Commit %d-%zu", args->thread, i);
+        snprintf(email, sizeof(email), "group-commit-%d-%zu@typedb.com", args->thread, i);
+        if (args->writer != NULL) {
+            if (groupInsertUser(args->writer, name, email) < 0) args->failed++;
+            continue;
+        }
+        GroupWrite* op = groupInsertUserWrite(name, email);
+        if (!runWriteBatch(args->session, &op, 1, opts)) args->failed++;
+        groupWriteDrop(op);
+    }
+    options_drop(opts);
+    return NULL;
+}
+
+// Inserts threads * writes users with one commit per write, then through a group writer, and removes them.
+void benchmarkGroupCommit(DatabaseManager* dbManager, const char* dbName, int threads, size_t writes) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("Group commit benchmark (%d threads x %zu inserts)\n", threads, writes);
+    GroupCommitBenchmarkArgs* args = calloc(threads, sizeof(GroupCommitBenchmarkArgs));
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    for (int grouped = 0; grouped < 2; grouped++) {
+        GroupWriter* writer = grouped ? groupWriterNew(dbManager, dbName, GROUP_COMMIT_MAX_OPS, GROUP_COMMIT_MAX_DELAY_US) : NULL;
+        double started = monotonicSeconds();
+        for (int t = 0; t < threads; t++) {
+            args[t] = (GroupCommitBenchmarkArgs){ writer, session, t + grouped * threads, writes, 0 };
+            pthread_create(&workers[t], NULL, groupCommitBenchmarkWorker, &args[t]);
+        }
+        size_t failed = 0;
+        for (int t = 0; t < threads; t++) {
+            pthread_join(workers[t], NULL);
+            failed += args[t].failed;
+        }
+        double seconds = monotonicSeconds() - started;
+        printf("  %-16s %.3f s, %.0f writes/s (%zu failed)\n", grouped ? "group commit" : "commit per write", seconds, threads * writes / seconds, failed);
+        if (writer != NULL) groupWriterShutdown(writer);
+    }
+    Transaction* tx = transaction_new(session, Write, opts);
+    if (tx != NULL && !FAILED()) {
+        void_promise_resolve(query_delete(tx, "match $p isa person, has email $e; $e like '^group-commit-.*'; delete $p isa person;", opts));
+        if (!FAILED()) void_promise_resolve(transaction_commit(tx));
+        else transaction_close(tx);
+        FAILED();
+    }
+    free(workers);
+    free(args);
+    session_close(session);
+    options_drop(opts);
+}
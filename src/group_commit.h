@@ -0,0 +1,57 @@
+#ifndef TUTORIAL_GROUP_COMMIT_H
+#define TUTORIAL_GROUP_COMMIT_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "executor.h"
+
+typedef enum { GROUP_WRITE_INSERT, GROUP_WRITE_UPDATE, GROUP_WRITE_DELETE } GroupWriteKind;
+
+typedef struct GroupWrite {
+    GroupWriteKind kind;
+    char* query;
+    // What the write listeners are told once the write has committed: a user insert binds the user to
+    // $p and sets name and email; a path update sets oldPath and newPath. All NULL for other writes.
+    char* name;
+    char* email;
+    char* iid; // of the inserted user, read from the insert's answer
+    char* oldPath;
+    char* newPath;
+    long result; // answers for inserts and updates, 0 for deletes, -1 on failure
+    Future* future; // completed with the GroupWrite itself once its transaction has committed
+    _Atomic(struct GroupWrite*) next;
+} GroupWrite;
+
+// Intrusive multi-producer single-consumer queue (Vyukov): producers only swap the head, the writer
+// thread owns the tail.
+typedef struct {
+    _Atomic(GroupWrite*) head;
+    GroupWrite* tail;
+    GroupWrite stub;
+} WriteQueue;
+
+typedef struct {
+    Session* session;
+    WriteQueue queue;
+    size_t maxOps;
+    long maxDelayUs;
+    pthread_t thread;
+    pthread_mutex_t lock; // only taken to sleep and to wake the writer
+    pthread_cond_t wakeup;
+    atomic_bool sleeping;
+    atomic_bool stopping;
+    size_t batches;
+    size_t ops;
+    size_t fallbacks;
+} GroupWriter;
+
+GroupWriter* groupWriterNew(DatabaseManager* dbManager, const char* dbName, size_t maxOps, long maxDelayUs);
+GroupWrite* groupWriterSubmit(GroupWriter* writer, GroupWriteKind kind, const char* query);
+long groupWriterExecute(GroupWriter* writer, GroupWriteKind kind, const char* query);
+long groupInsertUser(GroupWriter* writer, const char* name, const char* email);
+long groupUpdateFilePath(GroupWriter* writer, const char* oldPath, const char* newPath);
+void groupWriterShutdown(GroupWriter* writer);
+void benchmarkGroupCommit(DatabaseManager* dbManager, const char* dbName, int threads, size_t writes);
+
+#endif
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "iid_cache.h"
+#include "typeql_escape.h"
+#include "profiling.h"
+#include "output_sink.h"
+#include "write_listeners.h"
+#include "permission_index.h"
+
+#define IID_CACHE_MAX_ENTRIES 100000
+#define IID_CACHE_KEY_SIZE 512
+
+static bool iidCacheKey(char* key, size_t size, const char* ownerType, const char* attributeType, const char* value) {
+    int written = ownerType != NULL ? snprintf(key, size, "%s\t%s\t%s", ownerType, attributeType, value)
+                                    : snprintf(key, size, "%s\t%s", attributeType, value);
+    return written > 0 && (size_t)written < size;
+}
+
+static bool iidCacheGet(IidCache* cache, const char* key, char* iid, size_t size) {
+    pthread_rwlock_rdlock(&cache->lock);
+    const char* cached = (const char*)stringMapGet(&cache->iids, key);
+    bool found = cached != NULL && strlen(cached) < size;
+    if (found) strcpy(iid, cached);
+    pthread_rwlock_unlock(&cache->lock);
+    atomic_fetch_add_explicit(found ? &cache->hits : &cache->misses, 1, memory_order_relaxed);
+    return found;
+}
+
+// A full cache is emptied rather than tracking recency; the working set of point lookups refills it.
+static void iidCachePut(IidCache* cache, const char* key, const char* iid) {
+    pthread_rwlock_wrlock(&cache->lock);
+    if (cache->iids.count >= IID_CACHE_MAX_ENTRIES) {
+        stringMapFree(&cache->iids, free);
+        stringMapInit(&cache->iids, 1024);
+    }
+    free(stringMapGet(&cache->iids, key));
+    stringMapPut(&cache->iids, key, strdup(iid));
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+// Removes the key and returns its IID for the caller to free, or NULL.
+static char* iidCacheTake(IidCache* cache, const char* key) {
+    pthread_rwlock_wrlock(&cache->lock);
+    char* iid = (char*)stringMapRemove(&cache->iids, key);
+    pthread_rwlock_unlock(&cache->lock);
+    return iid;
+}
+
+// Drops the keys a path can be looked up under: every type that owns path or has a subtype that does,
+// through path and its supertype id, and with attributes set the path attribute itself.
+static void iidCacheForgetPath(IidCache* cache, const char* path, bool attributes) {
+    const char* ownerTypes[] = { "file", "directory", "resource", "resource-collection", "object" };
+    const char* attributeTypes[] = { "path", "id" };
+    char key[IID_CACHE_KEY_SIZE];
+    for (size_t a = 0; a < sizeof(attributeTypes) / sizeof(attributeTypes[0]); a++) {
+        for (size_t t = 0; t < sizeof(ownerTypes) / sizeof(ownerTypes[0]); t++) {
+            if (iidCacheKey(key, sizeof(key), ownerTypes[t], attributeTypes[a], path)) free(iidCacheTake(cache, key));
+        }
+        if (attributes && iidCacheKey(key, sizeof(key), NULL, attributeTypes[a], path)) free(iidCacheTake(cache, key));
+    }
+}
+
+static void iidCacheFileDeleted(void* context, const char* path) {
+    iidCacheForgetPath((IidCache*)context, path, true);
+}
+
+// The old path no longer leads to the file, and the new one may now lead to two things. The old path
+// attribute itself still exists.
+static void iidCacheFilePathUpdated(void* context, const char* oldPath, const char* newPath) {
+    iidCacheForgetPath((IidCache*)context, oldPath, false);
+    iidCacheForgetPath((IidCache*)context, newPath, false);
+}
+
+// The new person makes a cached full-name or email lookup that used to match one thing match two, so
+// those keys go, under every type the person is an instance of, and for the attributes themselves.
+static void iidCacheUserInserted(void* context, const char* iid, const char* name, const char* email) {
+    (void)iid;
+    IidCache* cache = (IidCache*)context;
+    const char* ownerTypes[] = { "person", "user", "subject", NULL };
+    char key[IID_CACHE_KEY_SIZE];
+    for (size_t t = 0; t < sizeof(ownerTypes) / sizeof(ownerTypes[0]); t++) {
+        if (iidCacheKey(key, sizeof(key), ownerTypes[t], "full-name", name)) free(iidCacheTake(cache, key));
+        if (iidCacheKey(key, sizeof(key), ownerTypes[t], "email", email)) free(iidCacheTake(cache, key));
+        if (iidCacheKey(key, sizeof(key), ownerTypes[t], "id", email)) free(iidCacheTake(cache, key));
+    }
+}
+
+void iidCacheInit(IidCache* cache) {
+    memset(cache, 0, sizeof(IidCache));
+    stringMapInit(&cache->iids, 1024);
+    pthread_rwlock_init(&cache->lock, NULL);
+    addWriteListener((WriteListener){ cache, iidCacheUserInserted, iidCacheFilePathUpdated, iidCacheFileDeleted, NULL });
+}
+
+void iidCacheFree(IidCache* cache) {
+    removeWriteListener(cache);
+    stringMapFree(&cache->iids, free);
+    pthread_rwlock_destroy(&cache->lock);
+}
+
+// Finds the IID by matching the attribute value on the server and caches it when exactly one thing
+// matches. With ownerType NULL the attribute itself is looked up.
+static bool iidCacheResolve(IidCache* cache, Transaction* tx, Options* opts, const char* key, const char* ownerType, const char* attributeType, const char* value, char* iid, size_t size) {
+    char escaped[2 * IID_CACHE_KEY_SIZE], query[3 * IID_CACHE_KEY_SIZE];
+    if (!escapeTypeQL(value, escaped, sizeof(escaped))) return false;
+    if (ownerType != NULL) snprintf(query, sizeof(query), "match $x isa %s, has %s '%s'; get $x; limit 2;", ownerType, attributeType, escaped);
+    else snprintf(query, sizeof(query), "match $x isa %s; $x == '%s'; get $x; limit 2;", attributeType, escaped);
+    ConceptMapIterator* response = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, response = query_get(tx, query, opts));
+    if (response == NULL || FAILED()) return false;
+    int count = 0;
+    ConceptMap* cm = NULL;
+    while ((cm = concept_map_iterator_next(response)) != NULL) {
+        if (count++ == 0) {
+            char* found = conceptMapIid(cm, "x");
+            snprintf(iid, size, "%s", found);
+            string_free(found);
+        }
+        concept_map_drop(cm);
+    }
+    concept_map_iterator_drop(response);
+    if (FAILED() || count != 1) return false;
+    iidCachePut(cache, key, iid);
+    return true;
+}
+
+// Fetches the thing by IID. An attribute's value never changes, so the attribute is fetched directly;
+// an entity is matched from its IID together with the attribute value, so that one which lost the value
+// to another process's write is not returned.
+static Concept* iidCacheFetch(Transaction* tx, Options* opts, const char* iid, const char* ownerType, const char* attributeType, const char* value) {
+    if (ownerType == NULL) {
+        ConceptPromise* promise = concepts_get_attribute(tx, iid);
+        Concept* thing = promise != NULL ? concept_promise_resolve(promise) : NULL;
+        return FAILED() ? NULL : thing;
+    }
+    char escaped[2 * IID_CACHE_KEY_SIZE], query[3 * IID_CACHE_KEY_SIZE];
+    if (!escapeTypeQL(value, escaped, sizeof(escaped))) return NULL;
+    snprintf(query, sizeof(query), "match $x iid %s, isa %s, has %s '%s'; get $x;", iid, ownerType, attributeType, escaped);
+    ConceptMapIterator* response = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, response = query_get(tx, query, opts));
+    if (response == NULL || FAILED()) return NULL;
+    ConceptMap* cm = concept_map_iterator_next(response);
+    Concept* thing = NULL;
+    if (cm != NULL) {
+        thing = concept_map_get(cm, "x");
+        concept_map_drop(cm);
+    }
+    concept_map_iterator_drop(response);
+    if (FAILED()) {
+        concept_drop(thing);
+        return NULL;
+    }
+    return thing;
+}
+
+// Returns the entity of ownerType that has the attribute value, or the attribute itself when ownerType
+// is NULL, fetched by IID when cached. A cached IID whose thing is gone or no longer has the value
+// (changed by another process) is dropped and resolved again. Returns NULL when nothing, or more than
+// one thing, matches. Writes made through this process's write functions invalidate the affected keys;
+// a second owner of the value added by another process goes unnoticed until the key is dropped.
+static Concept* iidCacheGetThing(IidCache* cache, Transaction* tx, Options* opts, const char* ownerType, const char* attributeType, const char* value) {
+    char key[IID_CACHE_KEY_SIZE], iid[128];
+    if (!iidCacheKey(key, sizeof(key), ownerType, attributeType, value)) return NULL;
+    bool cached = iidCacheGet(cache, key, iid, sizeof(iid));
+    if (!cached && !iidCacheResolve(cache, tx, opts, key, ownerType, attributeType, value, iid, sizeof(iid))) return NULL;
+    Concept* thing = iidCacheFetch(tx, opts, iid, ownerType, attributeType, value);
+    if (thing == NULL && cached) {
+        atomic_fetch_add_explicit(&cache->stale, 1, memory_order_relaxed);
+        free(iidCacheTake(cache, key));
+        return iidCacheGetThing(cache, tx, opts, ownerType, attributeType, value);
+    }
+    return thing;
+}
+
+// Prints the attributes of the user with the full name, locating the user through the cache.
+int getUserAttributesCached(DatabaseManager* dbManager, const char* dbName, IidCache* cache, const char* name) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        options_drop(opts);
+        session_close(session);
+        exit(EXIT_FAILURE);
+    }
+    int attributeCount = 0;
+    Concept* user = iidCacheGetThing(cache, tx, opts, "person", "full-name", name);
+    if (user == NULL) {
+        fprintf(stderr, "Error: No single user found with that name.\n");
+    } else {
+        const Concept* const allTypes[] = { NULL };
+        const Annotation* const noAnnotations[] = { NULL };
+        ConceptIterator* attributes = thing_get_has(tx, user, allTypes, noAnnotations);
+        Concept* attribute = NULL;
+        while (attributes != NULL && (attribute = concept_iterator_next(attributes)) != NULL) {
+            Concept* type = attribute_get_type(attribute);
+            Concept* value = attribute_get_value(attribute);
+            char* label = thing_type_get_label(type);
+            char* text = value_is_string(value) ? value_get_string(value) : concept_to_string(value);
+            SinkField field = { label, text, NULL };
+            sinkRecord(&STDOUT_SINK, "Attribute", ++attributeCount, &field, 1);
+            string_free(text);
+            string_free(label);
+            concept_drop(value);
+            concept_drop(type);
+            concept_drop(attribute);
+        }
+        if (attributes == NULL || FAILED()) fprintf(stderr, "Failed to read the user's attributes.\n");
+        concept_iterator_drop(attributes);
+        concept_drop(user);
+    }
+    sinkFlush(&STDOUT_SINK);
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+    return attributeCount;
+}
+
+// Repeated point lookups of one user: matching by attribute value every time versus matching from the
+// cached IID.
+void benchmarkIidCache(DatabaseManager* dbManager, const char* dbName, const char* name, int lookups) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        options_drop(opts);
+        return;
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        session_close(session);
+        options_drop(opts);
+        return;
+    }
+    IidCache cache;
+    iidCacheInit(&cache);
+    char key[IID_CACHE_KEY_SIZE], iid[128];
+    iidCacheKey(key, sizeof(key), "person", "full-name", name);
+    double started = monotonicSeconds();
+    for (int i = 0; i < lookups; i++) {
+        free(iidCacheTake(&cache, key));
+        iidCacheResolve(&cache, tx, opts, key, "person", "full-name", name, iid, sizeof(iid));
+    }
+    double matched = monotonicSeconds() - started;
+    started = monotonicSeconds();
+    int found = 0;
+    for (int i = 0; i < lookups; i++) {
+        Concept* user = iidCacheGetThing(&cache, tx, opts, "person", "full-name", name);
+        if (user == NULL) continue;
+        found++;
+        concept_drop(user);
+    }
+    double fetched = monotonicSeconds() - started;
+    printf("IID cache benchmark: %.3f ms per match, %.3f ms per fetch by IID (%d of %d found, %zu hits)\n",
+           matched / lookups * 1e3, fetched / lookups * 1e3, found, lookups, (size_t)cache.hits);
+    iidCacheFree(&cache);
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+}
@@ -0,0 +1,27 @@
+#ifndef TUTORIAL_IID_CACHE_H
+#define TUTORIAL_IID_CACHE_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "string_map.h"
+
+// Remembers which thing a unique attribute value identifies, so repeated point lookups fetch the thing
+// by IID instead of matching a pattern. Keys are "owner type\tattribute type\tvalue" for entities and
+// "attribute type\tvalue" for attributes. full-name, email and path are unique in practice but not
+// declared @key, so a lookup that matches several things is never cached. A cached entity is checked to
+// still have the value each time it is fetched.
+typedef struct {
+    StringMap iids; // key -> malloc'd IID
+    pthread_rwlock_t lock;
+    _Atomic size_t hits;
+    _Atomic size_t misses;
+    _Atomic size_t stale;
+} IidCache;
+
+void iidCacheInit(IidCache* cache);
+void iidCacheFree(IidCache* cache);
+int getUserAttributesCached(DatabaseManager* dbManager, const char* dbName, IidCache* cache, const char* name);
+void benchmarkIidCache(DatabaseManager* dbManager, const char* dbName, const char* name, int lookups);
+
+#endif
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "../include/cJSON.h"
+#include "json_arena.h"
+#include "profiling.h"
+
+#define JSON_ARENA_CHUNK_SIZE (256 * 1024)
+#define JSON_ARENA_BENCHMARK_PAGE 1000
+
+static _Thread_local JsonArena* JSON_ARENA = NULL; // arena receiving this thread's cJSON allocations, if any
+static _Thread_local size_t JSON_HEAP_ALLOCATIONS = 0;
+
+static JsonArenaChunk* jsonArenaChunkNew(size_t minimum) {
+    size_t size = minimum > JSON_ARENA_CHUNK_SIZE ? minimum : JSON_ARENA_CHUNK_SIZE;
+    JsonArenaChunk* chunk = malloc(sizeof(JsonArenaChunk) + size);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+static void* jsonArenaAlloc(JsonArena* arena, size_t size) {
+    size = (size + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+    if (arena->current == NULL) arena->head = arena->current = jsonArenaChunkNew(size);
+    while (arena->current->used + size > arena->current->size) {
+        if (arena->current->next == NULL || arena->current->next->size < size) {
+            JsonArenaChunk* chunk = jsonArenaChunkNew(size);
+            chunk->next = arena->current->next;
+            arena->current->next = chunk;
+        }
+        arena->current = arena->current->next;
+        arena->current->used = 0;
+    }
+    void* ptr = (char*)arena->current->data + arena->current->used;
+    arena->current->used += size;
+    arena->allocations++;
+    return ptr;
+}
+
+// Releases everything allocated since the last reset in O(1).
+void jsonArenaReset(JsonArena* arena) {
+    arena->current = arena->head;
+    if (arena->head != NULL) arena->head->used = 0;
+    arena->allocations = 0;
+}
+
+void jsonArenaFree(JsonArena* arena) {
+    JsonArenaChunk* chunk = arena->head;
+    while (chunk != NULL) {
+        JsonArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    memset(arena, 0, sizeof(JsonArena));
+}
+
+static void* jsonHookMalloc(size_t size) {
+    if (JSON_ARENA != NULL) return jsonArenaAlloc(JSON_ARENA, size);
+    JSON_HEAP_ALLOCATIONS++;
+    return malloc(size);
+}
+
+static bool jsonArenaContains(const JsonArena* arena, const void* ptr) {
+    for (const JsonArenaChunk* chunk = arena->head; chunk != NULL; chunk = chunk->next) {
+        const char* data = (const char*)chunk->data;
+        if ((const char*)ptr >= data && (const char*)ptr < data + chunk->size) return true;
+    }
+    return false;
+}
+
+// Arena memory is only released by jsonArenaReset; anything else came from malloc, even while an arena
+// is active (cJSON frees scratch buffers and trees allocated before the arena was switched on).
+static void jsonHookFree(void* ptr) {
+    if (JSON_ARENA != NULL && jsonArenaContains(JSON_ARENA, ptr)) return;
+    free(ptr);
+}
+
+static void jsonArenaInstallHooksOnce(void) {
+    cJSON_Hooks hooks = { jsonHookMalloc, jsonHookFree };
+    cJSON_InitHooks(&hooks);
+}
+
+// Routes cJSON allocations through the arena hooks. Outside an arena they fall through to malloc and
+// free, so the hooks stay installed. Trees parsed into an arena must be released with jsonArenaReset,
+// never cJSON_Delete.
+static void jsonArenaInstallHooks(void) {
+    static pthread_once_t installed = PTHREAD_ONCE_INIT;
+    pthread_once(&installed, jsonArenaInstallHooksOnce);
+}
+
+// Parses one fetch answer into the arena; the tree stays valid until the next jsonArenaReset.
+cJSON* jsonArenaParse(JsonArena* arena, const char* answer) {
+    jsonArenaInstallHooks();
+    JsonArena* previous = JSON_ARENA;
+    JSON_ARENA = arena;
+    cJSON* root = cJSON_Parse(answer);
+    JSON_ARENA = previous;
+    return root;
+}
+
+// Parses a page of fetch answers into the arena; roots stay valid until the next jsonArenaReset.
+static size_t jsonArenaParsePage(JsonArena* arena, char* const* answers, size_t count, cJSON** roots) {
+    size_t parsed = 0;
+    for (size_t i = 0; i < count; i++) {
+        roots[i] = jsonArenaParse(arena, answers[i]);
+        parsed += roots[i] != NULL;
+    }
+    return parsed;
+}
+
+// Parses synthetic fetch answers page by page with per-node heap allocation and with the arena.
+void benchmarkJsonArena(size_t answers) {
+    const size_t page = JSON_ARENA_BENCHMARK_PAGE;
+    char** samples = malloc(page * sizeof(char*));
+    cJSON** roots = malloc(page * sizeof(cJSON*));
+    for (size_t i = 0; i < page; i++) {
+        samples[i] = malloc(512);
+        snprintf(samples[i], 512, "{\"u\": {\"email\": [{\"value\": \"user%zu@typedb.com\", \"value_type\": \"string\", \"type\": {\"label\": \"email\", \"root\": \"attribute\"}}], \"full-name\": [{\"value\": \"User %zu\", \"value_type\": \"string\", \"type\": {\"label\": \"full-name\", \"root\": \"attribute\"}}], \"type\": {\"label\": \"person\", \"root\": \"entity\"}}}", i, i);
+    }
+    jsonArenaInstallHooks();
+
+    JSON_HEAP_ALLOCATIONS = 0;
+    double started = monotonicSeconds();
+    for (size_t done = 0; done < answers; done += page) {
+        for (size_t i = 0; i < page; i++) roots[i] = cJSON_Parse(samples[i]);
+        for (size_t i = 0; i < page; i++) cJSON_Delete(roots[i]);
+    }
+    double heapSeconds = monotonicSeconds() - started;
+    size_t heapAllocations = JSON_HEAP_ALLOCATIONS;
+
+    JsonArena arena = {0};
+    size_t arenaAllocations = 0;
+    JSON_HEAP_ALLOCATIONS = 0;
+    started = monotonicSeconds();
+    for (size_t done = 0; done < answers; done += page) {
+        jsonArenaParsePage(&arena, samples, page, roots);
+        arenaAllocations += arena.allocations;
+        jsonArenaReset(&arena);
+    }
+    double arenaSeconds = monotonicSeconds() - started;
+    size_t parsed = ((answers + page - 1) / page) * page;
+    printf("cJSON arena benchmark (%zu answers, pages of %zu)\n", parsed, page);
+    printf("  heap:  %.3f s, %.0f answers/s, %zu mallocs (%.1f per answer)\n", heapSeconds, parsed / heapSeconds, heapAllocations, (double)heapAllocations / parsed);
+    printf("  arena: %.3f s, %.0f answers/s, %zu arena allocations, %zu mallocs\n", arenaSeconds, parsed / arenaSeconds, arenaAllocations, JSON_HEAP_ALLOCATIONS);
+
+    jsonArenaFree(&arena);
+    for (size_t i = 0; i < page; i++) free(samples[i]);
+    free(samples);
+    free(roots);
+}
@@ -0,0 +1,27 @@
+#ifndef TUTORIAL_JSON_ARENA_H
+#define TUTORIAL_JSON_ARENA_H
+
+#include <stddef.h>
+#include "../include/cJSON.h"
+
+typedef struct JsonArenaChunk {
+    struct JsonArenaChunk* next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} JsonArenaChunk;
+
+// Bump allocator for cJSON trees: a page of answers is parsed into it and released with one reset.
+// Chunks are kept across resets, so a warmed-up arena does no heap allocation at all.
+typedef struct {
+    JsonArenaChunk* head;
+    JsonArenaChunk* current;
+    size_t allocations;
+} JsonArena;
+
+void jsonArenaReset(JsonArena* arena);
+void jsonArenaFree(JsonArena* arena);
+cJSON* jsonArenaParse(JsonArena* arena, const char* answer);
+void benchmarkJsonArena(size_t answers);
+
+#endif
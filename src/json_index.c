@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "../include/cJSON.h"
+#include "json_index.h"
+#include "profiling.h"
+#include "fetch_decoder.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define JSON_SCAN_X86
+#endif
+
+typedef void (*JsonClassifyFn)(const uint8_t* block, uint64_t* quote, uint64_t* backslash, uint64_t* structural, uint64_t* whitespace);
+
+static void jsonClassifyScalar(const uint8_t* block, uint64_t* quote, uint64_t* backslash, uint64_t* structural, uint64_t* whitespace) {
+    uint64_t q = 0, b = 0, s = 0, w = 0;
+    for (int i = 0; i < 64; i++) {
+        uint8_t ch = block[i];
+        uint64_t bit = 1ULL << i;
+        if (ch == '"') q |= bit;
+        else if (ch == '\\') b |= bit;
+        else if (ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ':' || ch == ',') s |= bit;
+        else if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') w |= bit;
+    }
+    *quote = q;
+    *backslash = b;
+    *structural = s;
+    *whitespace = w;
+}
+
+#ifdef JSON_SCAN_X86
+static uint64_t jsonMask16(const __m128i chunks[4], char ch) {
+    __m128i needle = _mm_set1_epi8(ch);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)) << (16 * i);
+    return mask;
+}
+
+static void jsonClassifySse2(const uint8_t* block, uint64_t* quote, uint64_t* backslash, uint64_t* structural, uint64_t* whitespace) {
+    __m128i chunks[4];
+    for (int i = 0; i < 4; i++) chunks[i] = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+    *quote = jsonMask16(chunks, '"');
+    *backslash = jsonMask16(chunks, '\\');
+    *structural = jsonMask16(chunks, '{') | jsonMask16(chunks, '}') | jsonMask16(chunks, '[') | jsonMask16(chunks, ']')
+        | jsonMask16(chunks, ':') | jsonMask16(chunks, ',');
+    *whitespace = jsonMask16(chunks, ' ') | jsonMask16(chunks, '\t') | jsonMask16(chunks, '\n') | jsonMask16(chunks, '\r');
+}
+
+__attribute__((target("avx2")))
+static void jsonClassifyAvx2(const uint8_t* block, uint64_t* quote, uint64_t* backslash, uint64_t* structural, uint64_t* whitespace) {
+    __m256i lo = _mm256_loadu_si256((const __m256i*)block);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(block + 32));
+#define JSON_MASK32(v, c) ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8((v), _mm256_set1_epi8(c))))
+#define JSON_MASK64(c) (JSON_MASK32(lo, c) | (JSON_MASK32(hi, c) << 32))
+    *quote = JSON_MASK64('"');
+    *backslash = JSON_MASK64('\\');
+    *structural = JSON_MASK64('{') | JSON_MASK64('}') | JSON_MASK64('[') | JSON_MASK64(']') | JSON_MASK64(':') | JSON_MASK64(',');
+    *whitespace = JSON_MASK64(' ') | JSON_MASK64('\t') | JSON_MASK64('\n') | JSON_MASK64('\r');
+#undef JSON_MASK64
+#undef JSON_MASK32
+}
+#endif
+
+static JsonClassifyFn jsonSelectClassifier(void) {
+#ifdef JSON_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return jsonClassifyAvx2;
+    return jsonClassifySse2;
+#else
+    return jsonClassifyScalar;
+#endif
+}
+
+static JsonClassifyFn JSON_CLASSIFY = NULL;
+
+static uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+void jsonIndexFree(JsonIndex* index) {
+    free(index->tokens);
+    free(index->jump);
+    memset(index, 0, sizeof(JsonIndex));
+}
+
+// Builds the structural index with the given classifier; the index may be reused across documents.
+static bool jsonIndexBuildWith(JsonIndex* index, const char* json, size_t length, JsonClassifyFn classify) {
+    index->json = json;
+    index->length = length;
+    index->tokenCount = 0;
+    if (index->capacity < length + 1) {
+        index->capacity = length + 1;
+        index->tokens = realloc(index->tokens, index->capacity * sizeof(uint32_t));
+        index->jump = realloc(index->jump, index->capacity * sizeof(uint32_t));
+    }
+    bool prevEscaped = false;
+    uint64_t inString = 0;     // all ones while the previous block ended inside a string
+    uint64_t prevScalar = 0;   // whether the previous block ended on a scalar byte
+    uint8_t padded[64];
+    for (size_t offset = 0; offset < length; offset += 64) {
+        const uint8_t* block = (const uint8_t*)json + offset;
+        if (length - offset < 64) {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, length - offset);
+            block = padded;
+        }
+        uint64_t quote, backslash, structural, whitespace;
+        classify(block, &quote, &backslash, &structural, &whitespace);
+
+        uint64_t escaped = 0;
+        if (prevEscaped) {
+            escaped = 1;
+            backslash &= ~1ULL;
+        }
+        prevEscaped = false;
+        while (backslash) {
+            int bit = __builtin_ctzll(backslash);
+            if (bit == 63) prevEscaped = true;
+            else {
+                escaped |= 1ULL << (bit + 1);
+                backslash &= ~(1ULL << (bit + 1));
+            }
+            backslash &= backslash - 1;
+        }
+        quote &= ~escaped;
+        uint64_t stringMask = prefixXor(quote) ^ inString; // opening quote through the byte before the closing one
+        inString = (uint64_t)((int64_t)stringMask >> 63);
+
+        uint64_t scalar = ~(structural | whitespace | quote | stringMask);
+        uint64_t scalarStarts = scalar & ~((scalar << 1) | prevScalar);
+        prevScalar = scalar >> 63;
+        uint64_t tokens = (structural & ~stringMask) | (quote & stringMask) | scalarStarts;
+        if (length - offset < 64) tokens &= (1ULL << (length - offset)) - 1;
+        while (tokens) {
+            index->tokens[index->tokenCount++] = (uint32_t)(offset + __builtin_ctzll(tokens));
+            tokens &= tokens - 1;
+        }
+    }
+    if (inString) return false;
+
+    // Bracket matching over tokens only: a small scalar pass compared to scanning the bytes.
+    uint32_t stackInline[64];
+    uint32_t* stack = stackInline;
+    size_t depth = 0;
+    size_t stackCapacity = 64;
+    bool ok = true;
+    for (size_t t = 0; t < index->tokenCount && ok; t++) {
+        char ch = json[index->tokens[t]];
+        if (ch == '{' || ch == '[') {
+            if (depth == stackCapacity) {
+                stackCapacity *= 2;
+                stack = stack == stackInline ? memcpy(malloc(stackCapacity * sizeof(uint32_t)), stackInline, sizeof(stackInline))
+                                             : realloc(stack, stackCapacity * sizeof(uint32_t));
+            }
+            stack[depth++] = (uint32_t)t;
+        } else if (ch == '}' || ch == ']') {
+            ok = depth > 0 && json[index->tokens[stack[depth - 1]]] == (ch == '}' ? '{' : '[');
+            if (ok) index->jump[stack[--depth]] = (uint32_t)t;
+        }
+    }
+    if (stack != stackInline) free(stack);
+    return ok && depth == 0 && index->tokenCount > 0;
+}
+
+bool jsonIndexBuild(JsonIndex* index, const char* json, size_t length) {
+    if (JSON_CLASSIFY == NULL) JSON_CLASSIFY = jsonSelectClassifier();
+    return jsonIndexBuildWith(index, json, length, JSON_CLASSIFY);
+}
+
+// Returns the token following the value that starts at token.
+static size_t jsonIndexSkip(const JsonIndex* index, size_t token) {
+    char ch = index->json[index->tokens[token]];
+    return (ch == '{' || ch == '[' ? index->jump[token] : token) + 1;
+}
+
+// Returns the value token for key in the object starting at token, or -1.
+static long jsonIndexObjectGet(const JsonIndex* index, size_t token, const char* key) {
+    if (index->json[index->tokens[token]] != '{') return -1;
+    size_t keyLen = strlen(key);
+    size_t end = index->jump[token];
+    for (size_t t = token + 1; t + 2 < end; t = jsonIndexSkip(index, t + 2) + 1) {
+        const char* name = index->json + index->tokens[t] + 1;
+        if (strncmp(name, key, keyLen) == 0 && name[keyLen] == '"') return (long)(t + 2);
+    }
+    return -1;
+}
+
+// Returns the token of the n-th item of the array starting at token, or -1.
+static long jsonIndexArrayItem(const JsonIndex* index, size_t token, size_t n) {
+    if (index->json[index->tokens[token]] != '[') return -1;
+    size_t end = index->jump[token];
+    for (size_t t = token + 1; t < end; t = jsonIndexSkip(index, t) + 1) {
+        if (n-- == 0) return (long)t;
+    }
+    return -1;
+}
+
+static bool jsonIndexString(const JsonIndex* index, size_t token, char* out, size_t capacity) {
+    const char* start = index->json + index->tokens[token];
+    if (*start != '"') return false;
+    const char* end = token + 1 < index->tokenCount ? index->json + index->tokens[token + 1] : index->json + index->length;
+    while (end > start && *end != '"') end--; // closing quote is the last quote before the next token
+    return end > start && jsonUnescape(start + 1, (size_t)(end - start - 1), out, capacity);
+}
+
+bool jsonIndexNumber(const JsonIndex* index, size_t token, double* out) {
+    const char* start = index->json + index->tokens[token];
+    char* end = NULL;
+    *out = strtod(start, &end);
+    return end != start;
+}
+
+static bool jsonIndexUserRecord(const JsonIndex* index, UserRecord* record) {
+    long user = jsonIndexObjectGet(index, 0, "u");
+    if (user < 0) return false;
+    long fullName = jsonIndexObjectGet(index, user, "full-name");
+    long email = jsonIndexObjectGet(index, user, "email");
+    if (fullName < 0 || email < 0) return false;
+    long fullNameValue = jsonIndexArrayItem(index, fullName, 0);
+    long emailValue = jsonIndexArrayItem(index, email, 0);
+    if (fullNameValue < 0 || emailValue < 0) return false;
+    fullNameValue = jsonIndexObjectGet(index, fullNameValue, "value");
+    emailValue = jsonIndexObjectGet(index, emailValue, "value");
+    return fullNameValue >= 0 && emailValue >= 0
+        && jsonIndexString(index, fullNameValue, record->fullName, sizeof(record->fullName))
+        && jsonIndexString(index, emailValue, record->email, sizeof(record->email));
+}
+
+// Parses synthetic fetch answers with each stage-1 kernel and with cJSON, reporting GB/s.
+void benchmarkJsonIndex(size_t answers) {
+    const size_t distinct = 1024;
+    char** samples = malloc(distinct * sizeof(char*));
+    size_t* lengths = malloc(distinct * sizeof(size_t));
+    size_t bytes = 0;
+    for (size_t i = 0; i < distinct; i++) {
+        samples[i] = malloc(512);
+        snprintf(samples[i], 512, "{\"u\": {\"email\": [{\"value\": \"user%zu@typedb.com\", \"value_type\": \"string\", \"type\": {\"label\": \"email\", \"root\": \"attribute\"}}], \"full-name\": [{\"value\": \"User \\\"%zu\\\"\", \"value_type\": \"string\", \"type\": {\"label\": \"full-name\", \"root\": \"attribute\"}}], \"type\": {\"label\": \"person\", \"root\": \"entity\"}}}", i, i);
+        lengths[i] = strlen(samples[i]);
+        bytes += lengths[i];
+    }
+    double gigabytes = (double)bytes / distinct * answers / 1e9;
+    struct { const char* name; JsonClassifyFn fn; } kernels[] = {
+        {"scalar", jsonClassifyScalar},
+#ifdef JSON_SCAN_X86
+        {"sse2", jsonClassifySse2},
+        {"avx2", __builtin_cpu_supports("avx2") ? jsonClassifyAvx2 : NULL},
+#endif
+    };
+    printf("JSON structural index benchmark (%zu answers)\n", answers);
+    JsonIndex index = {0};
+    UserRecord record;
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (kernels[k].fn == NULL) continue;
+        size_t parsed = 0;
+        double started = monotonicSeconds();
+        for (size_t i = 0; i < answers; i++) {
+            if (jsonIndexBuildWith(&index, samples[i % distinct], lengths[i % distinct], kernels[k].fn) && jsonIndexUserRecord(&index, &record)) parsed++;
+        }
+        double seconds = monotonicSeconds() - started;
+        printf("  %-8s %.3f s, %.2f GB/s (%zu parsed)\n", kernels[k].name, seconds, gigabytes / seconds, parsed);
+    }
+    jsonIndexFree(&index);
+    size_t parsed = 0;
+    double started = monotonicSeconds();
+    for (size_t i = 0; i < answers; i++) {
+        cJSON* root = cJSON_ParseWithLength(samples[i % distinct], lengths[i % distinct]);
+        if (root != NULL) parsed++;
+        cJSON_Delete(root);
+    }
+    double seconds = monotonicSeconds() - started;
+    printf("  %-8s %.3f s, %.2f GB/s (%zu parsed)\n", "cJSON", seconds, gigabytes / seconds, parsed);
+    for (size_t i = 0; i < distinct; i++) free(samples[i]);
+    free(samples);
+    free(lengths);
+}
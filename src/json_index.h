@@ -0,0 +1,27 @@
+#ifndef TUTORIAL_JSON_INDEX_H
+#define TUTORIAL_JSON_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_INDEX_BENCHMARK_ANSWERS 1000000
+
+// Structural index of one JSON document (simdjson-style stage 1). Every token has one entry: the
+// position of a structural character, of a string's opening quote, or of the first byte of a scalar.
+// For '{' and '[' tokens, jump holds the token index of the matching close bracket.
+typedef struct {
+    const char* json;
+    size_t length;
+    uint32_t* tokens;
+    uint32_t* jump;
+    size_t tokenCount;
+    size_t capacity;
+} JsonIndex;
+
+void jsonIndexFree(JsonIndex* index);
+bool jsonIndexBuild(JsonIndex* index, const char* json, size_t length);
+bool jsonIndexNumber(const JsonIndex* index, size_t token, double* out);
+void benchmarkJsonIndex(size_t answers);
+
+#endif
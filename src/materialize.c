@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "materialize.h"
+#include "profiling.h"
+#include "query_pipeline.h"
+#include "string_map.h"
+#include "permission_index.h"
+#include "datalog.h"
+
+#define MATERIALIZE_PROVENANCE "add-view-permission"
+#define MATERIALIZE_BATCH_SIZE 500
+
+// The rule permissions are materialized from: its when pattern and the variables its conclusion binds
+// to the subject and access roles. The pattern is always evaluated with inference on, so permissions
+// that other rules derive feed it as they would at query time.
+typedef struct {
+    char* when;
+    char subject[256];
+    char access[256];
+} MaterializeRule;
+
+static void iidPairsAdd(IidPairs* pairs, const char* first, const char* second) {
+    if (pairs->count == pairs->capacity) {
+        pairs->capacity = pairs->capacity ? pairs->capacity * 2 : 256;
+        pairs->firsts = realloc(pairs->firsts, pairs->capacity * sizeof(char*));
+        pairs->seconds = realloc(pairs->seconds, pairs->capacity * sizeof(char*));
+    }
+    pairs->firsts[pairs->count] = strdup(first);
+    pairs->seconds[pairs->count++] = strdup(second);
+}
+
+void iidPairsFree(IidPairs* pairs) {
+    for (size_t i = 0; i < pairs->count; i++) {
+        free(pairs->firsts[i]);
+        free(pairs->seconds[i]);
+    }
+    free(pairs->firsts);
+    free(pairs->seconds);
+    memset(pairs, 0, sizeof(IidPairs));
+}
+
+// Reads MATERIALIZE_PROVENANCE from the schema, so the queries below follow the rule as it is defined.
+static bool materializeRuleLoad(Session* session, MaterializeRule* rule) {
+    memset(rule, 0, sizeof(MaterializeRule));
+    Options* opts = options_new();
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        options_drop(opts);
+        return false;
+    }
+    Rule* found = rule_promise_resolve(logic_manager_get_rule(tx, MATERIALIZE_PROVENANCE));
+    if (found != NULL && !FAILED()) {
+        char* when = rule_get_when(found);
+        char* then = rule_get_then(found);
+        // Kept as a braced conjunction, which embeds in match and not clauses as it stands.
+        const char* start = when + strspn(when, " \t\r\n");
+        size_t len = strlen(start) + 5;
+        rule->when = malloc(len);
+        snprintf(rule->when, len, *start == '{' ? "%s" : "{ %s }", start);
+        TypeQLLexer lexer = { .at = then };
+        for (typeqlNext(&lexer); lexer.kind != 0; typeqlNext(&lexer)) {
+            if (lexer.kind != 'a') continue;
+            char* var = strcmp(lexer.token, "subject") == 0 ? rule->subject : strcmp(lexer.token, "access") == 0 ? rule->access : NULL;
+            if (var == NULL) continue;
+            typeqlNext(&lexer);
+            if (lexer.kind != ':') continue;
+            typeqlNext(&lexer);
+            if (lexer.kind == '$') snprintf(var, sizeof(rule->subject), "%s", lexer.token);
+        }
+        string_free(then);
+        string_free(when);
+        rule_drop(found);
+    }
+    transaction_close(tx);
+    options_drop(opts);
+    if (rule->when != NULL && rule->subject[0] != '\0' && rule->access[0] != '\0') return true;
+    free(rule->when);
+    rule->when = NULL;
+    return false;
+}
+
+// Runs a get query in a read transaction and hands row the IIDs bound to vars, in order, for each answer.
+bool readIidRows(Session* session, const char* query, bool inference, const char* const* vars, int varCount,
+                 void (*row)(void* context, char* const* iids), void* context) {
+    Options* opts = options_new();
+    options_set_infer(opts, inference);
+    options_set_parallel(opts, true);
+    Transaction* tx = transaction_new(session, Read, opts);
+    if (tx == NULL || FAILED()) {
+        options_drop(opts);
+        return false;
+    }
+    ConceptMapIterator* response = query_get(tx, query, opts);
+    ConceptMap* cm = NULL;
+    char* iids[4];
+    while (response != NULL && (cm = concept_map_iterator_next(response)) != NULL) {
+        for (int v = 0; v < varCount; v++) iids[v] = conceptMapIid(cm, vars[v]);
+        row(context, iids);
+        for (int v = 0; v < varCount; v++) string_free(iids[v]);
+        concept_map_drop(cm);
+    }
+    bool read = response != NULL && !FAILED();
+    concept_map_iterator_drop(response);
+    transaction_close(tx);
+    options_drop(opts);
+    return read;
+}
+
+static void iidPairsRow(void* context, char* const* iids) {
+    iidPairsAdd((IidPairs*)context, iids[0], iids[1]);
+}
+
+// Collects the IIDs bound to two variables of a get query.
+bool readIidPairs(Session* session, const char* query, bool inference, const char* firstVar, const char* secondVar, IidPairs* pairs) {
+    const char* vars[2] = { firstVar, secondVar };
+    return readIidRows(session, query, inference, vars, 2, iidPairsRow, pairs);
+}
+
+// The pairs as sorted, distinct "first second" keys.
+static char** iidPairKeys(const IidPairs* pairs, size_t* count) {
+    char** keys = malloc((pairs->count + 1) * sizeof(char*));
+    for (size_t i = 0; i < pairs->count; i++) {
+        size_t len = strlen(pairs->firsts[i]) + strlen(pairs->seconds[i]) + 2;
+        keys[i] = malloc(len);
+        snprintf(keys[i], len, "%s %s", pairs->firsts[i], pairs->seconds[i]);
+    }
+    qsort(keys, pairs->count, sizeof(char*), compareStrings);
+    *count = 0;
+    for (size_t i = 0; i < pairs->count; i++) {
+        if (*count > 0 && strcmp(keys[*count - 1], keys[i]) == 0) free(keys[i]);
+        else keys[(*count)++] = keys[i];
+    }
+    return keys;
+}
+
+static void iidPairKeysFree(char** keys, size_t count) {
+    for (size_t k = 0; k < count; k++) free(keys[k]);
+    free(keys);
+}
+
+static void materializeInsertQuery(void* context, size_t index, char* query, size_t size) {
+    const IidPairs* pairs = (const IidPairs*)context;
+    snprintf(query, size, "match $s iid %s; $a iid %s; insert (subject: $s, access: $a) isa permission, has provenance \"%s\";",
+             pairs->firsts[index], pairs->seconds[index], MATERIALIZE_PROVENANCE);
+}
+
+static void materializeDeleteQuery(void* context, size_t index, char* query, size_t size) {
+    const IidPairs* pairs = (const IidPairs*)context;
+    snprintf(query, size, "match $s iid %s; $a iid %s; $p (subject: $s, access: $a) isa permission, has provenance \"%s\"; delete $p isa permission;",
+             pairs->firsts[index], pairs->seconds[index], MATERIALIZE_PROVENANCE);
+}
+
+// Writes the (subject, access) pairs as explicit permissions tagged with their provenance,
+// MATERIALIZE_BATCH_SIZE per transaction.
+static void writeMaterializedPermissions(Session* session, const IidPairs* pairs, MaterializeStats* stats) {
+    runBatchedInserts(session, pairs->count, MATERIALIZE_BATCH_SIZE, materializeInsertQuery, (void*)pairs, &stats->written, &stats->failed);
+}
+
+// Deletes the materialized copies of the (subject, access) pairs, MATERIALIZE_BATCH_SIZE per transaction.
+static void deleteMaterializedPermissions(Session* session, const IidPairs* pairs, MaterializeStats* stats) {
+    runBatchedDeletes(session, pairs->count, MATERIALIZE_BATCH_SIZE, materializeDeleteQuery, (void*)pairs, &stats->removed, &stats->failed);
+}
+
+// The "first second" keys on one side only, split back into pairs.
+static void iidPairKeysMissing(char** keys, size_t count, char** others, size_t otherCount, IidPairs* missing) {
+    for (size_t k = 0; k < count; k++) {
+        if (bsearch(&keys[k], others, otherCount, sizeof(char*), compareStrings) != NULL) continue;
+        char* second = strchr(keys[k], ' ');
+        *second = '\0';
+        iidPairsAdd(missing, keys[k], second + 1);
+        *second = ' ';
+    }
+}
+
+// Brings one subject's materialized permissions (every subject's when subjectIid is NULL) in line with
+// what the rule derives: writes the missing conclusions first, then deletes the copies the rule no
+// longer derives, so the subject never loses a permission it still holds. Stale copies are found in a
+// read transaction, because inference is not available in the write transactions that delete them.
+static void materializeSubject(Session* session, const MaterializeRule* rule, const char* subjectIid, MaterializeStats* stats) {
+    char subjectFilter[384] = "";
+    if (subjectIid != NULL) snprintf(subjectFilter, sizeof(subjectFilter), "$%s iid %s; ", rule->subject, subjectIid);
+    size_t len = strlen(rule->when) + 1024;
+    char* query = malloc(len);
+    IidPairs derived = {0}, stored = {0}, materialized = {0}, missing = {0}, stale = {0};
+    snprintf(query, len, "match %s; %sget $%s, $%s;", rule->when, subjectFilter, rule->subject, rule->access);
+    bool read = readIidPairs(session, query, true, rule->subject, rule->access, &derived);
+    snprintf(query, len, "match $p (subject: $%s, access: $%s) isa permission; %sget $%s, $%s;", rule->subject, rule->access, subjectFilter, rule->subject, rule->access);
+    read = read && readIidPairs(session, query, false, rule->subject, rule->access, &stored);
+    snprintf(query, len, "match $p (subject: $%s, access: $%s) isa permission, has provenance \"%s\"; %sget $%s, $%s;",
+             rule->subject, rule->access, MATERIALIZE_PROVENANCE, subjectFilter, rule->subject, rule->access);
+    read = read && readIidPairs(session, query, false, rule->subject, rule->access, &materialized);
+    if (!read) {
+        fprintf(stderr, "Failed to read derived permissions.\n");
+        stats->failed++;
+    } else {
+        size_t derivedCount, storedCount, materializedCount;
+        char** derivedKeys = iidPairKeys(&derived, &derivedCount);
+        char** storedKeys = iidPairKeys(&stored, &storedCount);
+        char** materializedKeys = iidPairKeys(&materialized, &materializedCount);
+        stats->derived += derivedCount;
+        iidPairKeysMissing(derivedKeys, derivedCount, storedKeys, storedCount, &missing);
+        iidPairKeysMissing(materializedKeys, materializedCount, derivedKeys, derivedCount, &stale);
+        iidPairKeysFree(derivedKeys, derivedCount);
+        iidPairKeysFree(storedKeys, storedCount);
+        iidPairKeysFree(materializedKeys, materializedCount);
+        size_t failed = stats->failed;
+        writeMaterializedPermissions(session, &missing, stats);
+        // Stale copies go only once every missing one is written; the next run retries both otherwise.
+        if (stats->failed == failed) deleteMaterializedPermissions(session, &stale, stats);
+        if (stats->failed != failed) fprintf(stderr, "Failed to bring materialized permissions up to date.\n");
+    }
+    iidPairsFree(&derived);
+    iidPairsFree(&stored);
+    iidPairsFree(&materialized);
+    iidPairsFree(&missing);
+    iidPairsFree(&stale);
+    free(query);
+}
+
+// Materializes the permissions MATERIALIZE_PROVENANCE derives for the given subjects (all subjects when
+// subjectIids is NULL) as explicit permissions tagged with it, so reads with inference off see them.
+// Derived pairs already stored, with or without provenance, are not written again.
+static MaterializeStats materializePermissions(DatabaseManager* dbManager, const char* dbName, const char** subjectIids, size_t subjectCount) {
+    MaterializeStats stats = {0};
+    double started = monotonicSeconds();
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(opts);
+        stats.failed++;
+        return stats;
+    }
+    MaterializeRule rule;
+    if (!materializeRuleLoad(session, &rule)) {
+        fprintf(stderr, "Failed to read rule %s.\n", MATERIALIZE_PROVENANCE);
+        session_close(session);
+        options_drop(opts);
+        stats.failed++;
+        return stats;
+    }
+    size_t rounds = subjectIids == NULL ? 1 : subjectCount;
+    for (size_t i = 0; i < rounds; i++) {
+        materializeSubject(session, &rule, subjectIids == NULL ? NULL : subjectIids[i], &stats);
+        stats.subjects++;
+    }
+    free(rule.when);
+    session_close(session);
+    options_drop(opts);
+    stats.seconds = monotonicSeconds() - started;
+    printf("Materialized %zu new of %zu derived permissions and removed %zu stale ones for %s in %.2f s (%zu failed).\n", stats.written,
+           stats.derived, stats.removed, subjectIids == NULL ? "all subjects" : "changed subjects", stats.seconds, stats.failed);
+    return stats;
+}
+
+// Finds subjects whose materialized permissions no longer match what the rule derives, and refreshes
+// only those. Stats count failures in failed, including a session or rule that could not be read.
+MaterializeStats refreshMaterializedPermissions(DatabaseManager* dbManager, const char* dbName) {
+    MaterializeStats stats = {0};
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(opts);
+        stats.failed++;
+        return stats;
+    }
+    MaterializeRule rule;
+    if (!materializeRuleLoad(session, &rule)) {
+        fprintf(stderr, "Failed to read rule %s.\n", MATERIALIZE_PROVENANCE);
+        session_close(session);
+        options_drop(opts);
+        stats.failed++;
+        return stats;
+    }
+    IidPairs stored = {0}, derived = {0}, explicit = {0};
+    size_t len = strlen(rule.when) + 512;
+    char* query = malloc(len);
+    snprintf(query, len, "match $p (subject: $s, access: $a) isa permission, has provenance \"%s\"; get $s, $a;", MATERIALIZE_PROVENANCE);
+    bool read = readIidPairs(session, query, false, "s", "a", &stored);
+    snprintf(query, len, "match %s; get $%s, $%s;", rule.when, rule.subject, rule.access);
+    read = read && readIidPairs(session, query, true, rule.subject, rule.access, &derived);
+    snprintf(query, len, "match $p (subject: $s, access: $a) isa permission; not { $p has provenance \"%s\"; }; get $s, $a;", MATERIALIZE_PROVENANCE);
+    read = read && readIidPairs(session, query, false, "s", "a", &explicit);
+    free(query);
+    free(rule.when);
+    session_close(session);
+    options_drop(opts);
+    IidPairs* sides[3] = { &stored, &derived, &explicit };
+    if (!read) {
+        fprintf(stderr, "Failed to compare materialized permissions.\n");
+        for (int side = 0; side < 3; side++) iidPairsFree(sides[side]);
+        stats.failed++;
+        return stats;
+    }
+    // A key on one side only marks its subject as changed. Derived pairs that are already stored without
+    // provenance need no materialized copy.
+    char** keys[3];
+    size_t counts[3];
+    for (int side = 0; side < 3; side++) keys[side] = iidPairKeys(sides[side], &counts[side]);
+    StringMap changed;
+    stringMapInit(&changed, 64);
+    size_t i = 0, j = 0;
+    while (i < counts[0] || j < counts[1]) {
+        int cmp = i == counts[0] ? 1 : j == counts[1] ? -1 : strcmp(keys[0][i], keys[1][j]);
+        if (cmp == 0) {
+            i++;
+            j++;
+            continue;
+        }
+        char* key = cmp < 0 ? keys[0][i++] : keys[1][j++];
+        if (cmp > 0 && bsearch(&key, keys[2], counts[2], sizeof(char*), compareStrings) != NULL) continue;
+        *strchr(key, ' ') = '\0';
+        stringMapPut(&changed, key, (void*)1);
+    }
+    const char** subjects = malloc((changed.count + 1) * sizeof(char*));
+    size_t subjectCount = 0;
+    for (size_t slot = 0; slot < changed.capacity; slot++) {
+        if (changed.keys[slot] != NULL) subjects[subjectCount++] = changed.keys[slot];
+    }
+    if (subjectCount > 0) stats = materializePermissions(dbManager, dbName, subjects, subjectCount);
+    else printf("Materialized permissions are up to date.\n");
+    free(subjects);
+    stringMapFree(&changed, NULL);
+    for (int side = 0; side < 3; side++) {
+        iidPairKeysFree(keys[side], counts[side]);
+        iidPairsFree(sides[side]);
+    }
+    return stats;
+}
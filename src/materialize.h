@@ -0,0 +1,29 @@
+#ifndef TUTORIAL_MATERIALIZE_H
+#define TUTORIAL_MATERIALIZE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t derived;
+    size_t written;
+    size_t removed;
+    size_t subjects;
+    size_t failed;
+    double seconds;
+} MaterializeStats;
+
+// IIDs read in pairs from a query, such as (subject, access) for permissions.
+typedef struct {
+    char** firsts;
+    char** seconds;
+    size_t count;
+    size_t capacity;
+} IidPairs;
+
+void iidPairsFree(IidPairs* pairs);
+bool readIidRows(Session* session, const char* query, bool inference, const char* const* vars, int varCount, void (*row)(void* context, char* const* iids), void* context);
+bool readIidPairs(Session* session, const char* query, bool inference, const char* firstVar, const char* secondVar, IidPairs* pairs);
+MaterializeStats refreshMaterializedPermissions(DatabaseManager* dbManager, const char* dbName);
+
+#endif
@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "membership_closure.h"
+#include "profiling.h"
+#include "materialize.h"
+
+#define MEMBERSHIP_QUERY "match (member: $m, parent: $p) isa membership; get $m, $p;"
+#define MEMBERSHIP_MAX_THREADS 64
+
+static void membershipClosureCompute(MembershipGraph* graph, int threads);
+
+// Builds the rows from (member, parent) pairs with a counting sort.
+void membershipGraphInit(MembershipGraph* graph, uint32_t nodeCount, const uint32_t* edges, size_t edgeCount) {
+    memset(graph, 0, sizeof(MembershipGraph));
+    graph->nodeCount = nodeCount;
+    graph->offsets = calloc((size_t)nodeCount + 1, sizeof(uint32_t));
+    graph->parents = malloc((edgeCount + 1) * sizeof(uint32_t));
+    for (size_t e = 0; e < edgeCount; e++) graph->offsets[edges[2 * e] + 1]++;
+    for (uint32_t v = 0; v < nodeCount; v++) graph->offsets[v + 1] += graph->offsets[v];
+    uint32_t* fill = malloc(((size_t)nodeCount + 1) * sizeof(uint32_t));
+    memcpy(fill, graph->offsets, ((size_t)nodeCount + 1) * sizeof(uint32_t));
+    for (size_t e = 0; e < edgeCount; e++) graph->parents[fill[edges[2 * e]]++] = edges[2 * e + 1];
+    free(fill);
+    stringMapInit(&graph->ids, 16);
+}
+
+void membershipGraphFree(MembershipGraph* graph) {
+    if (graph->ancestors != NULL) {
+        for (uint32_t v = 0; v < graph->nodeCount; v++) roaringFree(&graph->ancestors[v]);
+    }
+    if (graph->iids != NULL) {
+        for (uint32_t v = 0; v < graph->nodeCount; v++) free(graph->iids[v]);
+    }
+    free(graph->ancestors);
+    free(graph->iids);
+    free(graph->offsets);
+    free(graph->parents);
+    stringMapFree(&graph->ids, NULL);
+}
+
+static uint32_t membershipNode(StringMap* ids, char*** iids, uint32_t* count, size_t* capacity, const char* iid) {
+    uint32_t id = (uint32_t)(uintptr_t)stringMapGet(ids, iid);
+    if (id != 0) return id - 1;
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 256;
+        *iids = realloc(*iids, *capacity * sizeof(char*));
+    }
+    (*iids)[*count] = strdup(iid);
+    stringMapPut(ids, iid, (void*)(uintptr_t)(*count + 1));
+    return (*count)++;
+}
+
+// Reads every explicit membership relation, numbers the members and parents in order of appearance, and
+// computes the closure on one thread per core.
+bool membershipGraphLoad(MembershipGraph* graph, DatabaseManager* dbManager, const char* dbName) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        options_drop(opts);
+        return false;
+    }
+    IidPairs pairs = {0}; // (member, parent) IIDs
+    bool read = readIidPairs(session, MEMBERSHIP_QUERY, false, "m", "p", &pairs);
+    session_close(session);
+    options_drop(opts);
+    if (!read) {
+        iidPairsFree(&pairs);
+        return false;
+    }
+    StringMap ids;
+    stringMapInit(&ids, pairs.count);
+    char** iids = NULL;
+    uint32_t count = 0;
+    size_t capacity = 0;
+    uint32_t* edges = malloc((pairs.count + 1) * 2 * sizeof(uint32_t));
+    for (size_t e = 0; e < pairs.count; e++) {
+        edges[2 * e] = membershipNode(&ids, &iids, &count, &capacity, pairs.firsts[e]);
+        edges[2 * e + 1] = membershipNode(&ids, &iids, &count, &capacity, pairs.seconds[e]);
+    }
+    membershipGraphInit(graph, count, edges, pairs.count);
+    stringMapFree(&graph->ids, NULL);
+    graph->ids = ids;
+    graph->iids = iids;
+    free(edges);
+    iidPairsFree(&pairs);
+    membershipClosureCompute(graph, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    return true;
+}
+
+typedef struct {
+    MembershipGraph* graph;
+    _Atomic uint32_t nextBatch;
+} MembershipClosureJob;
+
+static int compareNodes(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Bit-parallel BFS: each worker takes 64 consecutive sources at a time and walks the graph for all of
+// them at once, one bit per source in the visited, frontier and next words of every node. A node is
+// expanded once per level however many of the 64 searches reach it.
+static void* membershipClosureWorker(void* arg) {
+    MembershipClosureJob* job = (MembershipClosureJob*)arg;
+    MembershipGraph* graph = job->graph;
+    uint32_t n = graph->nodeCount;
+    uint64_t* visited = calloc(n, sizeof(uint64_t));
+    uint64_t* frontier = calloc(n, sizeof(uint64_t));
+    uint64_t* next = calloc(n, sizeof(uint64_t));
+    uint32_t* active = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    uint32_t* reached = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    uint32_t* touched = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    for (uint32_t batch; (batch = atomic_fetch_add(&job->nextBatch, 1)) * 64ull < n;) {
+        uint32_t first = batch * 64, sources = n - first < 64 ? n - first : 64;
+        size_t activeCount = 0, touchedCount = 0;
+        for (uint32_t i = 0; i < sources; i++) {
+            visited[first + i] = frontier[first + i] = 1ull << i;
+            active[activeCount++] = touched[touchedCount++] = first + i;
+        }
+        while (activeCount > 0) {
+            size_t reachedCount = 0;
+            for (size_t a = 0; a < activeCount; a++) {
+                uint32_t v = active[a];
+                for (uint32_t e = graph->offsets[v]; e < graph->offsets[v + 1]; e++) {
+                    uint32_t parent = graph->parents[e];
+                    uint64_t bits = frontier[v] & ~visited[parent];
+                    if (bits == 0) continue;
+                    if (next[parent] == 0) reached[reachedCount++] = parent;
+                    next[parent] |= bits;
+                }
+                frontier[v] = 0;
+            }
+            for (size_t r = 0; r < reachedCount; r++) {
+                uint32_t v = reached[r];
+                if (visited[v] == 0) touched[touchedCount++] = v;
+                visited[v] |= next[v];
+                frontier[v] = next[v];
+                next[v] = 0;
+            }
+            uint32_t* swap = active;
+            active = reached;
+            reached = swap;
+            activeCount = reachedCount;
+        }
+        // Ascending order keeps every roaringAdd an append.
+        qsort(touched, touchedCount, sizeof(uint32_t), compareNodes);
+        for (size_t t = 0; t < touchedCount; t++) {
+            uint32_t v = touched[t];
+            for (uint64_t bits = visited[v]; bits; bits &= bits - 1) {
+                uint32_t source = first + (uint32_t)__builtin_ctzll(bits);
+                if (source != v) roaringAdd(&graph->ancestors[source], v);
+            }
+            visited[v] = 0;
+        }
+    }
+    free(visited);
+    free(frontier);
+    free(next);
+    free(active);
+    free(reached);
+    free(touched);
+    return NULL;
+}
+
+// Computes the ancestors of every node. Cycles are harmless: a node is never its own ancestor.
+static void membershipClosureCompute(MembershipGraph* graph, int threads) {
+    if (graph->ancestors != NULL) {
+        for (uint32_t v = 0; v < graph->nodeCount; v++) roaringFree(&graph->ancestors[v]);
+    }
+    free(graph->ancestors);
+    graph->ancestors = calloc((size_t)graph->nodeCount + 1, sizeof(Roaring));
+    threads = threads < 1 ? 1 : threads > MEMBERSHIP_MAX_THREADS ? MEMBERSHIP_MAX_THREADS : threads;
+    MembershipClosureJob job = { graph, 0 };
+    pthread_t workers[MEMBERSHIP_MAX_THREADS];
+    for (int t = 1; t < threads; t++) pthread_create(&workers[t], NULL, membershipClosureWorker, &job);
+    membershipClosureWorker(&job);
+    for (int t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+}
+
+// Visits the IID of every group, set or collection the member belongs to directly or transitively.
+// Returns the number visited, or -1 if the member is not in any membership.
+long membershipEffectiveGroups(const MembershipGraph* graph, const char* memberIid, void (*visit)(const char* iid, void* context), void* context) {
+    uint32_t id = (uint32_t)(uintptr_t)stringMapGet(&graph->ids, memberIid);
+    if (id == 0 || graph->ancestors == NULL) return -1;
+    const Roaring* ancestors = &graph->ancestors[id - 1];
+    for (size_t i = 0; visit != NULL && i < ancestors->count; i++) {
+        const RoaringContainer* c = &ancestors->containers[i];
+        for (uint32_t k = 0; k < c->cardinality && !c->bits; k++) visit(graph->iids[((uint32_t)c->key << 16) | c->values[k]], context);
+        for (int w = 0; c->bits && w < ROARING_BITMAP_WORDS; w++) {
+            for (uint64_t word = c->bits[w]; word; word &= word - 1) visit(graph->iids[((uint32_t)c->key << 16) | (uint32_t)(w * 64 + __builtin_ctzll(word))], context);
+        }
+    }
+    return (long)roaringCardinality(ancestors);
+}
+
+bool membershipIsMember(const MembershipGraph* graph, const char* memberIid, const char* groupIid) {
+    uint32_t member = (uint32_t)(uintptr_t)stringMapGet(&graph->ids, memberIid);
+    uint32_t group = (uint32_t)(uintptr_t)stringMapGet(&graph->ids, groupIid);
+    return member != 0 && group != 0 && graph->ancestors != NULL && roaringContains(&graph->ancestors[member - 1], group - 1);
+}
+
+static void benchmarkMembershipShape(const char* shape, uint32_t nodeCount, const uint32_t* edges, size_t edgeCount, int threads) {
+    MembershipGraph graph;
+    membershipGraphInit(&graph, nodeCount, edges, edgeCount);
+    double started = monotonicSeconds();
+    membershipClosureCompute(&graph, 1);
+    double single = monotonicSeconds() - started;
+    started = monotonicSeconds();
+    membershipClosureCompute(&graph, threads);
+    double parallel = monotonicSeconds() - started;
+    uint64_t pairs = 0;
+    size_t bytes = 0;
+    for (uint32_t v = 0; v < nodeCount; v++) {
+        pairs += roaringCardinality(&graph.ancestors[v]);
+        bytes += roaringMemory(&graph.ancestors[v]);
+    }
+    unsigned int seed = 7;
+    size_t lookups = 1000000, hits = 0;
+    started = monotonicSeconds();
+    for (size_t i = 0; i < lookups; i++) {
+        uint32_t member = rand_r(&seed) % nodeCount, group = rand_r(&seed) % nodeCount;
+        hits += roaringContains(&graph.ancestors[member], group);
+    }
+    double lookup = monotonicSeconds() - started;
+    printf("  %s: %u nodes, %zu edges, %llu closure pairs in %zu bytes; %.3f s on 1 thread, %.3f s on %d; %.3f us per lookup (%zu hits)\n",
+           shape, nodeCount, edgeCount, (unsigned long long)pairs, bytes, single, parallel, threads, lookup / lookups * 1e6, hits);
+    membershipGraphFree(&graph);
+}
+
+// Deep: users at the bottom of chains of 256 nested groups. Wide: a shallow tree with a large
+// fan-out where every user also belongs to several random groups.
+void benchmarkMembershipClosure(uint32_t nodeCount, int threads) {
+    printf("Membership closure benchmark\n");
+    if (nodeCount < 4) { // a quarter of the nodes are groups, and both shapes need one
+        fprintf(stderr, "The membership closure benchmark needs at least 4 nodes.\n");
+        return;
+    }
+    uint32_t* edges = malloc((size_t)nodeCount * 4 * 2 * sizeof(uint32_t));
+    size_t edgeCount = 0;
+    uint32_t groups = nodeCount / 4, depth = 256;
+    uint32_t chains = groups / depth > 0 ? groups / depth : 1;
+    for (uint32_t g = chains; g < groups; g++) {
+        edges[2 * edgeCount] = g;
+        edges[2 * edgeCount++ + 1] = g - chains;
+    }
+    for (uint32_t u = groups; u < nodeCount; u++) {
+        edges[2 * edgeCount] = u;
+        edges[2 * edgeCount++ + 1] = groups - 1 - u % chains;
+    }
+    benchmarkMembershipShape("deep", nodeCount, edges, edgeCount, threads);
+
+    unsigned int seed = 11;
+    uint32_t fanOut = 32;
+    edgeCount = 0;
+    for (uint32_t g = 1; g < groups; g++) {
+        edges[2 * edgeCount] = g;
+        edges[2 * edgeCount++ + 1] = (g - 1) / fanOut;
+    }
+    for (uint32_t u = groups; u < nodeCount; u++) {
+        for (int k = 0; k < 3; k++) {
+            edges[2 * edgeCount] = u;
+            edges[2 * edgeCount++ + 1] = rand_r(&seed) % groups;
+        }
+    }
+    benchmarkMembershipShape("wide", nodeCount, edges, edgeCount, threads);
+    free(edges);
+}
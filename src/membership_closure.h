@@ -0,0 +1,27 @@
+#ifndef TUTORIAL_MEMBERSHIP_CLOSURE_H
+#define TUTORIAL_MEMBERSHIP_CLOSURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "string_map.h"
+#include "access_bitmaps.h"
+
+// Membership edges from member to parent in compressed sparse row form, covering group, set and
+// collection membership alike, with the transitive closure kept as one bitmap of ancestors per node.
+typedef struct {
+    uint32_t nodeCount;
+    uint32_t* offsets;  // nodeCount + 1 entries; the parents of v are parents[offsets[v]..offsets[v + 1])
+    uint32_t* parents;
+    char** iids;        // NULL for synthetic graphs
+    StringMap ids;      // iid -> node + 1
+    Roaring* ancestors; // filled by membershipClosureCompute
+} MembershipGraph;
+
+void membershipGraphInit(MembershipGraph* graph, uint32_t nodeCount, const uint32_t* edges, size_t edgeCount);
+void membershipGraphFree(MembershipGraph* graph);
+bool membershipGraphLoad(MembershipGraph* graph, DatabaseManager* dbManager, const char* dbName);
+long membershipEffectiveGroups(const MembershipGraph* graph, const char* memberIid, void (*visit)(const char* iid, void* context), void* context);
+bool membershipIsMember(const MembershipGraph* graph, const char* memberIid, const char* groupIid);
+void benchmarkMembershipClosure(uint32_t nodeCount, int threads);
+
+#endif
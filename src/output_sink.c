@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include "../include/typedb_driver.h"
+#include "output_sink.h"
+
+#define OUTPUT_SINK_BUFFER_SIZE (1 << 16)
+
+void byteBufferReserve(ByteBuffer* buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) return;
+    buffer->capacity = (buffer->size + extra) * 2;
+    buffer->data = realloc(buffer->data, buffer->capacity);
+}
+
+void byteBufferAppend(ByteBuffer* buffer, const void* data, size_t len) {
+    byteBufferReserve(buffer, len);
+    memcpy(buffer->data + buffer->size, data, len);
+    buffer->size += len;
+}
+
+void byteBufferPad(ByteBuffer* buffer, size_t alignment) {
+    static const char zeros[8] = {0};
+    byteBufferAppend(buffer, zeros, (alignment - buffer->size % alignment) % alignment);
+}
+
+void byteBufferPatch(ByteBuffer* buffer, size_t position, const void* data, size_t len) {
+    memcpy(buffer->data + position, data, len);
+}
+
+void byteBufferFree(ByteBuffer* buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(ByteBuffer));
+}
+
+void encodeJsonString(ByteBuffer* out, const char* text, size_t len) {
+    byteBufferReserve(out, len + 2);
+    out->data[out->size++] = '"';
+    for (size_t i = 0; i < len; i++) {
+        unsigned char ch = (unsigned char)text[i];
+        if (ch == '"' || ch == '\\') {
+            char escaped[2] = {'\\', (char)ch};
+            byteBufferAppend(out, escaped, 2);
+        } else if (ch < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+            byteBufferAppend(out, escaped, 6);
+        } else {
+            byteBufferReserve(out, 1);
+            out->data[out->size++] = (char)ch;
+        }
+    }
+    byteBufferAppend(out, "\"", 1);
+}
+
+static void sinkFormatText(OutputSink* sink, const char* record, int index, const SinkField* fields, size_t count);
+
+static char STDOUT_SINK_BUFFER[OUTPUT_SINK_BUFFER_SIZE];
+OutputSink STDOUT_SINK = {
+    .fd = STDOUT_FILENO,
+    .buffer = STDOUT_SINK_BUFFER,
+    .used = 0,
+    .capacity = OUTPUT_SINK_BUFFER_SIZE,
+    .useWritev = true,
+    .formatter = sinkFormatText,
+    .lock = MUTEX_INITIALIZER,
+};
+
+void sinkInit(OutputSink* sink, int fd, size_t capacity, bool useWritev, SinkFormatter formatter) {
+    sink->fd = fd;
+    sink->buffer = malloc(capacity);
+    sink->used = 0;
+    sink->capacity = capacity;
+    sink->useWritev = useWritev;
+    sink->formatter = formatter != NULL ? formatter : sinkFormatText;
+    mutexInit(&sink->lock);
+}
+
+static void sinkWriteFully(OutputSink* sink, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writeVector(sink->fd, iov, sink->useWritev ? count : 1);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            // Not handle_error: it flushes STDOUT_SINK, which may be the sink that failed.
+            fprintf(stderr, "Failed to write output.\n");
+            exit(EXIT_FAILURE);
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+static void sinkFlushLocked(OutputSink* sink, const void* extra, size_t extraLen) {
+    if (sink->fd == STDOUT_FILENO) fflush(stdout);
+    struct iovec iov[2];
+    int count = 0;
+    if (sink->used > 0) iov[count++] = (struct iovec){ sink->buffer, sink->used };
+    if (extraLen > 0) iov[count++] = (struct iovec){ (void*)extra, extraLen };
+    sinkWriteFully(sink, iov, count);
+    sink->used = 0;
+}
+
+static void sinkWriteLocked(OutputSink* sink, const void* data, size_t len) {
+    // Anything printed through stdio must reach the descriptor before the sink's first bytes.
+    if (sink->used == 0 && sink->fd == STDOUT_FILENO) fflush(stdout);
+    if (sink->used + len <= sink->capacity) {
+        memcpy(sink->buffer + sink->used, data, len);
+        sink->used += len;
+    } else sinkFlushLocked(sink, data, len);
+}
+
+void sinkWrite(OutputSink* sink, const void* data, size_t len) {
+    mutexLock(&sink->lock);
+    sinkWriteLocked(sink, data, len);
+    mutexUnlock(&sink->lock);
+}
+
+static void sinkVprintfLocked(OutputSink* sink, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    size_t space = sink->capacity - sink->used;
+    int len = vsnprintf(sink->buffer + sink->used, space, format, copy);
+    va_end(copy);
+    if (len < 0) return;
+    if ((size_t)len < space) {
+        if (sink->used == 0 && sink->fd == STDOUT_FILENO) fflush(stdout);
+        sink->used += len;
+        return;
+    }
+    char* text = malloc(len + 1);
+    vsnprintf(text, len + 1, format, args);
+    sinkWriteLocked(sink, text, len);
+    free(text);
+}
+
+void sinkPrintf(OutputSink* sink, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    mutexLock(&sink->lock);
+    sinkVprintfLocked(sink, format, args);
+    mutexUnlock(&sink->lock);
+    va_end(args);
+}
+
+// Formats one result record, e.g. "File #3: /a/b" or "Added new user. Name: x, E-mail: y".
+void sinkRecord(OutputSink* sink, const char* record, int index, const SinkField* fields, size_t count) {
+    mutexLock(&sink->lock);
+    sink->formatter(sink, record, index, fields, count);
+    mutexUnlock(&sink->lock);
+}
+
+void sinkFlush(OutputSink* sink) {
+    mutexLock(&sink->lock);
+    sinkFlushLocked(sink, NULL, 0);
+    mutexUnlock(&sink->lock);
+}
+
+void sinkClose(OutputSink* sink) {
+    sinkFlush(sink);
+    mutexDestroy(&sink->lock);
+    free(sink->buffer);
+    sink->buffer = NULL;
+}
+
+// Formatters are called with the sink locked and write through sinkWriteLocked/sinkPrintfLocked.
+static void sinkPrintfLocked(OutputSink* sink, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    sinkVprintfLocked(sink, format, args);
+    va_end(args);
+}
+
+static void sinkFormatText(OutputSink* sink, const char* record, int index, const SinkField* fields, size_t count) {
+    if (index > 0) sinkPrintfLocked(sink, "%s #%d: ", record, index);
+    else sinkPrintfLocked(sink, "%s ", record);
+    for (size_t f = 0; f < count; f++) {
+        if (fields[f].key != NULL) sinkPrintfLocked(sink, "%s%s: %s", f > 0 ? ", " : "", fields[f].key, fields[f].value);
+        else sinkPrintfLocked(sink, "%s%s", f > 0 ? ", " : "", fields[f].value);
+        if (fields[f].suffix != NULL) sinkPrintfLocked(sink, "%s", fields[f].suffix);
+    }
+    sinkWriteLocked(sink, "\n", 1);
+}
+
+void sinkFormatJsonLines(OutputSink* sink, const char* record, int index, const SinkField* fields, size_t count) {
+    ByteBuffer line = {0};
+    byteBufferAppend(&line, "{\"record\":", 10);
+    encodeJsonString(&line, record, strlen(record));
+    char indexText[32];
+    byteBufferAppend(&line, indexText, snprintf(indexText, sizeof(indexText), ",\"index\":%d", index));
+    for (size_t f = 0; f < count; f++) {
+        byteBufferAppend(&line, ",", 1);
+        const char* key = fields[f].key != NULL ? fields[f].key : "value";
+        encodeJsonString(&line, key, strlen(key));
+        byteBufferAppend(&line, ":", 1);
+        encodeJsonString(&line, fields[f].value, strlen(fields[f].value));
+    }
+    byteBufferAppend(&line, "}\n", 2);
+    sinkWriteLocked(sink, line.data, line.size);
+    byteBufferFree(&line);
+}
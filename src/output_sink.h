@@ -0,0 +1,55 @@
+#ifndef TUTORIAL_OUTPUT_SINK_H
+#define TUTORIAL_OUTPUT_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "platform.h"
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+typedef struct {
+    const char* key; // NULL for an unlabelled value
+    const char* value;
+    const char* suffix; // written after the value by the text formatter only, NULL for none
+} SinkField;
+
+typedef struct OutputSink OutputSink;
+typedef void (*SinkFormatter)(OutputSink* sink, const char* record, int index, const SinkField* fields, size_t count);
+
+// Buffered writer over a file descriptor. Small writes are copied into the buffer; a payload larger
+// than the free space goes out together with the buffered bytes in one writev (or two writes when
+// useWritev is off) instead of being copied. All calls are serialized by the sink's lock. A sink on
+// STDOUT_FILENO flushes stdio before it starts buffering and before every write to the descriptor, so
+// printf output is never held back behind it; text printed with stdio while the sink holds bytes still
+// comes out ahead of them, so code that writes records prints through the sink until it flushes.
+struct OutputSink {
+    int fd;
+    char* buffer;
+    size_t used;
+    size_t capacity;
+    bool useWritev;
+    SinkFormatter formatter;
+    Mutex lock;
+};
+
+extern OutputSink STDOUT_SINK;
+
+void byteBufferReserve(ByteBuffer* buffer, size_t extra);
+void byteBufferAppend(ByteBuffer* buffer, const void* data, size_t len);
+void byteBufferPad(ByteBuffer* buffer, size_t alignment);
+void byteBufferPatch(ByteBuffer* buffer, size_t position, const void* data, size_t len);
+void byteBufferFree(ByteBuffer* buffer);
+void encodeJsonString(ByteBuffer* out, const char* text, size_t len);
+void sinkInit(OutputSink* sink, int fd, size_t capacity, bool useWritev, SinkFormatter formatter);
+void sinkWrite(OutputSink* sink, const void* data, size_t len);
+void sinkPrintf(OutputSink* sink, const char* format, ...);
+void sinkRecord(OutputSink* sink, const char* record, int index, const SinkField* fields, size_t count);
+void sinkFlush(OutputSink* sink);
+void sinkClose(OutputSink* sink);
+void sinkFormatJsonLines(OutputSink* sink, const char* record, int index, const SinkField* fields, size_t count);
+
+#endif
@@ -0,0 +1,444 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "path_trie.h"
+#include "typeql_escape.h"
+#include "profiling.h"
+#include "output_sink.h"
+#include "retry.h"
+#include "write_listeners.h"
+#include "permission_index.h"
+
+#define PATH_TRIE_QUERY "match $o isa object, has path $p; get $o, $p;"
+
+// Marks a path held by several objects; lookups report it as unknown so callers match by path.
+static char PATH_TRIE_AMBIGUOUS[] = "";
+
+static long pathTrieChild(const PathTrieNode* node, char first) {
+    long low = 0, high = (long)node->childCount - 1;
+    while (low <= high) {
+        long mid = (low + high) / 2;
+        unsigned char c = (unsigned char)node->children[mid]->label[0];
+        if (c == (unsigned char)first) return mid;
+        if (c < (unsigned char)first) low = mid + 1;
+        else high = mid - 1;
+    }
+    return -low - 1;
+}
+
+static PathTrieNode* pathTrieNode(const char* label, size_t length) {
+    PathTrieNode* node = calloc(1, sizeof(PathTrieNode));
+    node->label = malloc(length + 1);
+    memcpy(node->label, label, length);
+    node->label[length] = '\0';
+    node->length = length;
+    return node;
+}
+
+static void pathTrieAddChild(PathTrieNode* node, size_t at, PathTrieNode* child) {
+    node->children = realloc(node->children, (node->childCount + 1) * sizeof(PathTrieNode*));
+    memmove(&node->children[at + 1], &node->children[at], (node->childCount - at) * sizeof(PathTrieNode*));
+    node->children[at] = child;
+    node->childCount++;
+}
+
+static void pathTrieFreeIid(char* iid) {
+    if (iid != PATH_TRIE_AMBIGUOUS) free(iid);
+}
+
+static void pathTrieFreeNode(PathTrieNode* node) {
+    for (size_t i = 0; i < node->childCount; i++) {
+        pathTrieFreeNode(node->children[i]);
+        free(node->children[i]);
+    }
+    free(node->children);
+    free(node->label);
+    pathTrieFreeIid(node->iid);
+}
+
+void pathTrieInit(PathTrie* trie) {
+    memset(trie, 0, sizeof(PathTrie));
+    trie->root.label = strdup("");
+    pthread_rwlock_init(&trie->lock, NULL);
+}
+
+void pathTrieFree(PathTrie* trie) {
+    removeWriteListener(trie);
+    pathTrieFreeNode(&trie->root);
+    pthread_rwlock_destroy(&trie->lock);
+}
+
+// Splits edges where the path diverges from them. iid is taken over (it may be PATH_TRIE_AMBIGUOUS).
+static void pathTriePutLocked(PathTrie* trie, const char* path, char* iid) {
+    PathTrieNode* node = &trie->root;
+    size_t remaining = strlen(path);
+    while (remaining > 0) {
+        long at = pathTrieChild(node, *path);
+        if (at < 0) {
+            PathTrieNode* leaf = pathTrieNode(path, remaining);
+            pathTrieAddChild(node, (size_t)(-at - 1), leaf);
+            node = leaf;
+            break;
+        }
+        PathTrieNode* child = node->children[at];
+        size_t common = 1;
+        while (common < child->length && common < remaining && child->label[common] == path[common]) common++;
+        if (common < child->length) {
+            PathTrieNode* middle = pathTrieNode(child->label, common);
+            memmove(child->label, child->label + common, child->length - common + 1);
+            child->length -= common;
+            pathTrieAddChild(middle, 0, child);
+            node->children[at] = middle;
+            child = middle;
+        }
+        node = child;
+        path += common;
+        remaining -= common;
+    }
+    if (node->iid == NULL) trie->count++;
+    pathTrieFreeIid(node->iid);
+    node->iid = iid;
+}
+
+// Moves the only child's label, value and children into the node.
+static void pathTrieMerge(PathTrieNode* node) {
+    PathTrieNode* child = node->children[0];
+    node->label = realloc(node->label, node->length + child->length + 1);
+    memcpy(node->label + node->length, child->label, child->length + 1);
+    node->length += child->length;
+    node->iid = child->iid;
+    free(node->children);
+    node->children = child->children;
+    node->childCount = child->childCount;
+    free(child->label);
+    free(child);
+}
+
+// Removes the path and returns its IID (which the caller frees with pathTrieFreeIid), or NULL. Nodes
+// left without a value and with at most one child are dropped or merged so the tree stays compressed.
+static char* pathTrieRemoveLocked(PathTrie* trie, const char* path) {
+    PathTrieNode* parent = NULL;
+    PathTrieNode* node = &trie->root;
+    size_t remaining = strlen(path), slot = 0;
+    while (remaining > 0) {
+        long at = pathTrieChild(node, *path);
+        if (at < 0) return NULL;
+        PathTrieNode* child = node->children[at];
+        if (child->length > remaining || memcmp(child->label, path, child->length) != 0) return NULL;
+        parent = node;
+        slot = (size_t)at;
+        node = child;
+        path += child->length;
+        remaining -= child->length;
+    }
+    char* iid = node->iid;
+    if (iid == NULL) return NULL;
+    node->iid = NULL;
+    trie->count--;
+    if (parent == NULL) return iid;
+    if (node->childCount == 1) {
+        pathTrieMerge(node);
+    } else if (node->childCount == 0) {
+        free(node->label);
+        free(node->children);
+        free(node);
+        memmove(&parent->children[slot], &parent->children[slot + 1], (parent->childCount - slot - 1) * sizeof(PathTrieNode*));
+        parent->childCount--;
+        if (parent != &trie->root && parent->iid == NULL && parent->childCount == 1) pathTrieMerge(parent);
+    }
+    return iid;
+}
+
+static const PathTrieNode* pathTrieFindLocked(const PathTrie* trie, const char* path) {
+    const PathTrieNode* node = &trie->root;
+    size_t remaining = strlen(path);
+    while (remaining > 0) {
+        long at = pathTrieChild(node, *path);
+        if (at < 0) return NULL;
+        const PathTrieNode* child = node->children[at];
+        if (child->length > remaining || memcmp(child->label, path, child->length) != 0) return NULL;
+        node = child;
+        path += child->length;
+        remaining -= child->length;
+    }
+    return node;
+}
+
+// Copies the IID of the object with exactly this path into iid. Returns false for paths that are not
+// indexed or are held by several objects.
+bool pathTrieGet(PathTrie* trie, const char* path, char* iid, size_t size) {
+    pthread_rwlock_rdlock(&trie->lock);
+    const PathTrieNode* node = pathTrieFindLocked(trie, path);
+    bool found = node != NULL && node->iid != NULL && node->iid != PATH_TRIE_AMBIGUOUS && strlen(node->iid) < size;
+    if (found) strcpy(iid, node->iid);
+    pthread_rwlock_unlock(&trie->lock);
+    atomic_fetch_add_explicit(found ? &trie->hits : &trie->misses, 1, memory_order_relaxed);
+    return found;
+}
+
+static size_t pathTrieVisit(const PathTrieNode* node, ByteBuffer* path, void (*visit)(const char* path, const char* iid, void* context), void* context) {
+    size_t length = path->size, visited = 0;
+    byteBufferAppend(path, node->label, node->length + 1);
+    path->size--; // keep the terminator out of the length
+    if (node->iid != NULL) {
+        if (visit != NULL) visit(path->data, node->iid != PATH_TRIE_AMBIGUOUS ? node->iid : NULL, context);
+        visited++;
+    }
+    for (size_t i = 0; i < node->childCount; i++) visited += pathTrieVisit(node->children[i], path, visit, context);
+    path->size = length;
+    path->data[length] = '\0';
+    return visited;
+}
+
+// Visits every indexed path starting with prefix, in byte order, with its IID (NULL when ambiguous),
+// and returns how many there are. For everything under a directory, pass its path with a trailing '/'.
+size_t pathTriePrefix(PathTrie* trie, const char* prefix, void (*visit)(const char* path, const char* iid, void* context), void* context) {
+    pthread_rwlock_rdlock(&trie->lock);
+    const PathTrieNode* node = &trie->root;
+    size_t remaining = strlen(prefix), consumed = 0, visited = 0;
+    while (node != NULL && remaining > 0) {
+        long at = pathTrieChild(node, prefix[consumed]);
+        const PathTrieNode* child = at >= 0 ? node->children[at] : NULL;
+        size_t compare = child != NULL && child->length < remaining ? child->length : remaining;
+        if (child == NULL || memcmp(child->label, prefix + consumed, compare) != 0) node = NULL;
+        else if (child->length >= remaining) break; // the prefix ends inside this edge
+        else {
+            node = child;
+            consumed += child->length;
+            remaining -= child->length;
+        }
+    }
+    if (node != NULL) {
+        ByteBuffer path = {0};
+        byteBufferAppend(&path, prefix, consumed + 1);
+        path.size = consumed;
+        if (remaining == 0) visited = pathTrieVisit(node, &path, visit, context);
+        else visited = pathTrieVisit(node->children[pathTrieChild(node, prefix[consumed])], &path, visit, context);
+        free(path.data);
+    }
+    pthread_rwlock_unlock(&trie->lock);
+    return visited;
+}
+
+static void pathTrieFilePathUpdated(void* context, const char* oldPath, const char* newPath) {
+    PathTrie* trie = (PathTrie*)context;
+    pthread_rwlock_wrlock(&trie->lock);
+    char* iid = pathTrieRemoveLocked(trie, oldPath);
+    if (iid != NULL) {
+        // Renaming onto a path another file already has leaves that path shared, as pathTrieLoad marks it.
+        const PathTrieNode* existing = pathTrieFindLocked(trie, newPath);
+        if (existing != NULL && existing->iid != NULL && (existing->iid == PATH_TRIE_AMBIGUOUS || strcmp(existing->iid, iid) != 0)) {
+            pathTrieFreeIid(iid);
+            iid = PATH_TRIE_AMBIGUOUS;
+        }
+        pathTriePutLocked(trie, newPath, iid);
+    }
+    pthread_rwlock_unlock(&trie->lock);
+}
+
+static void pathTrieFileDeleted(void* context, const char* path) {
+    PathTrie* trie = (PathTrie*)context;
+    pthread_rwlock_wrlock(&trie->lock);
+    pathTrieFreeIid(pathTrieRemoveLocked(trie, path));
+    pthread_rwlock_unlock(&trie->lock);
+}
+
+// Loads the path of every file and directory and follows this process's writes from then on.
+bool pathTrieLoad(PathTrie* trie, DatabaseManager* dbManager, const char* dbName) {
+    pathTrieInit(trie);
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        options_drop(opts);
+        return false;
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    bool loaded = tx != NULL && !FAILED();
+    if (loaded) {
+        ConceptMapIterator* response = query_get(tx, PATH_TRIE_QUERY, opts);
+        ConceptMap* cm = NULL;
+        while (response != NULL && (cm = concept_map_iterator_next(response)) != NULL) {
+            char* iid = conceptMapIid(cm, "o");
+            Concept* path = concept_map_get(cm, "p");
+            Concept* value = attribute_get_value(path);
+            char* text = value_get_string(value);
+            const PathTrieNode* existing = pathTrieFindLocked(trie, text);
+            bool shared = existing != NULL && existing->iid != NULL && strcmp(existing->iid, iid) != 0;
+            pathTriePutLocked(trie, text, shared ? PATH_TRIE_AMBIGUOUS : strdup(iid));
+            string_free(text);
+            concept_drop(value);
+            concept_drop(path);
+            string_free(iid);
+            concept_map_drop(cm);
+        }
+        loaded = response != NULL && !FAILED();
+        concept_map_iterator_drop(response);
+        transaction_close(tx);
+    }
+    session_close(session);
+    options_drop(opts);
+    if (loaded) addWriteListener((WriteListener){ trie, NULL, pathTrieFilePathUpdated, pathTrieFileDeleted, NULL });
+    return loaded;
+}
+
+typedef struct {
+    const char* iid;
+    const char* oldPath;
+    const char* newPath;
+} UpdateIidPathArgs;
+
+// The old path and the file type stay in the match, so an IID that no longer has the path, or that is a
+// directory's, matches nothing.
+static long updateFilePathByIidOperation(Transaction* tx, Options* opts, void* context, bool* commit) {
+    UpdateIidPathArgs* args = (UpdateIidPathArgs*)context;
+    char* escapedOld = escapeTypeQLCopy(args->oldPath);
+    char* escapedNew = escapeTypeQLCopy(args->newPath);
+    size_t size = strlen(args->iid) + strlen(escapedOld) + strlen(escapedNew) + 160;
+    char* query = malloc(size);
+    snprintf(query, size, "match $f iid %s, isa file, has path $old_path; $old_path = '%s'; delete $f has $old_path; insert $f has path $new_path; $new_path = '%s';", args->iid, escapedOld, escapedNew);
+    ConceptMapIterator* response = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, response = query_update(tx, query, opts));
+    free(query);
+    free(escapedNew);
+    free(escapedOld);
+    if (response == NULL || check_error()) return -1;
+    long count = 0;
+    ConceptMap* conceptMap = NULL;
+    while ((conceptMap = concept_map_iterator_next(response)) != NULL) {
+        concept_map_drop(conceptMap);
+        count++;
+    }
+    concept_map_iterator_drop(response);
+    *commit = count > 0;
+    return check_error() ? -1 : count;
+}
+
+// updateFilePath addressed by IID when the trie knows the path. Falls back to matching by path when the
+// trie does not know it, or its IID no longer has it; a failed write is reported, not retried by path.
+int16_t updateFilePathIndexed(DatabaseManager* dbManager, const char* dbName, PathTrie* trie, const char* oldPath, const char* newPath) {
+    char iid[128];
+    if (!pathTrieGet(trie, oldPath, iid, sizeof(iid))) return updateFilePath(dbManager, dbName, oldPath, newPath);
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    UpdateIidPathArgs args = { iid, oldPath, newPath };
+    long count = runWithRetry(session, "updateFilePathIndexed", updateFilePathByIidOperation, &args, &DEFAULT_RETRY_POLICY);
+    session_close(session);
+    options_drop(opts);
+    if (count == 0) return updateFilePath(dbManager, dbName, oldPath, newPath); // stale entry
+    if (count < 0) {
+        fprintf(stderr, "Failed to update the file path.\n");
+        return 0;
+    }
+    notifyFilePathUpdated(oldPath, newPath);
+    sinkPrintf(&STDOUT_SINK, "Total number of paths updated: %ld.\n", count);
+    sinkFlush(&STDOUT_SINK);
+    return (int16_t)count;
+}
+
+typedef struct {
+    const char* iid;
+    const char* path;
+} DeleteIidArgs;
+
+// Returns 1 once the file is deleted, or 0 if the IID is no longer a file with the path.
+static long deleteFileByIidOperation(Transaction* tx, Options* opts, void* context, bool* commit) {
+    DeleteIidArgs* args = (DeleteIidArgs*)context;
+    char* path = escapeTypeQLCopy(args->path);
+    size_t size = strlen(args->iid) + strlen(path) + 64;
+    char* query = malloc(size);
+    snprintf(query, size, "match $f iid %s, isa file, has path '%s'; get;", args->iid, path);
+    free(path);
+    ConceptMapIterator* response = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, response = query_get(tx, query, opts));
+    free(query);
+    if (response == NULL || check_error()) return -1;
+    long count = 0;
+    ConceptMap* conceptMap = NULL;
+    while ((conceptMap = concept_map_iterator_next(response)) != NULL) {
+        concept_map_drop(conceptMap);
+        count++;
+    }
+    concept_map_iterator_drop(response);
+    if (check_error()) return -1;
+    if (count == 1) {
+        char deleteQuery[256];
+        snprintf(deleteQuery, sizeof(deleteQuery), "match $f iid %s; delete $f isa file;", args->iid);
+        VoidPromise* promise = NULL;
+        PROFILE(PHASE_QUERY_DISPATCH, promise = query_delete(tx, deleteQuery, opts));
+        if (promise == NULL || check_error()) return -1;
+        void_promise_resolve(promise);
+        if (check_error()) return -1;
+    }
+    *commit = count == 1;
+    return count;
+}
+
+// deleteFile addressed by IID. Paths the trie does not know, or knows to be shared, and stale entries go
+// through deleteFile, which refuses to delete when several files match; a failed delete is reported.
+bool deleteFileIndexed(DatabaseManager* dbManager, const char* dbName, PathTrie* trie, const char* path) {
+    char iid[128];
+    if (!pathTrieGet(trie, path, iid, sizeof(iid))) return deleteFile(dbManager, dbName, path);
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        exit(EXIT_FAILURE);
+    }
+    DeleteIidArgs args = { iid, path };
+    long count = runWithRetry(session, "deleteFileIndexed", deleteFileByIidOperation, &args, &DEFAULT_RETRY_POLICY);
+    session_close(session);
+    options_drop(opts);
+    if (count == 0) return deleteFile(dbManager, dbName, path);
+    if (count < 0) {
+        fprintf(stderr, "Failed to delete file.\n");
+        return false;
+    }
+    notifyFileDeleted(path);
+    sinkPrintf(&STDOUT_SINK, "The file has been deleted.\n");
+    sinkFlush(&STDOUT_SINK);
+    return true;
+}
+
+static void countPrefixBytes(const char* path, const char* iid, void* context) {
+    *(size_t*)context += strlen(path) + (iid != NULL);
+}
+
+void benchmarkPathTrie(size_t files) {
+    PathTrie trie;
+    pathTrieInit(&trie);
+    char path[96], iid[32];
+    double started = monotonicSeconds();
+    for (size_t f = 0; f < files; f++) {
+        snprintf(path, sizeof(path), "/vol%zu/dept%zu/project%zu/file%zu.dat", f % 4, f / 4 % 50, f / 200 % 100, f);
+        snprintf(iid, sizeof(iid), "0x%016zx", f);
+        pathTriePutLocked(&trie, path, strdup(iid));
+    }
+    double build = monotonicSeconds() - started;
+    unsigned int seed = 13;
+    size_t lookups = 1000000, found = 0;
+    started = monotonicSeconds();
+    for (size_t i = 0; i < lookups; i++) {
+        size_t f = (size_t)rand_r(&seed) % files;
+        snprintf(path, sizeof(path), "/vol%zu/dept%zu/project%zu/file%zu.dat", f % 4, f / 4 % 50, f / 200 % 100, f);
+        found += pathTrieGet(&trie, path, iid, sizeof(iid));
+    }
+    double exact = monotonicSeconds() - started;
+    size_t prefixes = 1000, under = 0, bytes = 0;
+    started = monotonicSeconds();
+    for (size_t i = 0; i < prefixes; i++) {
+        snprintf(path, sizeof(path), "/vol%zu/dept%zu/", i % 4, i % 50);
+        under += pathTriePrefix(&trie, path, countPrefixBytes, &bytes);
+    }
+    double prefix = monotonicSeconds() - started;
+    printf("Path trie benchmark: %zu paths inserted in %.3f s, %.3f us per exact lookup (%zu found), %.3f us per directory listing (%zu paths each)\n",
+           trie.count, build, exact / lookups * 1e6, found, prefix / prefixes * 1e6, under / prefixes);
+    pathTrieFree(&trie);
+}
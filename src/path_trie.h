@@ -0,0 +1,36 @@
+#ifndef TUTORIAL_PATH_TRIE_H
+#define TUTORIAL_PATH_TRIE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct PathTrieNode {
+    char* label;   // edge label from the parent; empty for the root
+    size_t length;
+    char* iid;     // NULL when no path ends here
+    struct PathTrieNode** children; // sorted by first label byte, which is unique among siblings
+    size_t childCount;
+} PathTrieNode;
+
+// Radix tree over file and directory paths, mapping each to the IID of the object that has it.
+typedef struct {
+    PathTrieNode root;
+    size_t count;
+    pthread_rwlock_t lock;
+    _Atomic size_t hits;
+    _Atomic size_t misses;
+} PathTrie;
+
+void pathTrieInit(PathTrie* trie);
+void pathTrieFree(PathTrie* trie);
+bool pathTrieGet(PathTrie* trie, const char* path, char* iid, size_t size);
+size_t pathTriePrefix(PathTrie* trie, const char* prefix, void (*visit)(const char* path, const char* iid, void* context), void* context);
+bool pathTrieLoad(PathTrie* trie, DatabaseManager* dbManager, const char* dbName);
+int16_t updateFilePathIndexed(DatabaseManager* dbManager, const char* dbName, PathTrie* trie, const char* oldPath, const char* newPath);
+bool deleteFileIndexed(DatabaseManager* dbManager, const char* dbName, PathTrie* trie, const char* path);
+void benchmarkPathTrie(size_t files);
+
+#endif
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "permission_index.h"
+#include "profiling.h"
+#include "output_sink.h"
+#include "write_listeners.h"
+
+#define PERMISSION_INDEX_SNAPSHOT_QUERY "match $u isa user; $p($u, $pa) isa permission; $o isa object, has path $fp; $pa($o, $va) isa access; $va isa action, has name 'view_file'; get $u, $fp;"
+
+// A sorted, duplicate-free array of owned strings.
+typedef struct {
+    char** items;
+    size_t count;
+    size_t capacity;
+} StringSet;
+
+int compareStrings(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Returns the position of the value, or of its insertion point when found is false.
+static size_t stringSetFind(const StringSet* set, const char* value, bool* found) {
+    size_t low = 0, high = set->count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int cmp = strcmp(set->items[mid], value);
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        }
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    *found = false;
+    return low;
+}
+
+static bool stringSetAdd(StringSet* set, const char* value) {
+    bool found;
+    size_t at = stringSetFind(set, value, &found);
+    if (found) return false;
+    if (set->count == set->capacity) {
+        set->capacity = set->capacity ? set->capacity * 2 : 4;
+        set->items = realloc(set->items, set->capacity * sizeof(char*));
+    }
+    memmove(set->items + at + 1, set->items + at, (set->count - at) * sizeof(char*));
+    set->items[at] = strdup(value);
+    set->count++;
+    return true;
+}
+
+static bool stringSetRemove(StringSet* set, const char* value) {
+    bool found;
+    size_t at = stringSetFind(set, value, &found);
+    if (!found) return false;
+    free(set->items[at]);
+    memmove(set->items + at, set->items + at + 1, (set->count - at - 1) * sizeof(char*));
+    set->count--;
+    return true;
+}
+
+static void stringSetFree(void* value) {
+    StringSet* set = (StringSet*)value;
+    for (size_t i = 0; i < set->count; i++) free(set->items[i]);
+    free(set->items);
+    free(set);
+}
+
+#define PERMISSION_INDEX_UNKNOWN_USER -1
+#define PERMISSION_INDEX_AMBIGUOUS_USER -2
+
+static StringSet* stringMapSet(StringMap* map, const char* key) {
+    StringSet* set = stringMapGet(map, key);
+    if (set == NULL) {
+        set = calloc(1, sizeof(StringSet));
+        stringMapPut(map, key, set);
+    }
+    return set;
+}
+
+// Unsynchronised helpers; callers hold the write lock.
+static void permissionIndexAddUserLocked(PermissionIndex* index, const char* iid, const char* name) {
+    stringMapSet(&index->filesByUser, iid);
+    if (name != NULL) stringSetAdd(stringMapSet(&index->usersByName, name), iid);
+}
+
+static void permissionIndexAddLocked(PermissionIndex* index, const char* iid, const char* path) {
+    stringSetAdd(stringMapSet(&index->filesByUser, iid), path);
+    stringSetAdd(stringMapSet(&index->usersByPath, path), iid);
+}
+
+static void permissionIndexUserInserted(void* context, const char* iid, const char* name, const char* email) {
+    (void)email;
+    PermissionIndex* index = (PermissionIndex*)context;
+    pthread_rwlock_wrlock(&index->lock);
+    permissionIndexAddUserLocked(index, iid, name); // a new user has no permissions yet
+    pthread_rwlock_unlock(&index->lock);
+}
+
+static void permissionIndexFilePathUpdated(void* context, const char* oldPath, const char* newPath) {
+    PermissionIndex* index = (PermissionIndex*)context;
+    pthread_rwlock_wrlock(&index->lock);
+    StringSet* users = stringMapRemove(&index->usersByPath, oldPath);
+    for (size_t i = 0; users != NULL && i < users->count; i++) {
+        StringSet* files = stringMapGet(&index->filesByUser, users->items[i]);
+        stringSetRemove(files, oldPath);
+        permissionIndexAddLocked(index, users->items[i], newPath);
+    }
+    if (users != NULL) stringSetFree(users);
+    pthread_rwlock_unlock(&index->lock);
+}
+
+static void permissionIndexFileDeleted(void* context, const char* path) {
+    PermissionIndex* index = (PermissionIndex*)context;
+    pthread_rwlock_wrlock(&index->lock);
+    StringSet* users = stringMapRemove(&index->usersByPath, path);
+    for (size_t i = 0; users != NULL && i < users->count; i++) {
+        stringSetRemove(stringMapGet(&index->filesByUser, users->items[i]), path);
+    }
+    if (users != NULL) stringSetFree(users);
+    pthread_rwlock_unlock(&index->lock);
+}
+
+void permissionIndexFree(PermissionIndex* index) {
+    removeWriteListener(index);
+    stringMapFree(&index->filesByUser, stringSetFree);
+    stringMapFree(&index->usersByPath, stringSetFree);
+    stringMapFree(&index->usersByName, stringSetFree);
+    pthread_rwlock_destroy(&index->lock);
+    free(index);
+}
+
+// Returns the string value of the attribute bound to var in the answer, to be freed with string_free.
+static char* conceptMapString(ConceptMap* cm, const char* var) {
+    Concept* attribute = concept_map_get(cm, var);
+    if (attribute == NULL) return NULL;
+    Concept* value = attribute_get_value(attribute);
+    char* text = value_get_string(value);
+    concept_drop(value);
+    concept_drop(attribute);
+    return text;
+}
+
+char* conceptMapIid(ConceptMap* cm, const char* var) {
+    Concept* thing = concept_map_get(cm, var);
+    if (thing == NULL) return NULL;
+    char* iid = thing_get_iid(thing);
+    concept_drop(thing);
+    return iid;
+}
+
+// Loads every named user and every (user, viewable path) pair in one read transaction, then subscribes
+// the index to this process's writes. Returns NULL if the snapshot could not be read.
+PermissionIndex* permissionIndexBuild(DatabaseManager* dbManager, const char* dbName, bool inference) {
+    Options* opts = options_new();
+    options_set_infer(opts, inference);
+    Session* session = NULL;
+    PROFILE(PHASE_SESSION_NEW, session = session_new(dbManager, dbName, Data, opts));
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(opts);
+        return NULL;
+    }
+    Transaction* tx = NULL;
+    PROFILE(PHASE_TRANSACTION_NEW, tx = transaction_new(session, Read, opts));
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        session_close(session);
+        options_drop(opts);
+        return NULL;
+    }
+    PermissionIndex* index = calloc(1, sizeof(PermissionIndex));
+    pthread_rwlock_init(&index->lock, NULL);
+    stringMapInit(&index->filesByUser, 1024);
+    stringMapInit(&index->usersByPath, 1024);
+    stringMapInit(&index->usersByName, 1024);
+    index->inference = inference;
+
+    double started = monotonicSeconds();
+    const char* queries[] = { "match $u isa user, has full-name $fn; get $u, $fn;", PERMISSION_INDEX_SNAPSHOT_QUERY };
+    size_t pairs = 0;
+    bool failed = false;
+    for (int q = 0; q < 2 && !failed; q++) {
+        ConceptMapIterator* response = NULL;
+        PROFILE(PHASE_QUERY_DISPATCH, response = query_get(tx, queries[q], opts));
+        if (response == NULL || FAILED()) {
+            failed = true;
+            break;
+        }
+        ConceptMap* cm = NULL;
+        ProfileDrain drain = {0};
+        while ((cm = profiledConceptMapNext(response, &drain)) != NULL) {
+            char* iid = conceptMapIid(cm, "u");
+            char* text = conceptMapString(cm, q == 0 ? "fn" : "fp");
+            if (iid != NULL && text != NULL && q == 0) permissionIndexAddUserLocked(index, iid, text);
+            else if (iid != NULL && text != NULL) {
+                permissionIndexAddLocked(index, iid, text);
+                pairs++;
+            }
+            if (text != NULL) string_free(text);
+            if (iid != NULL) string_free(iid);
+            concept_map_drop(cm);
+        }
+        profileDrainEnd(&drain);
+        if (FAILED()) failed = true;
+        concept_map_iterator_drop(response);
+    }
+    transaction_close(tx);
+    session_close(session);
+    options_drop(opts);
+    if (failed) {
+        fprintf(stderr, "Failed to load the permission snapshot.\n");
+        permissionIndexFree(index);
+        return NULL;
+    }
+    printf("Permission index: %zu users, %zu viewable paths, %zu permissions loaded in %.2f s.\n",
+           index->filesByUser.count, index->usersByPath.count, pairs, monotonicSeconds() - started);
+    addWriteListener((WriteListener){ index, permissionIndexUserInserted, permissionIndexFilePathUpdated, permissionIndexFileDeleted, NULL });
+    return index;
+}
+
+// Calls visit for each path the user with this full-name can view, in ascending order, under the read
+// lock. Returns the number of paths, PERMISSION_INDEX_UNKNOWN_USER if no user in the index has the name,
+// or PERMISSION_INDEX_AMBIGUOUS_USER if more than one has.
+long permissionIndexLookup(PermissionIndex* index, const char* name, void (*visit)(const char* path, void* context), void* context) {
+    pthread_rwlock_rdlock(&index->lock);
+    StringSet* users = stringMapGet(&index->usersByName, name);
+    long count = PERMISSION_INDEX_UNKNOWN_USER;
+    if (users != NULL && users->count > 1) count = PERMISSION_INDEX_AMBIGUOUS_USER;
+    else if (users != NULL && users->count == 1) {
+        StringSet* files = stringMapGet(&index->filesByUser, users->items[0]);
+        count = files != NULL ? (long)files->count : 0;
+        for (long i = 0; visit != NULL && i < count; i++) visit(files->items[i], context);
+    }
+    pthread_rwlock_unlock(&index->lock);
+    atomic_fetch_add_explicit(count != PERMISSION_INDEX_UNKNOWN_USER ? &index->hits : &index->misses, 1, memory_order_relaxed);
+    return count;
+}
+
+static void printIndexedFile(const char* path, void* context) {
+    int* fileCount = (int*)context;
+    SinkField field = { NULL, path, NULL };
+    sinkRecord(&STDOUT_SINK, "File", ++*fileCount, &field, 1);
+}
+
+// getFilesByUser answered from the index, falling back to the server for users it does not know.
+int getFilesByUserIndexed(DatabaseManager* dbManager, const char* dbName, PermissionIndex* index, const char* name) {
+    int fileCount = 0;
+    long files = permissionIndexLookup(index, name, printIndexedFile, &fileCount);
+    if (files == PERMISSION_INDEX_UNKNOWN_USER) return getFilesByUser(dbManager, dbName, name, index->inference);
+    if (files == PERMISSION_INDEX_AMBIGUOUS_USER) fprintf(stderr, "Error: Found more than one user with that name.\n");
+    else if (fileCount == 0) sinkPrintf(&STDOUT_SINK, "No files found. Try enabling inference.\n");
+    sinkFlush(&STDOUT_SINK);
+    return 1;
+}
+
+// Times index lookups against the server query for the same user.
+void benchmarkPermissionIndex(DatabaseManager* dbManager, const char* dbName, const char* name, size_t lookups) {
+    PermissionIndex* index = permissionIndexBuild(dbManager, dbName, true);
+    if (index == NULL) return;
+    double started = monotonicSeconds();
+    long files = 0;
+    for (size_t i = 0; i < lookups; i++) files = permissionIndexLookup(index, name, NULL, NULL);
+    double indexed = monotonicSeconds() - started;
+    started = monotonicSeconds();
+    sinkPrintf(&STDOUT_SINK, "Server query for %s:\n", name);
+    getFilesByUser(dbManager, dbName, name, true);
+    double server = monotonicSeconds() - started;
+    printf("Permission index benchmark: %ld files for %s, %.3f us per index lookup, %.3f ms per server query\n",
+           files, name, indexed / lookups * 1e6, server * 1e3);
+    permissionIndexFree(index);
+}
@@ -0,0 +1,31 @@
+#ifndef TUTORIAL_PERMISSION_INDEX_H
+#define TUTORIAL_PERMISSION_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "string_map.h"
+
+// User IID -> paths the user can view, path -> IIDs of the users who can view it, and full-name -> IIDs
+// of the users with that name, built from one snapshot and then kept in sync through the write
+// listeners. Full-names are not unique, so they only resolve to users.
+typedef struct {
+    pthread_rwlock_t lock;
+    StringMap filesByUser;  // values are StringSet* of paths
+    StringMap usersByPath;  // values are StringSet* of user IIDs
+    StringMap usersByName;  // values are StringSet* of user IIDs
+    bool inference;
+    atomic_size_t hits;
+    atomic_size_t misses;
+} PermissionIndex;
+
+int compareStrings(const void* a, const void* b);
+void permissionIndexFree(PermissionIndex* index);
+char* conceptMapIid(ConceptMap* cm, const char* var);
+PermissionIndex* permissionIndexBuild(DatabaseManager* dbManager, const char* dbName, bool inference);
+long permissionIndexLookup(PermissionIndex* index, const char* name, void (*visit)(const char* path, void* context), void* context);
+int getFilesByUserIndexed(DatabaseManager* dbManager, const char* dbName, PermissionIndex* index, const char* name);
+void benchmarkPermissionIndex(DatabaseManager* dbManager, const char* dbName, const char* name, size_t lookups);
+
+#endif
@@ -0,0 +1,99 @@
+#ifdef _WIN32
+#define _CRT_RAND_S // declares rand_s
+#endif
+#include <stdlib.h>
+#include <time.h>
+#include "platform.h"
+#ifdef _WIN32
+#include <io.h>
+#include <intrin.h>
+#endif
+
+#ifdef _WIN32
+void mutexInit(Mutex* mutex) {
+    InitializeSRWLock(mutex);
+}
+
+void mutexLock(Mutex* mutex) {
+    AcquireSRWLockExclusive(mutex);
+}
+
+void mutexUnlock(Mutex* mutex) {
+    ReleaseSRWLockExclusive(mutex);
+}
+
+void mutexDestroy(Mutex* mutex) {
+    (void)mutex; // SRW locks hold no resources
+}
+
+uint64_t monotonicNanos(void) {
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000u
+        + (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000u / (uint64_t)frequency.QuadPart;
+}
+
+void sleepMicros(long micros) {
+    Sleep((DWORD)((micros + 999) / 1000));
+}
+
+// rand_s draws from the system generator and needs no seed.
+unsigned int randomNext(unsigned int* seed) {
+    unsigned int value;
+    (void)seed;
+    return rand_s(&value) == 0 ? value : 0;
+}
+
+int leadingZeros64(uint64_t value) {
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - (int)index;
+}
+
+// Windows has no gathered write; this writes the first buffer and the caller loops over the rest.
+ssize_t writeVector(int fd, const struct iovec* iov, int count) {
+    if (count == 0) return 0;
+    return _write(fd, iov->iov_base, (unsigned int)iov->iov_len);
+}
+#else
+void mutexInit(Mutex* mutex) {
+    pthread_mutex_init(mutex, NULL);
+}
+
+void mutexLock(Mutex* mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+void mutexUnlock(Mutex* mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+void mutexDestroy(Mutex* mutex) {
+    pthread_mutex_destroy(mutex);
+}
+
+uint64_t monotonicNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void sleepMicros(long micros) {
+    struct timespec delay = { micros / 1000000, micros % 1000000 * 1000 };
+    nanosleep(&delay, NULL);
+}
+
+unsigned int randomNext(unsigned int* seed) {
+    return (unsigned int)rand_r(seed);
+}
+
+int leadingZeros64(uint64_t value) {
+    return __builtin_clzll(value);
+}
+
+ssize_t writeVector(int fd, const struct iovec* iov, int count) {
+    return writev(fd, iov, count);
+}
+#endif
@@ -0,0 +1,44 @@
+#ifndef TUTORIAL_PLATFORM_H
+#define TUTORIAL_PLATFORM_H
+
+// The few operating system services used by the walkthrough's own modules (profiling, output sink,
+// prefetch tuning and retries), so that tutorial.c still builds on Windows. The extension modules use
+// POSIX threads directly and are only built where those are available.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef SRWLOCK Mutex;
+#define MUTEX_INITIALIZER SRWLOCK_INIT
+#define THREAD_LOCAL __declspec(thread)
+#define STDOUT_FILENO 1
+#ifdef _MSC_VER
+typedef intptr_t ssize_t;
+#endif
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+typedef pthread_mutex_t Mutex;
+#define MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define THREAD_LOCAL _Thread_local
+#endif
+
+void mutexInit(Mutex* mutex);
+void mutexLock(Mutex* mutex);
+void mutexUnlock(Mutex* mutex);
+void mutexDestroy(Mutex* mutex);
+uint64_t monotonicNanos(void);
+void sleepMicros(long micros);
+unsigned int randomNext(unsigned int* seed);
+int leadingZeros64(uint64_t value);
+ssize_t writeVector(int fd, const struct iovec* iov, int count);
+
+#endif
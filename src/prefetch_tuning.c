@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "prefetch_tuning.h"
+#include "profiling.h"
+
+#define PREFETCH_SIZE_MIN 1
+#define PREFETCH_SIZE_MAX 4096
+#define PREFETCH_EWMA_WEIGHT 0.2
+#define PREFETCH_WINDOW_SECONDS 0.005 // answers consumed while the next batch is requested
+
+PrefetchTuner PREFETCH_TUNER = { .count = 0, .lock = MUTEX_INITIALIZER };
+
+static PrefetchShapeStats* prefetchTunerFind(PrefetchTuner* tuner, const char* shape, bool create) {
+    for (int i = 0; i < tuner->count; i++) {
+        if (strcmp(tuner->shapes[i].shape, shape) == 0) return &tuner->shapes[i];
+    }
+    if (!create || tuner->count == PREFETCH_SHAPES_MAX) return NULL;
+    PrefetchShapeStats* stats = &tuner->shapes[tuner->count++];
+    memset(stats, 0, sizeof(PrefetchShapeStats));
+    snprintf(stats->shape, sizeof(stats->shape), "%s", shape);
+    return stats;
+}
+
+// Results that fit in one batch are fetched whole; larger ones in batches sized to what the client
+// consumes while the next batch is in flight, so neither side waits on the other.
+static int32_t prefetchTunerChoose(const PrefetchShapeStats* stats) {
+    double size = stats->avgAnswers <= PREFETCH_SIZE_MAX ? stats->avgAnswers + 1 : stats->avgRate * PREFETCH_WINDOW_SECONDS;
+    if (size < PREFETCH_SIZE_MIN) size = PREFETCH_SIZE_MIN;
+    if (size > PREFETCH_SIZE_MAX) size = PREFETCH_SIZE_MAX;
+    return (int32_t)size;
+}
+
+// Sets the prefetch size for a query shape once it has been observed; unseen shapes keep the defaults.
+void prefetchTunerApply(PrefetchTuner* tuner, const char* shape, Options* opts) {
+    mutexLock(&tuner->lock);
+    PrefetchShapeStats* stats = prefetchTunerFind(tuner, shape, false);
+    int32_t size = stats != NULL && stats->runs > 0 ? prefetchTunerChoose(stats) : 0;
+    mutexUnlock(&tuner->lock);
+    if (size > 0) {
+        options_set_prefetch(opts, true);
+        options_set_prefetch_size(opts, size);
+    }
+}
+
+// Records a run that returned the given number of answers in drainSeconds from the first to the last. The rate
+// excludes dispatch latency and time to first answer, which the prefetch size does not affect; counting
+// them would make the rate, and so the next size, depend on the size chosen last time.
+void prefetchTunerRecord(PrefetchTuner* tuner, const char* shape, uint64_t answers, double drainSeconds) {
+    bool timed = answers > 1 && drainSeconds > 0;
+    double rate = timed ? (answers - 1) / drainSeconds : 0;
+    mutexLock(&tuner->lock);
+    PrefetchShapeStats* stats = prefetchTunerFind(tuner, shape, true);
+    if (stats != NULL) {
+        if (stats->runs++ == 0) {
+            stats->avgAnswers = answers;
+            stats->avgRate = rate;
+        } else {
+            stats->avgAnswers += PREFETCH_EWMA_WEIGHT * (answers - stats->avgAnswers);
+            if (timed) stats->avgRate += stats->avgRate > 0 ? PREFETCH_EWMA_WEIGHT * (rate - stats->avgRate) : rate;
+        }
+    }
+    mutexUnlock(&tuner->lock);
+}
+
+// Runs a fetch query once per prefetch size and reports time-to-first-answer and throughput.
+void benchmarkPrefetch(DatabaseManager* dbManager, const char* dbName, const char* query, int runs) {
+    const int32_t sizes[] = {1, 8, 32, 50, 128, 512, 2048};
+    Options* sessionOpts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, sessionOpts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(sessionOpts);
+        return;
+    }
+    printf("Prefetch benchmark: %s\n%10s %12s %14s %10s\n", query, "prefetch", "first (ms)", "answers/s", "answers");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        Options* opts = options_new();
+        options_set_prefetch(opts, true);
+        options_set_prefetch_size(opts, sizes[s]);
+        double firstTotal = 0;
+        double drainTotal = 0;
+        uint64_t answers = 0;
+        for (int run = 0; run < runs; run++) {
+            Transaction* tx = transaction_new(session, Read, opts);
+            if (tx == NULL || FAILED()) break;
+            double started = monotonicSeconds();
+            StringIterator* it = query_fetch(tx, query, opts);
+            char* answer = it != NULL ? string_iterator_next(it) : NULL;
+            firstTotal += monotonicSeconds() - started;
+            while (answer != NULL) {
+                answers++;
+                string_free(answer);
+                answer = string_iterator_next(it);
+            }
+            drainTotal += monotonicSeconds() - started;
+            if (FAILED()) fprintf(stderr, "Benchmark query failed.\n");
+            string_iterator_drop(it);
+            transaction_close(tx);
+        }
+        printf("%10d %12.3f %14.0f %10llu\n", sizes[s], runs > 0 ? firstTotal * 1000 / runs : 0.0,
+            drainTotal > 0 ? answers / drainTotal : 0.0, (unsigned long long)(runs > 0 ? answers / runs : 0));
+        options_drop(opts);
+    }
+    session_close(session);
+    options_drop(sessionOpts);
+}
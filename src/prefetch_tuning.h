@@ -0,0 +1,28 @@
+#ifndef TUTORIAL_PREFETCH_TUNING_H
+#define TUTORIAL_PREFETCH_TUNING_H
+
+#include <stdint.h>
+#include "platform.h"
+
+#define PREFETCH_SHAPES_MAX 32
+
+typedef struct {
+    char shape[64];
+    uint64_t runs;
+    double avgAnswers; // EWMA of answers per query
+    double avgRate;    // EWMA of answers consumed per second
+} PrefetchShapeStats;
+
+typedef struct {
+    PrefetchShapeStats shapes[PREFETCH_SHAPES_MAX];
+    int count;
+    Mutex lock;
+} PrefetchTuner;
+
+extern PrefetchTuner PREFETCH_TUNER;
+
+void prefetchTunerApply(PrefetchTuner* tuner, const char* shape, Options* opts);
+void prefetchTunerRecord(PrefetchTuner* tuner, const char* shape, uint64_t answers, double drainSeconds);
+void benchmarkPrefetch(DatabaseManager* dbManager, const char* dbName, const char* query, int runs);
+
+#endif
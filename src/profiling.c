@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdatomic.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "profiling.h"
+#include "platform.h"
+
+double monotonicSeconds(void) {
+    return (double)monotonicNanos() / 1e9;
+}
+
+// Latencies are bucketed in nanoseconds with four sub-buckets per power of two (under 19% error).
+#define PROFILE_BUCKETS 252
+
+static const char* PROFILE_PHASE_NAMES[PHASE_COUNT] = { "session_new", "transaction_new", "query dispatch", "first answer", "drain", "commit" };
+
+typedef struct {
+    atomic_size_t buckets[PROFILE_BUCKETS];
+    atomic_size_t count;
+    atomic_uint_fast64_t totalNanos;
+    atomic_uint_fast64_t maxNanos;
+} PhaseHistogram;
+
+static PhaseHistogram PROFILE_HISTOGRAMS[PHASE_COUNT];
+
+static size_t profileBucket(uint64_t nanos) {
+    if (nanos < 4) return (size_t)nanos;
+    int octave = 63 - leadingZeros64(nanos);
+    return (size_t)(octave - 1) * 4 + ((nanos >> (octave - 2)) & 3);
+}
+
+static uint64_t profileBucketUpperBound(size_t bucket) {
+    if (bucket < 4) return bucket;
+    int octave = (int)(bucket / 4) + 1;
+    uint64_t lower = (uint64_t)(4 + bucket % 4) << (octave - 2);
+    return lower + ((uint64_t)1 << (octave - 2)) - 1;
+}
+
+void profileRecord(ProfilePhase phase, uint64_t nanos) {
+    PhaseHistogram* histogram = &PROFILE_HISTOGRAMS[phase];
+    atomic_fetch_add_explicit(&histogram->buckets[profileBucket(nanos)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->totalNanos, nanos, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&histogram->maxNanos, memory_order_relaxed);
+    while (nanos > max && !atomic_compare_exchange_weak(&histogram->maxNanos, &max, nanos));
+}
+
+static void profileNextStarted(ProfileDrain* drain, uint64_t started) {
+    if (!PROFILE_QUERIES) return;
+    uint64_t elapsed = monotonicNanos() - started;
+    if (drain->answered) drain->drainNanos += elapsed;
+    else profileRecord(PHASE_FIRST_ANSWER, elapsed);
+    drain->answered = true;
+}
+
+ConceptMap* profiledConceptMapNext(ConceptMapIterator* iterator, ProfileDrain* drain) {
+    uint64_t started = PROFILE_QUERIES ? monotonicNanos() : 0;
+    ConceptMap* conceptMap = concept_map_iterator_next(iterator);
+    profileNextStarted(drain, started);
+    return conceptMap;
+}
+
+char* profiledStringNext(StringIterator* iterator, ProfileDrain* drain) {
+    uint64_t started = PROFILE_QUERIES ? monotonicNanos() : 0;
+    char* next = string_iterator_next(iterator);
+    profileNextStarted(drain, started);
+    return next;
+}
+
+void profileDrainEnd(ProfileDrain* drain) {
+    if (PROFILE_QUERIES && drain->answered) profileRecord(PHASE_DRAIN, drain->drainNanos);
+    drain->drainNanos = 0;
+    drain->answered = false;
+}
+
+static double profilePercentileMicros(PhaseHistogram* histogram, size_t count, double percentile) {
+    size_t rank = (size_t)(percentile * (count - 1)) + 1, seen = 0;
+    for (size_t b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += atomic_load(&histogram->buckets[b]);
+        if (seen >= rank) return profileBucketUpperBound(b) / 1e3;
+    }
+    return 0.0;
+}
+
+// Registered with atexit when PROFILE_QUERIES is set.
+void profileReport(void) {
+    fflush(stdout);
+    fprintf(stderr, "\nQuery profile (microseconds)\n");
+    fprintf(stderr, "  %-16s %8s %10s %10s %10s %10s %10s\n", "phase", "count", "mean", "p50", "p90", "p99", "max");
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        PhaseHistogram* histogram = &PROFILE_HISTOGRAMS[phase];
+        size_t count = atomic_load(&histogram->count);
+        if (count == 0) continue;
+        fprintf(stderr, "  %-16s %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", PROFILE_PHASE_NAMES[phase], count,
+                atomic_load(&histogram->totalNanos) / 1e3 / count,
+                profilePercentileMicros(histogram, count, 0.5), profilePercentileMicros(histogram, count, 0.9),
+                profilePercentileMicros(histogram, count, 0.99), atomic_load(&histogram->maxNanos) / 1e3);
+    }
+}
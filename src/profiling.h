@@ -0,0 +1,39 @@
+#ifndef TUTORIAL_PROFILING_H
+#define TUTORIAL_PROFILING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "tutorial.h"
+#include "platform.h"
+
+typedef enum {
+    PHASE_SESSION_NEW,
+    PHASE_TRANSACTION_NEW,
+    PHASE_QUERY_DISPATCH,
+    PHASE_FIRST_ANSWER,
+    PHASE_DRAIN,
+    PHASE_COMMIT,
+    PHASE_COUNT
+} ProfilePhase;
+
+// Times one driver call when profiling is on: PROFILE(PHASE_COMMIT, void_promise_resolve(transaction_commit(tx)));
+#define PROFILE(phase, call) do { \
+        uint64_t profileStarted_ = PROFILE_QUERIES ? monotonicNanos() : 0; \
+        call; \
+        if (PROFILE_QUERIES) profileRecord(phase, monotonicNanos() - profileStarted_); \
+    } while (0)
+
+// Splits iteration over an answer stream into time to first answer and time to drain the rest.
+typedef struct {
+    uint64_t drainNanos;
+    bool answered;
+} ProfileDrain;
+
+double monotonicSeconds(void);
+void profileRecord(ProfilePhase phase, uint64_t nanos);
+ConceptMap* profiledConceptMapNext(ConceptMapIterator* iterator, ProfileDrain* drain);
+char* profiledStringNext(StringIterator* iterator, ProfileDrain* drain);
+void profileDrainEnd(ProfileDrain* drain);
+void profileReport(void);
+
+#endif
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "query_pipeline.h"
+
+QueryPipeline* pipelineNew(Transaction* tx, Options* opts) {
+    QueryPipeline* pipeline = calloc(1, sizeof(QueryPipeline));
+    pipeline->tx = tx;
+    pipeline->opts = opts;
+    return pipeline;
+}
+
+static PendingQuery* pipelinePush(QueryPipeline* pipeline, PendingKind kind, QueryCallback callback, void* context) {
+    if (pipeline->count == pipeline->capacity) {
+        pipeline->capacity = pipeline->capacity ? pipeline->capacity * 2 : 8;
+        pipeline->queries = realloc(pipeline->queries, pipeline->capacity * sizeof(PendingQuery*));
+    }
+    PendingQuery* query = calloc(1, sizeof(PendingQuery));
+    query->kind = kind;
+    query->callback = callback;
+    query->context = context;
+    pipeline->queries[pipeline->count++] = query;
+    return query;
+}
+
+PendingQuery* pipelineDefine(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context) {
+    PendingQuery* pending = pipelinePush(pipeline, PENDING_VOID, callback, context);
+    pending->handle.voidPromise = query_define(pipeline->tx, query, pipeline->opts);
+    pending->failed = pending->handle.voidPromise == NULL || FAILED();
+    return pending;
+}
+
+PendingQuery* pipelineDelete(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context) {
+    PendingQuery* pending = pipelinePush(pipeline, PENDING_VOID, callback, context);
+    pending->handle.voidPromise = query_delete(pipeline->tx, query, pipeline->opts);
+    pending->failed = pending->handle.voidPromise == NULL || FAILED();
+    return pending;
+}
+
+PendingQuery* pipelineGetAggregate(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context) {
+    PendingQuery* pending = pipelinePush(pipeline, PENDING_CONCEPT, callback, context);
+    pending->handle.conceptPromise = query_get_aggregate(pipeline->tx, query, pipeline->opts);
+    pending->failed = pending->handle.conceptPromise == NULL || FAILED();
+    return pending;
+}
+
+PendingQuery* pipelineGet(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context) {
+    PendingQuery* pending = pipelinePush(pipeline, PENDING_CONCEPT_MAPS, callback, context);
+    pending->handle.conceptMaps = query_get(pipeline->tx, query, pipeline->opts);
+    pending->failed = pending->handle.conceptMaps == NULL || FAILED();
+    return pending;
+}
+
+PendingQuery* pipelineInsert(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context) {
+    PendingQuery* pending = pipelinePush(pipeline, PENDING_CONCEPT_MAPS, callback, context);
+    pending->handle.conceptMaps = query_insert(pipeline->tx, query, pipeline->opts);
+    pending->failed = pending->handle.conceptMaps == NULL || FAILED();
+    return pending;
+}
+
+PendingQuery* pipelineUpdate(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context) {
+    PendingQuery* pending = pipelinePush(pipeline, PENDING_CONCEPT_MAPS, callback, context);
+    pending->handle.conceptMaps = query_update(pipeline->tx, query, pipeline->opts);
+    pending->failed = pending->handle.conceptMaps == NULL || FAILED();
+    return pending;
+}
+
+PendingQuery* pipelineFetch(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context) {
+    PendingQuery* pending = pipelinePush(pipeline, PENDING_STRINGS, callback, context);
+    pending->handle.strings = query_fetch(pipeline->tx, query, pipeline->opts);
+    pending->failed = pending->handle.strings == NULL || FAILED();
+    return pending;
+}
+
+// Waits for a single query. Iterator results are not drained here: the callback (or the caller,
+// through query->handle) consumes them while the pipeline keeps ownership.
+bool pipelineResolve(PendingQuery* query) {
+    if (query->resolved) return !query->failed;
+    query->resolved = true;
+    if (!query->failed) {
+        if (query->kind == PENDING_VOID) {
+            void_promise_resolve(query->handle.voidPromise);
+            query->handle.voidPromise = NULL;
+            query->failed = FAILED();
+        } else if (query->kind == PENDING_CONCEPT) {
+            query->concept = concept_promise_resolve(query->handle.conceptPromise);
+            query->handle.conceptPromise = NULL;
+            query->failed = query->concept == NULL || FAILED();
+        }
+    }
+    if (query->callback != NULL) query->callback(query, query->context);
+    return !query->failed;
+}
+
+// Resolves every query in issue order and reports whether all of them succeeded.
+bool pipelineAwaitAll(QueryPipeline* pipeline) {
+    bool ok = true;
+    for (size_t i = 0; i < pipeline->count; i++) {
+        if (!pipelineResolve(pipeline->queries[i])) ok = false;
+    }
+    return ok;
+}
+
+void pipelineDrop(QueryPipeline* pipeline) {
+    for (size_t i = 0; i < pipeline->count; i++) {
+        PendingQuery* query = pipeline->queries[i];
+        if (query->kind == PENDING_VOID && query->handle.voidPromise != NULL) {
+            void_promise_resolve(query->handle.voidPromise); // promises are only freed on resolution
+            if (check_error()) error_drop(get_last_error());
+        } else if (query->kind == PENDING_CONCEPT) {
+            if (query->handle.conceptPromise != NULL) query->concept = concept_promise_resolve(query->handle.conceptPromise);
+            if (query->concept != NULL) concept_drop(query->concept);
+            if (check_error()) error_drop(get_last_error());
+        } else if (query->kind == PENDING_CONCEPT_MAPS && query->handle.conceptMaps != NULL) {
+            concept_map_iterator_drop(query->handle.conceptMaps);
+        } else if (query->kind == PENDING_STRINGS && query->handle.strings != NULL) {
+            string_iterator_drop(query->handle.strings);
+        }
+        free(query);
+    }
+    free(pipeline->queries);
+    free(pipeline);
+}
+
+// Drains an insert's answers so that its errors surface before the transaction commits.
+void pipelineDrainInsert(PendingQuery* query, void* context) {
+    (void)context;
+    if (query->failed) return;
+    ConceptMap* cm = NULL;
+    while ((cm = concept_map_iterator_next(query->handle.conceptMaps)) != NULL) concept_map_drop(cm);
+    if (FAILED()) query->failed = true;
+}
+
+typedef PendingQuery* (*PipelineDispatch)(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+
+// Runs count write queries, batchSize per write transaction, with every query of a batch in flight
+// before any is resolved. A batch commits only if all of its queries succeed; its size is added to
+// written or to failed.
+static void runBatchedWrites(Session* session, size_t count, size_t batchSize, PipelineDispatch dispatch, QueryCallback callback, BatchQueryFormat format, void* context, size_t* written, size_t* failed) {
+    Options* opts = options_new();
+    char query[1024];
+    for (size_t start = 0; start < count; start += batchSize) {
+        size_t end = start + batchSize < count ? start + batchSize : count;
+        Transaction* tx = transaction_new(session, Write, opts);
+        if (tx == NULL || FAILED()) {
+            *failed += end - start;
+            continue;
+        }
+        QueryPipeline* pipeline = pipelineNew(tx, opts);
+        for (size_t i = start; i < end; i++) {
+            format(context, i, query, sizeof(query));
+            dispatch(pipeline, query, callback, NULL);
+        }
+        bool committed = pipelineAwaitAll(pipeline);
+        pipelineDrop(pipeline);
+        if (committed) {
+            void_promise_resolve(transaction_commit(tx));
+            committed = !FAILED();
+        } else transaction_close(tx);
+        if (committed) *written += end - start;
+        else *failed += end - start;
+    }
+    options_drop(opts);
+}
+
+// runBatchedWrites for insert queries, draining each insert's answers.
+void runBatchedInserts(Session* session, size_t count, size_t batchSize, BatchQueryFormat format, void* context, size_t* written, size_t* failed) {
+    runBatchedWrites(session, count, batchSize, pipelineInsert, pipelineDrainInsert, format, context, written, failed);
+}
+
+// runBatchedWrites for delete queries.
+void runBatchedDeletes(Session* session, size_t count, size_t batchSize, BatchQueryFormat format, void* context, size_t* deleted, size_t* failed) {
+    runBatchedWrites(session, count, batchSize, pipelineDelete, NULL, format, context, deleted, failed);
+}
@@ -0,0 +1,56 @@
+#ifndef TUTORIAL_QUERY_PIPELINE_H
+#define TUTORIAL_QUERY_PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum { PENDING_VOID, PENDING_CONCEPT, PENDING_CONCEPT_MAPS, PENDING_STRINGS } PendingKind;
+
+typedef struct PendingQuery PendingQuery;
+typedef void (*QueryCallback)(PendingQuery* query, void* context);
+
+// A query dispatched on a pipelined transaction. Promises are resolved and iterators handed to the
+// callback only when the pipeline is awaited; until then the query stays in flight. This is pipelining,
+// not asynchrony: callbacks run synchronously on the awaiting thread, in issue order.
+struct PendingQuery {
+    PendingKind kind;
+    union {
+        VoidPromise* voidPromise;
+        ConceptPromise* conceptPromise;
+        ConceptMapIterator* conceptMaps;
+        StringIterator* strings;
+    } handle;
+    Concept* concept; // result of a resolved PENDING_CONCEPT query
+    QueryCallback callback;
+    void* context;
+    bool resolved;
+    bool failed;
+};
+
+typedef struct {
+    Transaction* tx;
+    Options* opts;
+    PendingQuery** queries;
+    size_t count;
+    size_t capacity;
+} QueryPipeline;
+
+// Formats the index-th query of a batched write into query.
+typedef void (*BatchQueryFormat)(void* context, size_t index, char* query, size_t size);
+
+QueryPipeline* pipelineNew(Transaction* tx, Options* opts);
+PendingQuery* pipelineDefine(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+PendingQuery* pipelineDelete(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+PendingQuery* pipelineGetAggregate(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+PendingQuery* pipelineGet(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+PendingQuery* pipelineInsert(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+PendingQuery* pipelineUpdate(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+PendingQuery* pipelineFetch(QueryPipeline* pipeline, const char* query, QueryCallback callback, void* context);
+bool pipelineResolve(PendingQuery* query);
+bool pipelineAwaitAll(QueryPipeline* pipeline);
+void pipelineDrop(QueryPipeline* pipeline);
+void pipelineDrainInsert(PendingQuery* query, void* context);
+void runBatchedInserts(Session* session, size_t count, size_t batchSize, BatchQueryFormat format, void* context, size_t* written, size_t* failed);
+void runBatchedDeletes(Session* session, size_t count, size_t batchSize, BatchQueryFormat format, void* context, size_t* deleted, size_t* failed);
+
+#endif
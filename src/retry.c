@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../include/typedb_driver.h"
+#include "retry.h"
+#include "profiling.h"
+#include "platform.h"
+
+#define RETRY_MAX_ATTEMPTS 8
+#define RETRY_BASE_DELAY_US 1000
+#define RETRY_MAX_DELAY_US 200000
+#define RETRY_BUDGET_SECONDS 5.0
+#define RETRY_MAX_OPERATIONS 32
+
+typedef enum { WRITE_ERROR_NONE, WRITE_ERROR_CONFLICT, WRITE_ERROR_FATAL } WriteErrorClass;
+
+const RetryPolicy DEFAULT_RETRY_POLICY = { RETRY_MAX_ATTEMPTS, RETRY_BASE_DELAY_US, RETRY_MAX_DELAY_US, RETRY_BUDGET_SECONDS };
+
+typedef struct {
+    const char* operation;
+    size_t calls;
+    size_t attempts;
+    size_t conflicts;
+    size_t retries;
+    size_t exhausted; // gave up on a conflict after the attempt or time budget ran out
+    size_t fatal;
+} RetryCounters;
+
+typedef struct {
+    Mutex lock;
+    RetryCounters operations[RETRY_MAX_OPERATIONS];
+    size_t count;
+} RetryStats;
+
+static RetryStats RETRY_STATS = { .lock = MUTEX_INITIALIZER };
+
+// Server error codes of transaction isolation violations: the transaction lost a race with a concurrent
+// commit and re-running it on fresh data can succeed. Other errors, including other codes that happen
+// to share the prefix, are fatal.
+static const char* const RETRYABLE_ERROR_CODES[] = { "ISO01", "ISO02", "ISO03" };
+
+// True if code is a retryable error code, followed by end (or the closing bracket when terminator is ']').
+static bool isRetryableErrorCode(const char* code, char terminator) {
+    for (size_t i = 0; i < sizeof(RETRYABLE_ERROR_CODES) / sizeof(RETRYABLE_ERROR_CODES[0]); i++) {
+        size_t len = strlen(RETRYABLE_ERROR_CODES[i]);
+        if (strncmp(code, RETRYABLE_ERROR_CODES[i], len) == 0 && code[len] == terminator) return true;
+    }
+    return false;
+}
+
+// Matches the driver's error code, or the server code the message starts with ("[ISO01] ...") when the
+// driver reports the server error under its own code. The message text itself is never matched.
+static bool isRetryableError(const char* code, const char* message) {
+    return isRetryableErrorCode(code, '\0') || (message[0] == '[' && isRetryableErrorCode(message + 1, ']'));
+}
+
+// Consumes the pending driver error, if any. Fatal errors are reported like FAILED() does.
+static WriteErrorClass takeWriteError(const char* operation) {
+    if (!check_error()) return WRITE_ERROR_NONE;
+    Error* error = get_last_error();
+    char* errcode = error_code(error);
+    char* errmsg = error_message(error);
+    WriteErrorClass errorClass = isRetryableError(errcode, errmsg) ? WRITE_ERROR_CONFLICT : WRITE_ERROR_FATAL;
+    if (errorClass == WRITE_ERROR_FATAL) fprintf(stderr, "Error!\n%s failed\n%s: %s\n", operation, errcode, errmsg);
+    string_free(errmsg);
+    string_free(errcode);
+    error_drop(error);
+    return errorClass;
+}
+
+static RetryCounters* retryCountersLocked(const char* operation) {
+    for (size_t i = 0; i < RETRY_STATS.count; i++) {
+        if (strcmp(RETRY_STATS.operations[i].operation, operation) == 0) return &RETRY_STATS.operations[i];
+    }
+    if (RETRY_STATS.count == RETRY_MAX_OPERATIONS) return &RETRY_STATS.operations[RETRY_MAX_OPERATIONS - 1];
+    RetryCounters* counters = &RETRY_STATS.operations[RETRY_STATS.count++];
+    counters->operation = operation;
+    return counters;
+}
+
+// Full jitter: sleep a uniformly random time up to the exponentially growing cap.
+static long retryDelayUs(const RetryPolicy* policy, int attempt) {
+    static THREAD_LOCAL unsigned int seed = 0;
+    if (seed == 0) seed = (unsigned int)time(NULL) ^ (unsigned int)(uintptr_t)&seed;
+    long cap = policy->baseDelayUs << (attempt < 20 ? attempt : 20);
+    if (cap > policy->maxDelayUs) cap = policy->maxDelayUs;
+    return (long)(randomNext(&seed) % (cap + 1));
+}
+
+// Runs operation in a fresh write transaction and commits it (or just closes it when the operation had
+// nothing to commit), re-running it after isolation conflicts
+// with jittered backoff until the policy's attempt or time budget is spent. Returns the operation's
+// result, or -1 on a fatal error or when the budget runs out.
+long runWithRetry(Session* session, const char* operation, WriteOperation fn, void* context, const RetryPolicy* policy) {
+    Options* opts = options_new();
+    double started = monotonicSeconds();
+    size_t attempts = 0, conflicts = 0;
+    long result = -1;
+    WriteErrorClass errorClass = WRITE_ERROR_NONE;
+    for (;;) {
+        attempts++;
+        Transaction* tx = NULL;
+        PROFILE(PHASE_TRANSACTION_NEW, tx = transaction_new(session, Write, opts));
+        errorClass = takeWriteError(operation);
+        if (tx == NULL && errorClass == WRITE_ERROR_NONE) errorClass = WRITE_ERROR_FATAL;
+        if (errorClass == WRITE_ERROR_NONE) {
+            bool commit = true;
+            result = fn(tx, opts, context, &commit);
+            if ((errorClass = takeWriteError(operation)) == WRITE_ERROR_NONE && result >= 0) {
+                if (commit) {
+                    PROFILE(PHASE_COMMIT, void_promise_resolve(transaction_commit(tx)));
+                    errorClass = takeWriteError(operation);
+                } else transaction_close(tx);
+            } else {
+                transaction_close(tx);
+                if (errorClass == WRITE_ERROR_NONE) errorClass = WRITE_ERROR_FATAL; // failed without a driver error
+            }
+        }
+        if (errorClass != WRITE_ERROR_CONFLICT) break;
+        conflicts++;
+        long delayUs = retryDelayUs(policy, (int)attempts - 1);
+        if ((int)attempts >= policy->maxAttempts || monotonicSeconds() - started + delayUs / 1e6 > policy->budgetSeconds) break;
+        sleepMicros(delayUs);
+    }
+    options_drop(opts);
+
+    mutexLock(&RETRY_STATS.lock);
+    RetryCounters* counters = retryCountersLocked(operation);
+    counters->calls++;
+    counters->attempts += attempts;
+    counters->conflicts += conflicts;
+    counters->retries += attempts - 1;
+    if (errorClass == WRITE_ERROR_CONFLICT) counters->exhausted++;
+    if (errorClass == WRITE_ERROR_FATAL) counters->fatal++;
+    mutexUnlock(&RETRY_STATS.lock);
+    if (errorClass == WRITE_ERROR_CONFLICT) fprintf(stderr, "%s gave up after %zu conflicting attempts.\n", operation, attempts);
+    return errorClass == WRITE_ERROR_NONE ? result : -1;
+}
+
+// Prints conflict and retry counters per operation, most contended first.
+void printRetryStats(void) {
+    mutexLock(&RETRY_STATS.lock);
+    RetryCounters sorted[RETRY_MAX_OPERATIONS];
+    size_t count = RETRY_STATS.count;
+    memcpy(sorted, RETRY_STATS.operations, count * sizeof(RetryCounters));
+    mutexUnlock(&RETRY_STATS.lock);
+    for (size_t i = 1; i < count; i++) {
+        RetryCounters current = sorted[i];
+        size_t j = i;
+        for (; j > 0 && sorted[j - 1].conflicts < current.conflicts; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = current;
+    }
+    printf("Write retries\n");
+    for (size_t i = 0; i < count; i++) {
+        RetryCounters* c = &sorted[i];
+        printf("  %-16s %zu calls, %zu attempts, %zu conflicts (%.1f%%), %zu retries, %zu exhausted, %zu fatal\n",
+               c->operation, c->calls, c->attempts, c->conflicts, c->attempts ? 100.0 * c->conflicts / c->attempts : 0.0, c->retries, c->exhausted, c->fatal);
+    }
+}
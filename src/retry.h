@@ -0,0 +1,24 @@
+#ifndef TUTORIAL_RETRY_H
+#define TUTORIAL_RETRY_H
+
+#include <stdbool.h>
+
+typedef struct {
+    int maxAttempts;
+    long baseDelayUs;
+    long maxDelayUs;
+    double budgetSeconds;
+} RetryPolicy;
+
+// Runs the write with the transaction it is given and returns a non-negative result, or -1 with the
+// driver error still set. *commit starts out true; the operation clears it when it wrote nothing (e.g. it
+// matched no file, or several where it expected one), and the transaction is then closed instead of
+// committed. It must be safe to call again after a rollback.
+typedef long (*WriteOperation)(Transaction* tx, Options* opts, void* context, bool* commit);
+
+extern const RetryPolicy DEFAULT_RETRY_POLICY;
+
+long runWithRetry(Session* session, const char* operation, WriteOperation fn, void* context, const RetryPolicy* policy);
+void printRetryStats(void);
+
+#endif
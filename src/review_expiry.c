@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "review_expiry.h"
+#include "profiling.h"
+#include "query_pipeline.h"
+#include "permission_index.h"
+#include "write_listeners.h"
+#include "typeql_escape.h"
+
+#define REVIEW_DATE_QUERY "match $p isa permission, has review-date $d; get $p, $d;"
+#define REVIEW_VALIDITY_QUERY "match $p isa permission, has validity $v; get $p, $v;"
+#define REVIEW_BATCH_SIZE 500
+
+static int64_t currentMillis(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int compareReviewEntries(const void* a, const void* b) {
+    const ReviewEntry* x = (const ReviewEntry*)a;
+    const ReviewEntry* y = (const ReviewEntry*)b;
+    if (x->millis != y->millis) return x->millis < y->millis ? -1 : 1;
+    return strcmp(x->iid, y->iid);
+}
+
+// Returns the first position whose entry is not before (millis, iid); a NULL iid sorts first.
+static size_t reviewIndexLowerBound(const ReviewIndex* index, int64_t millis, const char* iid) {
+    size_t low = 0, high = index->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const ReviewEntry* e = &index->entries[mid];
+        bool before = e->millis < millis || (e->millis == millis && iid != NULL && strcmp(e->iid, iid) < 0);
+        if (before) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+void reviewIndexInit(ReviewIndex* index) {
+    memset(index, 0, sizeof(ReviewIndex));
+    stringMapInit(&index->reviewDates, 1024);
+}
+
+void reviewIndexFree(ReviewIndex* index) {
+    removeWriteListener(index);
+    for (size_t i = 0; i < index->count; i++) free(index->entries[i].iid);
+    free(index->entries);
+    stringMapFree(&index->reviewDates, free);
+}
+
+static long reviewIndexFind(const ReviewIndex* index, const char* iid) {
+    const int64_t* millis = (const int64_t*)stringMapGet(&index->reviewDates, iid);
+    if (millis == NULL) return -1;
+    size_t at = reviewIndexLowerBound(index, *millis, iid);
+    return at < index->count && strcmp(index->entries[at].iid, iid) == 0 ? (long)at : -1;
+}
+
+void reviewIndexRemove(ReviewIndex* index, const char* iid) {
+    long at = reviewIndexFind(index, iid);
+    if (at < 0) return;
+    free(index->entries[at].iid);
+    memmove(&index->entries[at], &index->entries[at + 1], (index->count - at - 1) * sizeof(ReviewEntry));
+    index->count--;
+    free(stringMapRemove(&index->reviewDates, iid));
+}
+
+// Inserts the permission or moves it to its new review date; the move shifts only the entries between
+// the old and new positions.
+void reviewIndexUpdate(ReviewIndex* index, const char* iid, int64_t millis, bool valid) {
+    long at = reviewIndexFind(index, iid);
+    if (at >= 0) {
+        ReviewEntry entry = { millis, index->entries[at].iid, valid };
+        // The bound counts the old entry when it sorts before the new key.
+        size_t to = reviewIndexLowerBound(index, millis, iid);
+        if (to > (size_t)at) memmove(&index->entries[at], &index->entries[at + 1], (--to - at) * sizeof(ReviewEntry));
+        else memmove(&index->entries[to + 1], &index->entries[to], (at - to) * sizeof(ReviewEntry));
+        index->entries[to] = entry;
+        *(int64_t*)stringMapGet(&index->reviewDates, iid) = millis;
+        return;
+    }
+    if (index->count == index->capacity) {
+        index->capacity = index->capacity ? index->capacity * 2 : 1024;
+        index->entries = realloc(index->entries, index->capacity * sizeof(ReviewEntry));
+    }
+    size_t to = reviewIndexLowerBound(index, millis, iid);
+    memmove(&index->entries[to + 1], &index->entries[to], (index->count - to) * sizeof(ReviewEntry));
+    index->entries[to] = (ReviewEntry){ millis, strdup(iid), valid };
+    index->count++;
+    int64_t* date = malloc(sizeof(int64_t));
+    *date = millis;
+    stringMapPut(&index->reviewDates, iid, date);
+}
+
+// Visits the entries with from <= review-date < to in date order and returns how many there are.
+size_t reviewIndexRange(const ReviewIndex* index, int64_t from, int64_t to, void (*visit)(const ReviewEntry* entry, void* context), void* context) {
+    size_t first = reviewIndexLowerBound(index, from, NULL), last = reviewIndexLowerBound(index, to, NULL);
+    for (size_t i = first; visit != NULL && i < last; i++) visit(&index->entries[i], context);
+    return last > first ? last - first : 0;
+}
+
+// Appends the entries unsorted; reviewIndexSort must follow before any lookup.
+static void reviewIndexAppend(ReviewIndex* index, const char* iid, int64_t millis) {
+    if (index->count == index->capacity) {
+        index->capacity = index->capacity ? index->capacity * 2 : 1024;
+        index->entries = realloc(index->entries, index->capacity * sizeof(ReviewEntry));
+    }
+    index->entries[index->count++] = (ReviewEntry){ millis, strdup(iid), true };
+}
+
+static void reviewIndexSort(ReviewIndex* index) {
+    qsort(index->entries, index->count, sizeof(ReviewEntry), compareReviewEntries);
+    for (size_t i = 0; i < index->count; i++) {
+        int64_t* date = malloc(sizeof(int64_t));
+        *date = index->entries[i].millis;
+        free(stringMapRemove(&index->reviewDates, index->entries[i].iid));
+        stringMapPut(&index->reviewDates, index->entries[i].iid, date);
+    }
+}
+
+// A rescheduled review also makes the permission valid again; see schedulePermissionReviews.
+static void reviewIndexReviewScheduled(void* context, const char* iid, int64_t reviewMillis) {
+    reviewIndexUpdate((ReviewIndex*)context, iid, reviewMillis, true);
+}
+
+// Loads every permission with a review date, then subscribes the index to the reviews this process
+// schedules. A permission with several review dates is indexed under its latest one. The index has no
+// lock, so it must be read and written from the thread that schedules the reviews.
+bool reviewIndexLoad(ReviewIndex* index, DatabaseManager* dbManager, const char* dbName) {
+    reviewIndexInit(index);
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        options_drop(opts);
+        return false;
+    }
+    Transaction* tx = transaction_new(session, Read, opts);
+    bool loaded = tx != NULL && !FAILED();
+    if (loaded) {
+        ConceptMapIterator* response = query_get(tx, REVIEW_DATE_QUERY, opts);
+        ConceptMap* cm = NULL;
+        while (response != NULL && (cm = concept_map_iterator_next(response)) != NULL) {
+            char* iid = conceptMapIid(cm, "p");
+            Concept* date = concept_map_get(cm, "d");
+            Concept* value = attribute_get_value(date);
+            reviewIndexAppend(index, iid, value_get_date_time_as_millis(value));
+            concept_drop(value);
+            concept_drop(date);
+            string_free(iid);
+            concept_map_drop(cm);
+        }
+        loaded = response != NULL && !FAILED();
+        concept_map_iterator_drop(response);
+        reviewIndexSort(index);
+        size_t unique = 0;
+        for (size_t i = 0; i < index->count; i++) {
+            if (*(int64_t*)stringMapGet(&index->reviewDates, index->entries[i].iid) != index->entries[i].millis) {
+                free(index->entries[i].iid);
+                continue;
+            }
+            index->entries[unique++] = index->entries[i];
+        }
+        index->count = unique;
+
+        response = loaded ? query_get(tx, REVIEW_VALIDITY_QUERY, opts) : NULL;
+        while (response != NULL && (cm = concept_map_iterator_next(response)) != NULL) {
+            char* iid = conceptMapIid(cm, "p");
+            Concept* validity = concept_map_get(cm, "v");
+            Concept* value = attribute_get_value(validity);
+            long at = reviewIndexFind(index, iid);
+            if (at >= 0 && !value_get_boolean(value)) index->entries[at].valid = false;
+            concept_drop(value);
+            concept_drop(validity);
+            string_free(iid);
+            concept_map_drop(cm);
+        }
+        loaded = loaded && response != NULL && !FAILED();
+        concept_map_iterator_drop(response);
+        transaction_close(tx);
+    }
+    session_close(session);
+    options_drop(opts);
+    if (loaded) addWriteListener((WriteListener){ index, NULL, NULL, NULL, reviewIndexReviewScheduled });
+    return loaded;
+}
+
+static void formatReviewDate(int64_t millis, char* out, size_t size) {
+    time_t seconds = (time_t)(millis / 1000);
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    size_t len = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(out + len, size - len, ".%03d", (int)(millis % 1000));
+}
+
+// Replaces the review date of every permission held by the subject with this email, and marks those
+// permissions valid again, in one write transaction. Listeners hear about each permission once the
+// transaction commits. Returns the number of permissions rescheduled, or -1 on failure.
+long schedulePermissionReviews(DatabaseManager* dbManager, const char* dbName, const char* email, int64_t reviewMillis) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        options_drop(opts);
+        return -1;
+    }
+    Transaction* tx = transaction_new(session, Write, opts);
+    if (tx == NULL || FAILED()) {
+        session_close(session);
+        options_drop(opts);
+        return -1;
+    }
+    char* escaped = escapeTypeQLCopy(email);
+    size_t size = strlen(escaped) + 128;
+    char* query = malloc(size);
+    snprintf(query, size, "match $s isa subject, has email '%s'; $p (subject: $s) isa permission; get $p;", escaped);
+    free(escaped);
+    char** iids = NULL;
+    size_t count = 0;
+    ConceptMapIterator* response = query_get(tx, query, opts);
+    ConceptMap* cm = NULL;
+    while (response != NULL && (cm = concept_map_iterator_next(response)) != NULL) {
+        iids = realloc(iids, (count + 1) * sizeof(char*));
+        char* iid = conceptMapIid(cm, "p");
+        iids[count++] = strdup(iid);
+        string_free(iid);
+        concept_map_drop(cm);
+    }
+    bool written = response != NULL && !FAILED();
+    concept_map_iterator_drop(response);
+    free(query);
+
+    // As in expireOverduePermissions, deletes resolve before the inserts are sent.
+    char date[32], update[256];
+    formatReviewDate(reviewMillis, date, sizeof(date));
+    if (written) {
+        QueryPipeline* deletes = pipelineNew(tx, opts);
+        for (size_t i = 0; i < count; i++) {
+            snprintf(update, sizeof(update), "match $p iid %s, has review-date $d; delete $p has $d;", iids[i]);
+            pipelineDelete(deletes, update, NULL, NULL);
+            snprintf(update, sizeof(update), "match $p iid %s, has validity $v; delete $p has $v;", iids[i]);
+            pipelineDelete(deletes, update, NULL, NULL);
+        }
+        written = pipelineAwaitAll(deletes);
+        pipelineDrop(deletes);
+    }
+    if (written) {
+        QueryPipeline* inserts = pipelineNew(tx, opts);
+        for (size_t i = 0; i < count; i++) {
+            snprintf(update, sizeof(update), "match $p iid %s; insert $p has review-date %s, has validity true;", iids[i], date);
+            pipelineInsert(inserts, update, pipelineDrainInsert, NULL);
+        }
+        written = pipelineAwaitAll(inserts);
+        pipelineDrop(inserts);
+    }
+    if (written) {
+        void_promise_resolve(transaction_commit(tx));
+        written = !FAILED();
+    } else transaction_close(tx);
+    for (size_t i = 0; i < count; i++) {
+        if (written) notifyPermissionReviewScheduled(iids[i], reviewMillis);
+        free(iids[i]);
+    }
+    free(iids);
+    session_close(session);
+    options_drop(opts);
+    return written ? (long)count : -1;
+}
+
+typedef struct {
+    const ReviewEntry** entries;
+    size_t count;
+} ReviewSelection;
+
+static void selectValidReview(const ReviewEntry* entry, void* context) {
+    ReviewSelection* selection = (ReviewSelection*)context;
+    if (entry->valid) selection->entries[selection->count++] = entry;
+}
+
+// Sets validity to false on every still-valid permission whose review date is before now, replacing
+// any validity it had, REVIEW_BATCH_SIZE permissions per write transaction. The index is updated for
+// each committed batch; a batch that cannot start, write or commit is reported as failed and stays valid
+// in the index. Returns the number of permissions expired, or -1 if the session failed.
+long expireOverduePermissions(ReviewIndex* index, DatabaseManager* dbManager, const char* dbName, int64_t now) {
+    size_t overdue = reviewIndexRange(index, INT64_MIN, now, NULL, NULL);
+    ReviewSelection selection = { malloc((overdue + 1) * sizeof(ReviewEntry*)), 0 };
+    reviewIndexRange(index, INT64_MIN, now, selectValidReview, &selection);
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        free(selection.entries);
+        options_drop(opts);
+        return -1;
+    }
+    // Copied out because the entries may move while the batches run.
+    char** iids = malloc((selection.count + 1) * sizeof(char*));
+    for (size_t i = 0; i < selection.count; i++) iids[i] = strdup(selection.entries[i]->iid);
+    free(selection.entries);
+    long expired = 0;
+    size_t failed = 0;
+    char query[256];
+    for (size_t start = 0; start < selection.count; start += REVIEW_BATCH_SIZE) {
+        size_t end = start + REVIEW_BATCH_SIZE < selection.count ? start + REVIEW_BATCH_SIZE : selection.count;
+        Transaction* tx = transaction_new(session, Write, opts);
+        if (tx == NULL || FAILED()) {
+            failed += end - start;
+            continue;
+        }
+        // Deletes resolve before the inserts are sent, so the new validity is never the one deleted.
+        // Dropping a pipeline releases every promise and iterator it holds, whether or not the batch failed.
+        QueryPipeline* deletes = pipelineNew(tx, opts);
+        for (size_t i = start; i < end; i++) {
+            snprintf(query, sizeof(query), "match $p iid %s, has validity $v; delete $p has $v;", iids[i]);
+            pipelineDelete(deletes, query, NULL, NULL);
+        }
+        bool committed = pipelineAwaitAll(deletes);
+        pipelineDrop(deletes);
+        if (committed) {
+            QueryPipeline* inserts = pipelineNew(tx, opts);
+            for (size_t i = start; i < end; i++) {
+                snprintf(query, sizeof(query), "match $p iid %s; insert $p has validity false;", iids[i]);
+                pipelineInsert(inserts, query, pipelineDrainInsert, NULL);
+            }
+            committed = pipelineAwaitAll(inserts);
+            pipelineDrop(inserts);
+        }
+        if (committed) {
+            void_promise_resolve(transaction_commit(tx));
+            committed = !FAILED();
+        } else transaction_close(tx);
+        if (!committed) {
+            failed += end - start;
+            continue;
+        }
+        for (size_t i = start; i < end; i++) {
+            long at = reviewIndexFind(index, iids[i]);
+            if (at >= 0) index->entries[at].valid = false;
+        }
+        expired += (long)(end - start);
+    }
+    printf("Expired %ld of %zu overdue permissions (%zu failed).\n", expired, selection.count, failed);
+    for (size_t i = 0; i < selection.count; i++) free(iids[i]);
+    free(iids);
+    session_close(session);
+    options_drop(opts);
+    return expired;
+}
+
+void benchmarkReviewIndex(size_t permissions, size_t updates) {
+    ReviewIndex index;
+    reviewIndexInit(&index);
+    unsigned int seed = 21;
+    int64_t now = currentMillis(), year = 365LL * 24 * 3600 * 1000;
+    char iid[32];
+    double started = monotonicSeconds();
+    for (size_t p = 0; p < permissions; p++) {
+        snprintf(iid, sizeof(iid), "0x%016zx", p);
+        reviewIndexAppend(&index, iid, now - year + (int64_t)(2.0 * year * rand_r(&seed) / RAND_MAX));
+    }
+    reviewIndexSort(&index);
+    double build = monotonicSeconds() - started;
+    started = monotonicSeconds();
+    size_t overdue = 0, queries = 10000;
+    for (size_t q = 0; q < queries; q++) overdue += reviewIndexRange(&index, now - year, now - year + (int64_t)(q % 365) * (year / 365), NULL, NULL);
+    double range = monotonicSeconds() - started;
+    started = monotonicSeconds();
+    for (size_t u = 0; u < updates; u++) {
+        snprintf(iid, sizeof(iid), "0x%016zx", (size_t)rand_r(&seed) % permissions);
+        reviewIndexUpdate(&index, iid, now + (int64_t)((double)year * rand_r(&seed) / RAND_MAX), true);
+    }
+    double update = monotonicSeconds() - started;
+    printf("Review index benchmark: %zu permissions sorted in %.3f s, %.3f us per range count (%zu matched), %.3f us per update\n",
+           index.count, build, range / queries * 1e6, overdue, updates ? update / updates * 1e6 : 0.0);
+    reviewIndexFree(&index);
+}
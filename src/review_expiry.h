@@ -0,0 +1,34 @@
+#ifndef TUTORIAL_REVIEW_EXPIRY_H
+#define TUTORIAL_REVIEW_EXPIRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "string_map.h"
+
+typedef struct {
+    int64_t millis;
+    char* iid;
+    bool valid; // false once the validity attribute is false
+} ReviewEntry;
+
+// Permissions ordered by (review-date, IID) in one sorted array, so a date range is a contiguous run
+// found by binary search. reviewDates maps each IID to its current date, which locates the entry.
+typedef struct {
+    ReviewEntry* entries;
+    size_t count;
+    size_t capacity;
+    StringMap reviewDates; // iid -> malloc'd int64_t millis
+} ReviewIndex;
+
+void reviewIndexInit(ReviewIndex* index);
+void reviewIndexFree(ReviewIndex* index);
+void reviewIndexRemove(ReviewIndex* index, const char* iid);
+void reviewIndexUpdate(ReviewIndex* index, const char* iid, int64_t millis, bool valid);
+size_t reviewIndexRange(const ReviewIndex* index, int64_t from, int64_t to, void (*visit)(const ReviewEntry* entry, void* context), void* context);
+bool reviewIndexLoad(ReviewIndex* index, DatabaseManager* dbManager, const char* dbName);
+long schedulePermissionReviews(DatabaseManager* dbManager, const char* dbName, const char* email, int64_t reviewMillis);
+long expireOverduePermissions(ReviewIndex* index, DatabaseManager* dbManager, const char* dbName, int64_t now);
+void benchmarkReviewIndex(size_t permissions, size_t updates);
+
+#endif
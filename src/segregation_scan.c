@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../include/typedb_driver.h"
+#include "tutorial.h"
+#include "segregation_scan.h"
+#include "profiling.h"
+#include "query_pipeline.h"
+#include "string_map.h"
+#include "materialize.h"
+
+#define SEGREGATION_POLICY_QUERY "match $pol (action: $a1, action: $a2) isa segregation-policy; get $pol, $a1, $a2;"
+#define SEGREGATION_PERMISSION_QUERY "match (subject: $s, access: $ac) isa permission; $ac (object: $o, action: $a) isa access; get $s, $o, $a;"
+#define SEGREGATION_VIOLATION_QUERY "match (object: $o, policy: $pol, subject: $s) isa segregation-violation; get $o, $pol, $s;"
+#define SEGREGATION_BATCH_SIZE 500
+#define SEGREGATION_CHUNK 1024 // subjects per unit of work
+#define SEGREGATION_MAX_THREADS 64
+
+// Concepts are numbered densely across kinds; IIDs are unique, so one table serves all of them.
+typedef struct {
+    StringMap ids; // iid -> id + 1
+    char** iids;
+    uint32_t count;
+    size_t capacity;
+} IidTable;
+
+// Policies, permissions and existing violations as id triples. permissions is sorted by (subject,
+// object, action) and existing by (object, policy, subject); policies are keyed by either action.
+typedef struct {
+    uint32_t* permissions;
+    size_t permissionCount;
+    uint32_t* subjectStarts; // offsets into permissions where each subject begins, plus the end
+    size_t subjectCount;
+    uint32_t* policyOffsets; // per action id, into policyEntries
+    uint32_t* policyEntries; // (other action, policy) pairs
+    size_t policyCount;
+    uint32_t* existing;
+    size_t existingCount;
+    _Atomic size_t nextChunk;
+    uint32_t* violations;    // (object, policy, subject) triples found by the scan
+    size_t violationCount;
+    pthread_mutex_t lock;
+} SegregationScan;
+
+static int compareTriples(const void* a, const void* b) {
+    const uint32_t* x = (const uint32_t*)a;
+    const uint32_t* y = (const uint32_t*)b;
+    for (int i = 0; i < 3; i++) {
+        if (x[i] != y[i]) return (x[i] > y[i]) - (x[i] < y[i]);
+    }
+    return 0;
+}
+
+// Sorts the triples and drops duplicates, returning the new count.
+static size_t sortUniqueTriples(uint32_t* triples, size_t count) {
+    qsort(triples, count, 3 * sizeof(uint32_t), compareTriples);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique > 0 && compareTriples(triples + 3 * (unique - 1), triples + 3 * i) == 0) continue;
+        memmove(triples + 3 * unique++, triples + 3 * i, 3 * sizeof(uint32_t));
+    }
+    return unique;
+}
+
+// Builds the subject ranges and the per-action policy lists. policies holds (action, action, policy)
+// triples in any order; pairs of the same action are ignored.
+static void segregationScanInit(SegregationScan* scan, uint32_t idCount, uint32_t* permissions, size_t permissionCount,
+                         const uint32_t* policies, size_t policyCount, uint32_t* existing, size_t existingCount) {
+    memset(scan, 0, sizeof(SegregationScan));
+    scan->permissions = permissions;
+    scan->permissionCount = sortUniqueTriples(permissions, permissionCount);
+    scan->subjectStarts = malloc((scan->permissionCount + 1) * sizeof(uint32_t));
+    for (size_t p = 0; p < scan->permissionCount; p++) {
+        if (p == 0 || permissions[3 * p] != permissions[3 * (p - 1)]) scan->subjectStarts[scan->subjectCount++] = (uint32_t)p;
+    }
+    scan->subjectStarts[scan->subjectCount] = (uint32_t)scan->permissionCount;
+    scan->policyOffsets = calloc((size_t)idCount + 1, sizeof(uint32_t));
+    scan->policyEntries = malloc((2 * policyCount + 1) * 2 * sizeof(uint32_t));
+    for (size_t p = 0; p < policyCount; p++) {
+        if (policies[3 * p] == policies[3 * p + 1]) continue;
+        scan->policyOffsets[policies[3 * p] + 1]++;
+        scan->policyOffsets[policies[3 * p + 1] + 1]++;
+    }
+    for (uint32_t a = 0; a < idCount; a++) scan->policyOffsets[a + 1] += scan->policyOffsets[a];
+    uint32_t* fill = malloc(((size_t)idCount + 1) * sizeof(uint32_t));
+    memcpy(fill, scan->policyOffsets, ((size_t)idCount + 1) * sizeof(uint32_t));
+    for (size_t p = 0; p < policyCount; p++) {
+        uint32_t a = policies[3 * p], b = policies[3 * p + 1], policy = policies[3 * p + 2];
+        if (a == b) continue;
+        scan->policyEntries[2 * fill[a]] = b;
+        scan->policyEntries[2 * fill[a]++ + 1] = policy;
+        scan->policyEntries[2 * fill[b]] = a;
+        scan->policyEntries[2 * fill[b]++ + 1] = policy;
+        scan->policyCount++;
+    }
+    free(fill);
+    scan->existing = existing;
+    scan->existingCount = existing != NULL ? sortUniqueTriples(existing, existingCount) : 0;
+    pthread_mutex_init(&scan->lock, NULL);
+}
+
+static void segregationScanFree(SegregationScan* scan) {
+    free(scan->subjectStarts);
+    free(scan->policyOffsets);
+    free(scan->policyEntries);
+    free(scan->violations);
+    pthread_mutex_destroy(&scan->lock);
+}
+
+// Within one subject, permissions are grouped by object with the actions sorted, so a policy is
+// violated on an object when the other action of a policy on one of its actions is found further on.
+static void* segregationScanWorker(void* arg) {
+    SegregationScan* scan = (SegregationScan*)arg;
+    uint32_t* found = NULL;
+    size_t foundCount = 0, foundCapacity = 0;
+    for (size_t chunk; (chunk = atomic_fetch_add(&scan->nextChunk, 1)) * SEGREGATION_CHUNK < scan->subjectCount;) {
+        size_t last = (chunk + 1) * SEGREGATION_CHUNK < scan->subjectCount ? (chunk + 1) * SEGREGATION_CHUNK : scan->subjectCount;
+        for (size_t s = chunk * SEGREGATION_CHUNK; s < last; s++) {
+            uint32_t from = scan->subjectStarts[s], to = scan->subjectStarts[s + 1];
+            for (uint32_t groupStart = from, groupEnd; groupStart < to; groupStart = groupEnd) {
+                const uint32_t* first = scan->permissions + 3 * groupStart;
+                for (groupEnd = groupStart + 1; groupEnd < to && scan->permissions[3 * groupEnd + 1] == first[1]; groupEnd++);
+                for (uint32_t i = groupStart; i + 1 < groupEnd; i++) {
+                    uint32_t action = scan->permissions[3 * i + 2];
+                    for (uint32_t e = scan->policyOffsets[action]; e < scan->policyOffsets[action + 1]; e++) {
+                        uint32_t other = scan->policyEntries[2 * e];
+                        if (other < action) continue; // found from the other side
+                        uint32_t low = i + 1, high = groupEnd;
+                        while (low < high) {
+                            uint32_t mid = low + (high - low) / 2;
+                            if (scan->permissions[3 * mid + 2] < other) low = mid + 1;
+                            else high = mid;
+                        }
+                        if (low == groupEnd || scan->permissions[3 * low + 2] != other) continue;
+                        uint32_t violation[3] = { first[1], scan->policyEntries[2 * e + 1], first[0] };
+                        if (scan->existingCount > 0 && bsearch(violation, scan->existing, scan->existingCount, 3 * sizeof(uint32_t), compareTriples) != NULL) continue;
+                        if (foundCount == foundCapacity) {
+                            foundCapacity = foundCapacity ? foundCapacity * 2 : 1024;
+                            found = realloc(found, foundCapacity * 3 * sizeof(uint32_t));
+                        }
+                        memcpy(found + 3 * foundCount++, violation, sizeof(violation));
+                    }
+                }
+            }
+        }
+    }
+    if (foundCount > 0) {
+        pthread_mutex_lock(&scan->lock);
+        scan->violations = realloc(scan->violations, (scan->violationCount + foundCount) * 3 * sizeof(uint32_t));
+        memcpy(scan->violations + 3 * scan->violationCount, found, foundCount * 3 * sizeof(uint32_t));
+        scan->violationCount += foundCount;
+        pthread_mutex_unlock(&scan->lock);
+    }
+    free(found);
+    return NULL;
+}
+
+// Finds every (object, policy, subject) violation not already recorded, in a deterministic order. A
+// policy whose two actions are both granted on one object through several accesses yields one violation.
+static void segregationScanRun(SegregationScan* scan, int threads) {
+    threads = threads < 1 ? 1 : threads > SEGREGATION_MAX_THREADS ? SEGREGATION_MAX_THREADS : threads;
+    pthread_t workers[SEGREGATION_MAX_THREADS];
+    for (int t = 1; t < threads; t++) pthread_create(&workers[t], NULL, segregationScanWorker, scan);
+    segregationScanWorker(scan);
+    for (int t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+    scan->violationCount = sortUniqueTriples(scan->violations, scan->violationCount);
+}
+
+static uint32_t iidTableId(IidTable* table, const char* iid) {
+    uint32_t id = (uint32_t)(uintptr_t)stringMapGet(&table->ids, iid);
+    if (id != 0) return id - 1;
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : 1024;
+        table->iids = realloc(table->iids, table->capacity * sizeof(char*));
+    }
+    table->iids[table->count] = strdup(iid);
+    stringMapPut(&table->ids, iid, (void*)(uintptr_t)(table->count + 1));
+    return table->count++;
+}
+
+static void iidTableFree(IidTable* table) {
+    for (uint32_t i = 0; i < table->count; i++) free(table->iids[i]);
+    free(table->iids);
+    stringMapFree(&table->ids, NULL);
+}
+
+typedef struct {
+    IidTable* table;
+    uint32_t* triples;
+    size_t count;
+    size_t capacity;
+} IidTriples;
+
+static void iidTriplesRow(void* context, char* const* iids) {
+    IidTriples* triples = (IidTriples*)context;
+    if (triples->count == triples->capacity) {
+        triples->capacity = triples->capacity ? triples->capacity * 2 : 1024;
+        triples->triples = realloc(triples->triples, triples->capacity * 3 * sizeof(uint32_t));
+    }
+    for (int v = 0; v < 3; v++) triples->triples[3 * triples->count + v] = iidTableId(triples->table, iids[v]);
+    triples->count++;
+}
+
+// Reads a get query binding three variables into id triples. Returns NULL on failure.
+static uint32_t* readIidTriples(Session* session, const char* query, bool inference, const char* vars[3], IidTable* table, size_t* count) {
+    IidTriples triples = { table, malloc(3 * sizeof(uint32_t)), 0, 1 };
+    if (!readIidRows(session, query, inference, vars, 3, iidTriplesRow, &triples)) {
+        free(triples.triples);
+        return NULL;
+    }
+    *count = triples.count;
+    return triples.triples;
+}
+
+typedef struct {
+    const SegregationScan* scan;
+    const IidTable* table;
+} SegregationWrite;
+
+static void segregationInsertQuery(void* context, size_t index, char* query, size_t size) {
+    const SegregationWrite* write = (const SegregationWrite*)context;
+    const uint32_t* v = write->scan->violations + 3 * index;
+    snprintf(query, size, "match $o iid %s; $pol iid %s; $s iid %s; insert (object: $o, policy: $pol, subject: $s) isa segregation-violation;",
+             write->table->iids[v[0]], write->table->iids[v[1]], write->table->iids[v[2]]);
+}
+
+// Inserts the violations SEGREGATION_BATCH_SIZE per transaction.
+static void writeSegregationViolations(Session* session, const SegregationScan* scan, const IidTable* table, SegregationStats* stats) {
+    SegregationWrite write = { scan, table };
+    runBatchedInserts(session, scan->violationCount, SEGREGATION_BATCH_SIZE, segregationInsertQuery, &write, &stats->written, &stats->failed);
+}
+
+// Loads the policies, the subjects' permissions (with inference, so inferred permissions count too) and
+// the violations already recorded, scans all subjects across threads and inserts the new violations.
+// Sets stats.error, and leaves the rest zero, if nothing could be scanned.
+SegregationStats scanSegregationViolations(DatabaseManager* dbManager, const char* dbName, bool inference, int threads) {
+    SegregationStats stats = {0};
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(opts);
+        stats.error = true;
+        return stats;
+    }
+    IidTable table = {0};
+    stringMapInit(&table.ids, 1024);
+    const char* policyVars[3] = { "a1", "a2", "pol" };
+    const char* permissionVars[3] = { "s", "o", "a" };
+    const char* violationVars[3] = { "o", "pol", "s" };
+    size_t policyCount = 0, permissionCount = 0, existingCount = 0;
+    uint32_t* policies = readIidTriples(session, SEGREGATION_POLICY_QUERY, false, policyVars, &table, &policyCount);
+    uint32_t* permissions = policies != NULL ? readIidTriples(session, SEGREGATION_PERMISSION_QUERY, inference, permissionVars, &table, &permissionCount) : NULL;
+    uint32_t* existing = permissions != NULL ? readIidTriples(session, SEGREGATION_VIOLATION_QUERY, false, violationVars, &table, &existingCount) : NULL;
+    if (existing == NULL) {
+        fprintf(stderr, "Failed to load segregation policies and permissions.\n");
+        stats.error = true;
+    } else {
+        // The policy query answers each policy once per order of its two actions; keep one.
+        for (size_t p = 0; p < policyCount; p++) {
+            uint32_t* policy = policies + 3 * p;
+            if (policy[0] > policy[1]) {
+                uint32_t action = policy[0];
+                policy[0] = policy[1];
+                policy[1] = action;
+            }
+        }
+        policyCount = sortUniqueTriples(policies, policyCount);
+        SegregationScan scan;
+        segregationScanInit(&scan, table.count, permissions, permissionCount, policies, policyCount, existing, existingCount);
+        double started = monotonicSeconds();
+        segregationScanRun(&scan, threads);
+        stats.scanSeconds = monotonicSeconds() - started;
+        stats.subjects = scan.subjectCount;
+        stats.permissions = scan.permissionCount;
+        stats.policies = scan.policyCount;
+        stats.violations = scan.violationCount;
+        writeSegregationViolations(session, &scan, &table, &stats);
+        segregationScanFree(&scan);
+        printf("Segregation scan: %zu subjects, %zu permissions, %zu policy pairs, %zu new violations (%zu written, %zu failed), scan %.3f s\n",
+               stats.subjects, stats.permissions, stats.policies, stats.violations, stats.written, stats.failed, stats.scanSeconds);
+    }
+    free(policies);
+    free(permissions);
+    free(existing);
+    iidTableFree(&table);
+    session_close(session);
+    options_drop(opts);
+    return stats;
+}
+
+// Synthetic subjects with a handful of permissions each over a shared pool of objects and actions.
+void benchmarkSegregationScan(size_t subjects, int permissionsPerSubject, int threads) {
+    uint32_t actions = 32, objects = 100000, policyCount = 64;
+    uint32_t objectBase = actions, subjectBase = actions + objects, policyBase = subjectBase + (uint32_t)subjects;
+    unsigned int seed = 5;
+    uint32_t* policies = malloc(policyCount * 3 * sizeof(uint32_t));
+    for (uint32_t p = 0; p < policyCount; p++) {
+        policies[3 * p] = rand_r(&seed) % actions;
+        policies[3 * p + 1] = rand_r(&seed) % actions;
+        policies[3 * p + 2] = policyBase + p;
+    }
+    size_t permissionCount = subjects * permissionsPerSubject;
+    uint32_t* permissions = malloc(permissionCount * 3 * sizeof(uint32_t));
+    for (size_t s = 0; s < subjects; s++) {
+        uint32_t object = objectBase + rand_r(&seed) % objects;
+        for (int k = 0; k < permissionsPerSubject; k++) {
+            uint32_t* p = permissions + 3 * (s * permissionsPerSubject + k);
+            if (k % 4 == 0) object = objectBase + rand_r(&seed) % objects; // a few actions per object
+            p[0] = subjectBase + (uint32_t)s;
+            p[1] = object;
+            p[2] = rand_r(&seed) % actions;
+        }
+    }
+    double started = monotonicSeconds();
+    SegregationScan scan;
+    segregationScanInit(&scan, policyBase + policyCount, permissions, permissionCount, policies, policyCount, NULL, 0);
+    double prepared = monotonicSeconds() - started;
+    started = monotonicSeconds();
+    segregationScanRun(&scan, threads);
+    double scanned = monotonicSeconds() - started;
+    printf("Segregation scan benchmark: %zu subjects, %zu permissions, %zu violations; %.3f s to sort, %.3f s to scan on %d threads\n",
+           scan.subjectCount, scan.permissionCount, scan.violationCount, prepared, scanned, threads);
+    segregationScanFree(&scan);
+    free(permissions);
+    free(policies);
+}
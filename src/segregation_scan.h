@@ -0,0 +1,21 @@
+#ifndef TUTORIAL_SEGREGATION_SCAN_H
+#define TUTORIAL_SEGREGATION_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t subjects;
+    size_t permissions;
+    size_t policies;
+    size_t violations;
+    size_t written;
+    size_t failed;
+    double scanSeconds;
+    bool error; // the session could not be opened or the policies and permissions could not be read
+} SegregationStats;
+
+SegregationStats scanSegregationViolations(DatabaseManager* dbManager, const char* dbName, bool inference, int threads);
+void benchmarkSegregationScan(size_t subjects, int permissionsPerSubject, int threads);
+
+#endif
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "string_map.h"
+
+uint32_t hashPath(const char* path) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    while (*path) {
+        hash ^= (unsigned char)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void stringMapInit(StringMap* map, size_t expected) {
+    map->capacity = 16;
+    while (map->capacity < expected * 2) map->capacity *= 2;
+    map->keys = calloc(map->capacity, sizeof(char*));
+    map->values = calloc(map->capacity, sizeof(void*));
+    map->count = 0;
+}
+
+static size_t stringMapSlot(const StringMap* map, const char* key) {
+    size_t slot = hashPath(key) & (map->capacity - 1);
+    while (map->keys[slot] != NULL && strcmp(map->keys[slot], key) != 0) slot = (slot + 1) & (map->capacity - 1);
+    return slot;
+}
+
+void* stringMapGet(const StringMap* map, const char* key) {
+    return map->values[stringMapSlot(map, key)];
+}
+
+void stringMapPut(StringMap* map, const char* key, void* value) {
+    if ((map->count + 1) * 2 > map->capacity) {
+        StringMap grown;
+        stringMapInit(&grown, map->capacity);
+        for (size_t i = 0; i < map->capacity; i++) {
+            if (map->keys[i] == NULL) continue;
+            size_t slot = stringMapSlot(&grown, map->keys[i]);
+            grown.keys[slot] = map->keys[i];
+            grown.values[slot] = map->values[i];
+        }
+        grown.count = map->count;
+        free(map->keys);
+        free(map->values);
+        *map = grown;
+    }
+    size_t slot = stringMapSlot(map, key);
+    if (map->keys[slot] == NULL) {
+        map->keys[slot] = strdup(key);
+        map->count++;
+    }
+    map->values[slot] = value;
+}
+
+// Removes the key and returns its value, or NULL if it was absent.
+void* stringMapRemove(StringMap* map, const char* key) {
+    size_t slot = stringMapSlot(map, key);
+    if (map->keys[slot] == NULL) return NULL;
+    void* value = map->values[slot];
+    free(map->keys[slot]);
+    size_t mask = map->capacity - 1;
+    for (size_t next = (slot + 1) & mask; map->keys[next] != NULL; next = (next + 1) & mask) {
+        size_t home = hashPath(map->keys[next]) & mask;
+        // Move the entry back into the hole unless its home lies cyclically in (slot, next].
+        if (((next - home) & mask) < ((next - slot) & mask)) continue;
+        map->keys[slot] = map->keys[next];
+        map->values[slot] = map->values[next];
+        slot = next;
+    }
+    map->keys[slot] = NULL;
+    map->values[slot] = NULL;
+    map->count--;
+    return value;
+}
+
+void stringMapFree(StringMap* map, void (*freeValue)(void*)) {
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->keys[i] == NULL) continue;
+        free(map->keys[i]);
+        if (freeValue) freeValue(map->values[i]);
+    }
+    free(map->keys);
+    free(map->values);
+    memset(map, 0, sizeof(StringMap));
+}
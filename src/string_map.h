@@ -0,0 +1,23 @@
+#ifndef TUTORIAL_STRING_MAP_H
+#define TUTORIAL_STRING_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Open-addressing hash map from owned string keys to values, with linear probing and backward-shift
+// deletion so that no tombstones are needed.
+typedef struct {
+    char** keys;
+    void** values;
+    size_t capacity; // power of two
+    size_t count;
+} StringMap;
+
+uint32_t hashPath(const char* path);
+void stringMapInit(StringMap* map, size_t expected);
+void* stringMapGet(const StringMap* map, const char* key);
+void stringMapPut(StringMap* map, const char* key, void* value);
+void* stringMapRemove(StringMap* map, const char* key);
+void stringMapFree(StringMap* map, void (*freeValue)(void*));
+
+#endif
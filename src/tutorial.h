@@ -0,0 +1,20 @@
+#ifndef TUTORIAL_TUTORIAL_H
+#define TUTORIAL_TUTORIAL_H
+
+// What the modules under src/ use from the walkthrough in tutorial.c. typedb_driver.h has no include
+// guard, so it is included once by each .c file, before any header from src/.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FAILED() check_error_may_print(__FILE__, __LINE__)
+
+extern bool PROFILE_QUERIES;
+
+void handle_error(const char* message);
+bool check_error_may_print(const char* filename, int lineno);
+int getFilesByUser(DatabaseManager* dbManager, const char* dbName, const char* name, bool inference);
+int16_t updateFilePath(DatabaseManager* dbManager, const char* dbName, const char* oldPath, const char* newPath);
+bool deleteFile(DatabaseManager* dbManager, const char* dbName, const char* path);
+
+#endif
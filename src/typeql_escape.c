@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "typeql_escape.h"
+
+// Copies value into out as the body of a quoted TypeQL string, escaping quotes and backslashes.
+// Returns false if it does not fit.
+bool escapeTypeQL(const char* value, char* out, size_t size) {
+    size_t len = 0;
+    if (size == 0) return false;
+    for (const char* c = value; *c; c++) {
+        bool escape = *c == '\'' || *c == '"' || *c == '\\';
+        if (len + (escape ? 2 : 1) >= size) return false;
+        if (escape) out[len++] = '\\';
+        out[len++] = *c;
+    }
+    out[len] = '\0';
+    return true;
+}
+
+// Returns an escaped copy of value, allocated with room for every character to need escaping.
+char* escapeTypeQLCopy(const char* value) {
+    size_t size = 2 * strlen(value) + 1;
+    char* out = malloc(size);
+    escapeTypeQL(value, out, size);
+    return out;
+}
+
+// Copies a regex into out as the body of a quoted TypeQL `like` string. TypeQL hands a `like` string to
+// the regex engine with its backslashes intact, so only quotes that are not already escaped get a
+// backslash; the regex engine reads \' and \" as the quotes themselves. Returns false if it does not fit
+// or the regex ends in a lone backslash.
+bool escapeTypeQLRegex(const char* regex, char* out, size_t size) {
+    size_t len = 0;
+    if (size == 0) return false;
+    for (const char* c = regex; *c; c++) {
+        if (*c == '\\') {
+            if (c[1] == '\0' || len + 2 >= size) return false;
+            out[len++] = *c++;
+            out[len++] = *c;
+            continue;
+        }
+        bool quote = *c == '\'' || *c == '"';
+        if (len + (quote ? 2 : 1) >= size) return false;
+        if (quote) out[len++] = '\\';
+        out[len++] = *c;
+    }
+    out[len] = '\0';
+    return true;
+}
+
+// Turns a path prefix into an anchored regex that matches it literally, ready to use as the body of a
+// TypeQL `like` string: regex metacharacters and quotes are backslash-escaped once, and nothing else
+// needs escaping. Returns false if it does not fit.
+bool prefixToTypeQLRegex(const char* prefix, char* out, size_t size) {
+    size_t len = 0;
+    if (size < 4) return false;
+    out[len++] = '^';
+    for (const char* c = prefix; *c; c++) {
+        bool escape = strchr(".^$*+?()[]{}|\\'\"", *c) != NULL;
+        if (len + (escape ? 2 : 1) + 2 >= size) return false;
+        if (escape) out[len++] = '\\';
+        out[len++] = *c;
+    }
+    out[len++] = '.';
+    out[len++] = '*';
+    out[len] = '\0';
+    return true;
+}
@@ -0,0 +1,12 @@
+#ifndef TUTORIAL_TYPEQL_ESCAPE_H
+#define TUTORIAL_TYPEQL_ESCAPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+bool escapeTypeQL(const char* value, char* out, size_t size);
+char* escapeTypeQLCopy(const char* value);
+bool escapeTypeQLRegex(const char* regex, char* out, size_t size);
+bool prefixToTypeQLRegex(const char* prefix, char* out, size_t size);
+
+#endif
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "../include/cJSON.h"
+#include "tutorial.h"
+#include "user_pages.h"
+#include "typeql_escape.h"
+#include "profiling.h"
+#include "json_arena.h"
+#include "output_sink.h"
+
+#define USER_PAGE_SIZE 1000
+#define USER_CURSOR_TIES_MAX 64
+#define USER_CURSOR_SIZE (3 + 2 * 128 + 1 + 17 * USER_CURSOR_TIES_MAX + 1)
+
+// Position between two pages: the last email, and the answers with that email already returned. Fetch
+// answers carry no IID, so those answers are identified by a hash of their document; users who share an
+// email are told apart by it, and identical documents by how often the hash occurs.
+typedef struct {
+    char email[128];
+    uint64_t ties[USER_CURSOR_TIES_MAX];
+    size_t tieCount; // may exceed USER_CURSOR_TIES_MAX, in which case the position cannot be encoded
+} UserCursor;
+
+static uint64_t hashUserDocument(const char* json) {
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)json; *p; p++) hash = (hash ^ *p) * 1099511628211ULL;
+    return hash;
+}
+
+// Cursors are hex-encoded behind a version tag so callers treat them as opaque: "u2:<email>:<hash>,...".
+static bool encodeUserCursor(const UserCursor* position, char* cursor, size_t size) {
+    size_t len = strlen(position->email);
+    if (position->tieCount > USER_CURSOR_TIES_MAX || 3 + 2 * len + 1 + 17 * position->tieCount + 1 > size) return false;
+    char* out = cursor;
+    memcpy(out, "u2:", 3);
+    out += 3;
+    for (size_t i = 0; i < len; i++, out += 2) snprintf(out, 3, "%02x", (unsigned char)position->email[i]);
+    for (size_t i = 0; i < position->tieCount; i++, out += 17) snprintf(out, 18, "%c%016llx", i == 0 ? ':' : ',', (unsigned long long)position->ties[i]);
+    *out = '\0';
+    return true;
+}
+
+static bool decodeUserCursor(const char* cursor, UserCursor* position) {
+    if (strncmp(cursor, "u2:", 3) != 0) return false;
+    const char* hex = cursor + 3;
+    size_t len = strcspn(hex, ":");
+    if (len % 2 != 0 || len / 2 + 1 > sizeof(position->email) || strspn(hex, "0123456789abcdef") < len) return false;
+    for (size_t i = 0; i < len / 2; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1 || byte == 0) return false;
+        position->email[i] = (char)byte;
+    }
+    position->email[len / 2] = '\0';
+    position->tieCount = 0;
+    for (const char* tie = hex + len; *tie != '\0'; tie += 17) {
+        if (*tie != (position->tieCount == 0 ? ':' : ',') || position->tieCount == USER_CURSOR_TIES_MAX) return false;
+        if (strspn(tie + 1, "0123456789abcdef") < 16) return false;
+        unsigned long long hash;
+        if (sscanf(tie + 1, "%16llx", &hash) != 1) return false;
+        position->ties[position->tieCount++] = hash;
+    }
+    return position->tieCount > 0;
+}
+
+// Fetches one page of users ordered by email, strictly after the position in cursor (NULL for the first
+// page), in its own read transaction. nextCursor receives the resume position, or an empty string once
+// the last page has been read. Only the current answer is held in memory; it is parsed into arena, which
+// is reset once the page is done. Records are numbered from firstIndex. Returns the number of users
+// printed, or -1 if the cursor is invalid, more than USER_CURSOR_TIES_MAX users share the email at the
+// page boundary, or the query fails.
+static int fetchUsersPage(Session* session, JsonArena* arena, const char* cursor, size_t pageSize, int firstIndex, char* nextCursor, size_t nextCursorSize) {
+    UserCursor position = {0};
+    if (cursor != NULL && !decodeUserCursor(cursor, &position)) {
+        fprintf(stderr, "Invalid user cursor: %s\n", cursor);
+        return -1;
+    }
+    // Resume at the last email and skip the answers with it that were already returned; they sort first
+    // among the answers, so the limit covers them plus a full page.
+    uint64_t skip[USER_CURSOR_TIES_MAX];
+    size_t skipCount = position.tieCount;
+    memcpy(skip, position.ties, skipCount * sizeof(uint64_t));
+    char lastEmail[2 * sizeof(position.email)];
+    escapeTypeQL(position.email, lastEmail, sizeof(lastEmail));
+    char query[768];
+    if (cursor == NULL) snprintf(query, sizeof(query), "match $u isa user, has email $e; fetch $e; $u: full-name, email; sort $e asc; limit %zu;", pageSize);
+    else snprintf(query, sizeof(query), "match $u isa user, has email $e; $e >= '%s'; fetch $e; $u: full-name, email; sort $e asc; limit %zu;", lastEmail, pageSize + skipCount);
+
+    Options* opts = options_new();
+    Transaction* tx = NULL;
+    PROFILE(PHASE_TRANSACTION_NEW, tx = transaction_new(session, Read, opts));
+    if (tx == NULL || FAILED()) {
+        fprintf(stderr, "Failed to start transaction.\n");
+        options_drop(opts);
+        return -1;
+    }
+    StringIterator* queryResult = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, queryResult = query_fetch(tx, query, opts));
+    if (queryResult == NULL || FAILED()) {
+        fprintf(stderr, "Query failed or no results.\n");
+        transaction_close(tx);
+        options_drop(opts);
+        return -1;
+    }
+    int count = 0;
+    char* userJSON = NULL;
+    ProfileDrain drain = {0};
+    while (count < (int)pageSize && (userJSON = profiledStringNext(queryResult, &drain)) != NULL) {
+        cJSON* root = jsonArenaParse(arena, userJSON);
+        const char* email = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(cJSON_GetObjectItemCaseSensitive(root, "e"), "value"));
+        uint64_t hash = hashUserDocument(userJSON);
+        bool returned = false;
+        if (email != NULL && strcmp(email, position.email) == 0) {
+            for (size_t i = 0; i < skipCount && !returned; i++) {
+                if (skip[i] == hash) {
+                    returned = true;
+                    skip[i] = skip[--skipCount];
+                }
+            }
+        }
+        if (email == NULL || strlen(email) >= sizeof(position.email)) {
+            sinkFlush(&STDOUT_SINK);
+            fprintf(stderr, "Failed to read the email of a fetched user.\n");
+            count = -1;
+        } else if (!returned) {
+            SinkField field = { NULL, userJSON, " " };
+            sinkRecord(&STDOUT_SINK, "User", firstIndex + count++, &field, 1);
+            if (strcmp(email, position.email) != 0) {
+                snprintf(position.email, sizeof(position.email), "%s", email);
+                position.tieCount = 0;
+            }
+            if (position.tieCount < USER_CURSOR_TIES_MAX) position.ties[position.tieCount] = hash;
+            position.tieCount++;
+        }
+        string_free(userJSON);
+        if (count < 0) break;
+    }
+    profileDrainEnd(&drain);
+    sinkFlush(&STDOUT_SINK);
+    if (FAILED()) count = -1;
+    nextCursor[0] = '\0';
+    if (count == (int)pageSize && !encodeUserCursor(&position, nextCursor, nextCursorSize)) {
+        fprintf(stderr, "More than %d users share the email %s at a page boundary.\n", USER_CURSOR_TIES_MAX, position.email);
+        count = -1;
+    }
+    jsonArenaReset(arena);
+    string_iterator_drop(queryResult);
+    transaction_close(tx);
+    options_drop(opts);
+    return count;
+}
+
+// Fetches all users page by page, so no read transaction stays open for longer than one page. Returns
+// the number of users printed, or -1 if a page could not be read.
+int fetchAllUsersPaged(DatabaseManager* dbManager, const char* dbName, size_t pageSize) {
+    Options* opts = options_new();
+    Session* session = NULL;
+    PROFILE(PHASE_SESSION_NEW, session = session_new(dbManager, dbName, Data, opts));
+    if (session == NULL || FAILED()) {
+        fprintf(stderr, "Failed to open session.\n");
+        options_drop(opts);
+        return -1;
+    }
+    JsonArena arena = {0};
+    char cursor[USER_CURSOR_SIZE] = "";
+    char nextCursor[USER_CURSOR_SIZE];
+    int total = 0;
+    int count = 0;
+    do {
+        count = fetchUsersPage(session, &arena, cursor[0] ? cursor : NULL, pageSize, total + 1, nextCursor, sizeof(nextCursor));
+        if (count < 0) {
+            fprintf(stderr, "Failed to fetch a page of users.\n");
+            total = -1;
+            break;
+        }
+        total += count;
+        memcpy(cursor, nextCursor, sizeof(cursor));
+    } while (cursor[0] != '\0');
+    jsonArenaFree(&arena);
+    session_close(session);
+    options_drop(opts);
+    return total;
+}
@@ -0,0 +1,8 @@
+#ifndef TUTORIAL_USER_PAGES_H
+#define TUTORIAL_USER_PAGES_H
+
+#include <stddef.h>
+
+int fetchAllUsersPaged(DatabaseManager* dbManager, const char* dbName, size_t pageSize);
+
+#endif
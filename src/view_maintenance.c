@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/typedb_driver.h"
+#include "view_maintenance.h"
+#include "profiling.h"
+#include "write_listeners.h"
+
+#define VIEW_RULE "add-view-permission"
+
+// Joins the rule with the fact in place of each body atom over its relation and adds sign to the count
+// of every conclusion. Atoms before the substituted one skip the fact itself, so a binding that uses
+// the fact several times is counted once. The fact must be present in its relation.
+static void viewMaintainerDerive(ViewMaintainer* vm, DatalogRelation* relation, size_t tuple, int sign) {
+    DatalogJoin join = { .program = &vm->program, .rule = vm->rule };
+    join.excludedRelation = relation;
+    join.excludedTuple = tuple;
+    join.deltaFrom = tuple;
+    join.deltaTo = tuple + 1;
+    for (int a = 0; a < vm->rule->bodyCount; a++) {
+        if (vm->rule->body[a].relation != relation) continue;
+        join.deltaAtom = a;
+        datalogPlan(&join);
+        datalogJoinFrom(&join, 0);
+    }
+    int headArity = vm->rule->head.relation->arity;
+    for (size_t p = 0; p < join.pendingCount; p++) {
+        const uint32_t* conclusion = join.pending + p * headArity;
+        long at = datalogFind(&vm->view, conclusion);
+        if (at < 0) {
+            if (sign < 0) continue; // cannot happen while counts are consistent
+            size_t before = vm->view.count;
+            datalogInsert(&vm->view, conclusion);
+            at = datalogFind(&vm->view, conclusion);
+            if (vm->view.count > before) vm->counts = realloc(vm->counts, vm->view.capacity * sizeof(int64_t));
+            vm->counts[at] = 0;
+        }
+        if (vm->counts[at] == 0 && sign > 0) vm->appeared++;
+        vm->counts[at] += sign;
+        if (vm->counts[at] == 0) {
+            datalogRemove(&vm->view, conclusion);
+            vm->disappeared++;
+        }
+    }
+    free(join.pending);
+}
+
+static size_t viewMaintainerApplyLocked(ViewMaintainer* vm, DatalogRelation* relation, const uint32_t* tuple, bool insert) {
+    size_t before = vm->appeared + vm->disappeared;
+    if (insert) {
+        if (datalogInsert(relation, tuple)) viewMaintainerDerive(vm, relation, (size_t)datalogFind(relation, tuple), 1);
+    } else {
+        long at = datalogFind(relation, tuple);
+        if (at >= 0) {
+            viewMaintainerDerive(vm, relation, (size_t)at, -1);
+            datalogRemove(relation, tuple);
+        }
+    }
+    return vm->appeared + vm->disappeared - before;
+}
+
+// Inserts or deletes one explicit fact and updates the conclusions. Returns how many conclusions
+// appeared or disappeared.
+size_t viewMaintainerApply(ViewMaintainer* vm, DatalogRelation* relation, const uint32_t* tuple, bool insert) {
+    pthread_mutex_lock(&vm->lock);
+    size_t changed = viewMaintainerApplyLocked(vm, relation, tuple, insert);
+    pthread_mutex_unlock(&vm->lock);
+    return changed;
+}
+
+// Builds the symbol tuple of a fact from the IIDs of its things, in column order: for a relation the
+// role players in role-name order followed by the relation's own IID, for an isa the instance. Symbols
+// are created for things the maintainer has not seen yet. Callers hold the lock.
+static void viewMaintainerTupleLocked(ViewMaintainer* vm, const DatalogRelation* relation, const char* const* iids, uint32_t* tuple) {
+    for (int c = 0; c < relation->arity; c++) tuple[c] = datalogSymbol(&vm->program, iids[c]);
+}
+
+// viewMaintainerApply for a fact given by the IIDs of its things, as laid out by viewMaintainerTupleLocked.
+static size_t viewMaintainerApplyIids(ViewMaintainer* vm, DatalogRelation* relation, const char* const* iids, bool insert) {
+    uint32_t tuple[DATALOG_MAX_ARITY];
+    pthread_mutex_lock(&vm->lock);
+    viewMaintainerTupleLocked(vm, relation, iids, tuple);
+    size_t changed = viewMaintainerApplyLocked(vm, relation, tuple, insert);
+    pthread_mutex_unlock(&vm->lock);
+    return changed;
+}
+
+bool viewMaintainerContains(ViewMaintainer* vm, const uint32_t* conclusion) {
+    pthread_mutex_lock(&vm->lock);
+    bool found = datalogFind(&vm->view, conclusion) >= 0;
+    pthread_mutex_unlock(&vm->lock);
+    return found;
+}
+
+static long viewMaintainerObject(ViewMaintainer* vm, const char* path, uint32_t* fact) {
+    fact[1] = datalogValueSymbol(&vm->program, path);
+    DatalogIndex* index = datalogIndex(vm->paths, 2);
+    if (index == NULL || index->buckets == 0) return -1;
+    size_t bucket = datalogHashColumns(fact, 2) & (index->buckets - 1);
+    for (uint32_t t = index->heads[bucket]; t != 0; t = index->next[t - 1]) {
+        const uint32_t* tuple = vm->paths->tuples + (size_t)(t - 1) * 2;
+        if (!vm->paths->removed[t - 1] && tuple[1] == fact[1]) {
+            fact[0] = tuple[0];
+            return (long)(t - 1);
+        }
+    }
+    return -1;
+}
+
+// insertNewUser inserts a person, which is also a user and a subject, with a full-name and an email (an id).
+static const char* VIEW_USER_TYPES[] = { "person", "user", "subject" };
+
+// Adds the new user's isa and has facts to the relations the rule reads, so conclusions that depend on
+// users (or their names and emails) appear without a reload.
+static void viewMaintainerUserInserted(void* context, const char* iid, const char* name, const char* email) {
+    ViewMaintainer* vm = (ViewMaintainer*)context;
+    pthread_mutex_lock(&vm->lock);
+    uint32_t user = datalogSymbol(&vm->program, iid);
+    for (size_t r = 0; r < vm->program.relationCount; r++) {
+        DatalogRelation* relation = vm->program.relations[r];
+        const char* value = NULL;
+        if (relation->kind == DATALOG_ISA) {
+            for (size_t i = 0; i < sizeof(VIEW_USER_TYPES) / sizeof(VIEW_USER_TYPES[0]); i++) {
+                if (strcmp(relation->type, VIEW_USER_TYPES[i]) == 0) viewMaintainerApplyLocked(vm, relation, &user, true);
+            }
+        } else if (relation->kind == DATALOG_HAS && strcmp(relation->type, "full-name") == 0) value = name;
+        else if (relation->kind == DATALOG_HAS && (strcmp(relation->type, "email") == 0 || strcmp(relation->type, "id") == 0)) value = email;
+        if (value != NULL) {
+            uint32_t fact[2] = { user, datalogValueSymbol(&vm->program, value) };
+            viewMaintainerApplyLocked(vm, relation, fact, true);
+        }
+    }
+    pthread_mutex_unlock(&vm->lock);
+}
+
+// Deleting an object removes it from its accesses, so each of them stops matching the rule body.
+static void viewMaintainerFileDeleted(void* context, const char* path) {
+    ViewMaintainer* vm = (ViewMaintainer*)context;
+    uint32_t fact[2];
+    pthread_mutex_lock(&vm->lock);
+    if (viewMaintainerObject(vm, path, fact) >= 0) {
+        datalogRemove(vm->paths, fact);
+        // access columns are [action, object, relation]; tombstoning leaves the index chain intact
+        DatalogIndex* index = vm->access != NULL ? datalogIndex(vm->access, 2) : NULL;
+        uint32_t key[3] = { 0, fact[0], 0 };
+        size_t bucket = index != NULL && index->buckets ? datalogHashColumns(key, 2) & (index->buckets - 1) : 0;
+        for (uint32_t t = index != NULL && index->buckets ? index->heads[bucket] : 0; t != 0; t = index->next[t - 1]) {
+            const uint32_t* tuple = vm->access->tuples + (size_t)(t - 1) * 3;
+            if (vm->access->removed[t - 1] || tuple[1] != fact[0]) continue;
+            uint32_t copy[3] = { tuple[0], tuple[1], tuple[2] };
+            viewMaintainerApplyLocked(vm, vm->access, copy, false);
+        }
+    }
+    pthread_mutex_unlock(&vm->lock);
+}
+
+static void viewMaintainerFilePathUpdated(void* context, const char* oldPath, const char* newPath) {
+    ViewMaintainer* vm = (ViewMaintainer*)context;
+    uint32_t fact[2];
+    pthread_mutex_lock(&vm->lock);
+    if (viewMaintainerObject(vm, oldPath, fact) >= 0) {
+        datalogRemove(vm->paths, fact);
+        fact[1] = datalogValueSymbol(&vm->program, newPath);
+        datalogInsert(vm->paths, fact);
+    }
+    pthread_mutex_unlock(&vm->lock);
+}
+
+// Counts every derivation of the rule over the current explicit facts into an empty view.
+static void viewMaintainerCount(ViewMaintainer* vm, DatalogRelation* view, int64_t** counts) {
+    DatalogJoin join = { .program = &vm->program, .rule = vm->rule, .deltaAtom = -1 };
+    datalogPlan(&join);
+    datalogJoinFrom(&join, 0);
+    int headArity = vm->rule->head.relation->arity;
+    for (size_t p = 0; p < join.pendingCount; p++) {
+        const uint32_t* conclusion = join.pending + p * headArity;
+        size_t before = view->count;
+        datalogInsert(view, conclusion);
+        long at = datalogFind(view, conclusion);
+        if (view->count > before) {
+            *counts = realloc(*counts, view->capacity * sizeof(int64_t));
+            (*counts)[at] = 0;
+        }
+        (*counts)[at]++;
+    }
+    free(join.pending);
+}
+
+// Whether the maintained view and its counts equal a full recount over the current facts.
+static bool viewMaintainerMatchesRecount(ViewMaintainer* vm) {
+    DatalogRelation recount = { .kind = vm->view.kind, .type = vm->view.type, .arity = vm->view.arity };
+    int64_t* counts = NULL;
+    pthread_mutex_lock(&vm->lock);
+    viewMaintainerCount(vm, &recount, &counts);
+    bool matches = true;
+    size_t live = 0;
+    for (size_t t = 0; t < vm->view.count; t++) live += !vm->view.removed[t];
+    matches = live == recount.count;
+    for (size_t t = 0; matches && t < recount.count; t++) {
+        long at = datalogFind(&vm->view, recount.tuples + t * recount.arity);
+        matches = at >= 0 && vm->counts[at] == counts[t];
+    }
+    pthread_mutex_unlock(&vm->lock);
+    free(recount.tuples);
+    free(recount.removed);
+    free(recount.slots);
+    free(counts);
+    return matches;
+}
+
+// Loads the rule and the explicit facts, counts every derivation once, then follows this process's
+// writes. Other changes to access and permission relations are fed in with viewMaintainerApply.
+bool viewMaintainerInit(ViewMaintainer* vm, DatabaseManager* dbManager, const char* dbName, const char* ruleLabel) {
+    memset(vm, 0, sizeof(ViewMaintainer));
+    const char* attributes[] = { "path" };
+    if (!datalogLoad(&vm->program, dbManager, dbName, attributes, 1)) return false;
+    for (size_t i = 0; i < vm->program.ruleCount; i++) {
+        if (strcmp(vm->program.rules[i].label, ruleLabel) == 0) vm->rule = &vm->program.rules[i];
+    }
+    if (vm->rule == NULL) {
+        fprintf(stderr, "Rule %s is not available for view maintenance.\n", ruleLabel);
+        datalogFree(&vm->program);
+        return false;
+    }
+    char* roles[] = { "action", "object" };
+    vm->paths = datalogRelation(&vm->program, DATALOG_HAS, "path", NULL, 0);
+    for (size_t r = 0; r < vm->program.relationCount; r++) {
+        DatalogRelation* relation = vm->program.relations[r];
+        if (relation->kind == DATALOG_RELATION && strcmp(relation->type, "access") == 0 && relation->arity == 3
+            && strcmp(relation->roles[0], roles[0]) == 0 && strcmp(relation->roles[1], roles[1]) == 0) vm->access = relation;
+    }
+    DatalogRelation* head = vm->rule->head.relation;
+    vm->view.kind = head->kind;
+    vm->view.type = head->type;
+    vm->view.arity = head->kind == DATALOG_RELATION ? head->arity - 1 : head->arity;
+    pthread_mutex_init(&vm->lock, NULL);
+    viewMaintainerCount(vm, &vm->view, &vm->counts);
+    addWriteListener((WriteListener){ vm, viewMaintainerUserInserted, viewMaintainerFilePathUpdated, viewMaintainerFileDeleted, NULL });
+    return true;
+}
+
+void viewMaintainerFree(ViewMaintainer* vm) {
+    removeWriteListener(vm);
+    free(vm->view.tuples);
+    free(vm->view.removed);
+    free(vm->view.slots);
+    free(vm->counts);
+    datalogFree(&vm->program);
+    pthread_mutex_destroy(&vm->lock);
+}
+
+// Deletes and re-inserts each explicit permission in turn, comparing the cost of one incremental
+// update with recounting the whole rule.
+void benchmarkViewMaintenance(DatabaseManager* dbManager, const char* dbName, size_t changes) {
+    ViewMaintainer vm;
+    double started = monotonicSeconds();
+    if (!viewMaintainerInit(&vm, dbManager, dbName, VIEW_RULE)) return;
+    double full = monotonicSeconds() - started;
+    DatalogRelation* permissions = vm.rule->head.relation; // add-view-permission also reads permissions
+    size_t applied = 0, affected = 0;
+    const char* iids[DATALOG_MAX_ARITY];
+    started = monotonicSeconds();
+    for (size_t t = 0; t < permissions->count && applied < changes; t++) {
+        // Changes arrive as IIDs, like those read from a committed write.
+        const uint32_t* tuple = permissions->tuples + t * permissions->arity;
+        for (int c = 0; c < permissions->arity; c++) iids[c] = vm.program.names[tuple[c]];
+        affected += viewMaintainerApplyIids(&vm, permissions, iids, false);
+        affected += viewMaintainerApplyIids(&vm, permissions, iids, true);
+        applied += 2;
+    }
+    double incremental = monotonicSeconds() - started;
+    printf("View maintenance benchmark: %zu conclusions, %.3f ms to load and count, %.3f us per change (%zu changes, %zu conclusions affected)\n",
+           vm.view.count, full * 1e3, applied ? incremental / applied * 1e6 : 0.0, applied, affected);
+    if (!viewMaintainerMatchesRecount(&vm)) fprintf(stderr, "Error: the maintained view differs from a full recount.\n");
+    viewMaintainerFree(&vm);
+}
@@ -0,0 +1,33 @@
+#ifndef TUTORIAL_VIEW_MAINTENANCE_H
+#define TUTORIAL_VIEW_MAINTENANCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "datalog.h"
+
+// Keeps the conclusions of one rule up to date under single-fact changes by counting derivations: each
+// concluded tuple carries the number of body bindings over explicit facts that produce it, and a change
+// only joins the rule with the changed fact in place of each matching body atom. Counts are exact when
+// the rule's conclusions do not feed back into its own body, as with add-view-permission, whose
+// conclusions are on view accesses while its body reads permissions on modify accesses.
+typedef struct {
+    DatalogProgram program; // explicit facts only
+    DatalogRule* rule;
+    DatalogRelation view;   // concluded tuples (without a relation id), tombstoned when the count drops to 0
+    int64_t* counts;
+    DatalogRelation* paths; // has path facts, to resolve the objects named in write notifications
+    DatalogRelation* access;
+    pthread_mutex_t lock;
+    size_t appeared;
+    size_t disappeared;
+} ViewMaintainer;
+
+size_t viewMaintainerApply(ViewMaintainer* vm, DatalogRelation* relation, const uint32_t* tuple, bool insert);
+bool viewMaintainerContains(ViewMaintainer* vm, const uint32_t* conclusion);
+bool viewMaintainerInit(ViewMaintainer* vm, DatabaseManager* dbManager, const char* dbName, const char* ruleLabel);
+void viewMaintainerFree(ViewMaintainer* vm);
+void benchmarkViewMaintenance(DatabaseManager* dbManager, const char* dbName, size_t changes);
+
+#endif
@@ -0,0 +1,46 @@
+#include "../include/typedb_driver.h"
+#include "write_listeners.h"
+
+#define MAX_WRITE_LISTENERS 8
+
+static WriteListener WRITE_LISTENERS[MAX_WRITE_LISTENERS];
+static size_t WRITE_LISTENER_COUNT = 0;
+
+// Not thread-safe: register listeners before starting concurrent writers.
+bool addWriteListener(WriteListener listener) {
+    if (WRITE_LISTENER_COUNT == MAX_WRITE_LISTENERS) return false;
+    WRITE_LISTENERS[WRITE_LISTENER_COUNT++] = listener;
+    return true;
+}
+
+void removeWriteListener(void* context) {
+    for (size_t i = 0; i < WRITE_LISTENER_COUNT; i++) {
+        if (WRITE_LISTENERS[i].context != context) continue;
+        WRITE_LISTENERS[i] = WRITE_LISTENERS[--WRITE_LISTENER_COUNT];
+        return;
+    }
+}
+
+void notifyUserInserted(const char* iid, const char* name, const char* email) {
+    for (size_t i = 0; i < WRITE_LISTENER_COUNT; i++) {
+        if (WRITE_LISTENERS[i].userInserted) WRITE_LISTENERS[i].userInserted(WRITE_LISTENERS[i].context, iid, name, email);
+    }
+}
+
+void notifyFilePathUpdated(const char* oldPath, const char* newPath) {
+    for (size_t i = 0; i < WRITE_LISTENER_COUNT; i++) {
+        if (WRITE_LISTENERS[i].filePathUpdated) WRITE_LISTENERS[i].filePathUpdated(WRITE_LISTENERS[i].context, oldPath, newPath);
+    }
+}
+
+void notifyFileDeleted(const char* path) {
+    for (size_t i = 0; i < WRITE_LISTENER_COUNT; i++) {
+        if (WRITE_LISTENERS[i].fileDeleted) WRITE_LISTENERS[i].fileDeleted(WRITE_LISTENERS[i].context, path);
+    }
+}
+
+void notifyPermissionReviewScheduled(const char* iid, int64_t reviewMillis) {
+    for (size_t i = 0; i < WRITE_LISTENER_COUNT; i++) {
+        if (WRITE_LISTENERS[i].permissionReviewScheduled) WRITE_LISTENERS[i].permissionReviewScheduled(WRITE_LISTENERS[i].context, iid, reviewMillis);
+    }
+}
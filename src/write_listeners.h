@@ -0,0 +1,24 @@
+#ifndef TUTORIAL_WRITE_LISTENERS_H
+#define TUTORIAL_WRITE_LISTENERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Local caches subscribe to the writes this process commits. Callbacks run on the committing thread,
+// after the commit has succeeded, and must do their own locking.
+typedef struct {
+    void* context;
+    void (*userInserted)(void* context, const char* iid, const char* name, const char* email);
+    void (*filePathUpdated)(void* context, const char* oldPath, const char* newPath);
+    void (*fileDeleted)(void* context, const char* path);
+    void (*permissionReviewScheduled)(void* context, const char* iid, int64_t reviewMillis);
+} WriteListener;
+
+bool addWriteListener(WriteListener listener);
+void removeWriteListener(void* context);
+void notifyUserInserted(const char* iid, const char* name, const char* email);
+void notifyFilePathUpdated(const char* oldPath, const char* newPath);
+void notifyFileDeleted(const char* path);
+void notifyPermissionReviewScheduled(const char* iid, int64_t reviewMillis);
+
+#endif
@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include <string.h>
+#include "../include/typedb_driver.h"
+#include "../src/typeql_escape.h"
+
+static int failures = 0;
+
+static void expectRegex(bool (*escape)(const char*, char*, size_t), const char* input, size_t size, const char* expected) {
+    char out[512];
+    bool ok = escape(input, out, size);
+    if (expected == NULL ? ok : !ok || strcmp(out, expected) != 0) {
+        fprintf(stderr, "%s: expected %s, got %s\n", input, expected != NULL ? expected : "a rejection", ok ? out : "a rejection");
+        failures++;
+    }
+}
+
+// Checks the regexes put into `like` strings: escaped once, in the form TypeQL hands to the regex engine.
+int main(void) {
+    expectRegex(prefixToTypeQLRegex, "src/a.b/", 512, "^src/a\\.b/.*");
+    expectRegex(prefixToTypeQLRegex, "budget_(2022)", 512, "^budget_\\(2022\\).*");
+    expectRegex(prefixToTypeQLRegex, "it's\\", 512, "^it\\'s\\\\.*");
+    expectRegex(prefixToTypeQLRegex, "src/", 8, "^src/.*");
+    expectRegex(prefixToTypeQLRegex, "src/", 7, NULL);
+    expectRegex(escapeTypeQLRegex, ".*\\.java", 512, ".*\\.java");
+    expectRegex(escapeTypeQLRegex, "it's|it\\'s", 512, "it\\'s|it\\'s");
+    expectRegex(escapeTypeQLRegex, "trailing\\", 512, NULL);
+    expectRegex(escapeTypeQLRegex, "abcdef", 6, NULL);
+    if (failures == 0) printf("All regex escaping checks passed.\n");
+    return failures == 0 ? 0 : 1;
+}
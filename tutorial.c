@@ -3,7 +3,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "include/typedb_driver.h"
+#include "src/tutorial.h"
+#include "src/profiling.h"
+#include "src/prefetch_tuning.h"
+#include "src/query_pipeline.h"
+#include "src/output_sink.h"
+#include "src/retry.h"
+#include "src/write_listeners.h"
+#ifdef TUTORIAL_EXTENSIONS
+#include "src/fetch_decoder.h"
+#include "src/json_index.h"
+#include "src/json_arena.h"
+#include "src/user_pages.h"
+#include "src/bulk_rename.h"
+#include "src/bulk_delete.h"
+#include "src/export.h"
+#include "src/permission_index.h"
+#include "src/materialize.h"
+#include "src/access_bitmaps.h"
+#include "src/datalog.h"
+#include "src/view_maintenance.h"
+#include "src/membership_closure.h"
+#include "src/segregation_scan.h"
+#include "src/review_expiry.h"
+#include "src/path_trie.h"
+#include "src/iid_cache.h"
+#include "src/executor.h"
+#include "src/group_commit.h"
+#endif
 // end::import[]
 // tag::constants[]
 #define SERVER_ADDR "127.0.0.1:1729"
@@ -14,15 +43,21 @@
 
 typedef enum { CORE, CLOUD } edition;
 edition TYPEDB_EDITION = CORE;
+bool RUN_EXTENSIONS = false;
+bool RUN_BENCHMARKS = false;
+bool PROFILE_QUERIES = false;
 // end::constants[]
 // tag::error_handling[]
+// Both flush the results buffered in STDOUT_SINK first, so a diagnostic never comes out ahead of them.
 void handle_error(const char* message) {
+    sinkFlush(&STDOUT_SINK);
     fprintf(stderr, "%s\n", message);
     exit(EXIT_FAILURE);
 }
 
 bool check_error_may_print(const char* filename, int lineno) {
     if (check_error()) {
+        sinkFlush(&STDOUT_SINK);
         Error* error = get_last_error();
         char* errcode = error_code(error);
         char* errmsg = error_message(error);
@@ -34,17 +69,27 @@ bool check_error_may_print(const char* filename, int lineno) {
     } else return false;
 }
 // end::error_handling[]
+// tag::read-query-file[]
+// Reads a whole query file into a buffer sized from the file's length, to be freed by the caller.
+char* readQueryFile(const char* path, const char* error) {
+    FILE* file = fopen(path, "rb");
+    if (!file) handle_error(error);
+    if (fseek(file, 0, SEEK_END) != 0) handle_error(error);
+    long size = ftell(file);
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) handle_error(error);
+    char* query = malloc((size_t)size + 1);
+    size_t read = fread(query, 1, (size_t)size, file);
+    fclose(file);
+    if (read != (size_t)size) handle_error(error);
+    query[read] = '\0';
+    return query;
+}
+// end::read-query-file[]
 // tag::db-schema-setup[]
 void dbSchemaSetup(Session* schemaSession, const char* schemaFile) {
     Transaction* tx = NULL;
     Options* opts = options_new();
-    char defineQuery[4096] = {0};
-    FILE* file = fopen(schemaFile, "r");
-    if (FAILED()) goto cleanup;
-    if (!file) handle_error("Failed to open schema file.");
-    char line[512];
-    while (fgets(line, sizeof(line), file)) strcat(defineQuery, line);
-    fclose(file);
+    char* defineQuery = readQueryFile(schemaFile, "Failed to open schema file.");
 
     tx = transaction_new(schemaSession, Write, opts);
     if (tx == NULL || FAILED()) {
@@ -64,6 +109,7 @@ void dbSchemaSetup(Session* schemaSession, const char* schemaFile) {
     printf("Schema setup complete.\n");
 cleanup:
     // transaction_close(tx);
+    free(defineQuery);
     options_drop(opts);
 }
 // end::db-schema-setup[]
@@ -72,14 +118,8 @@ void dbDatasetSetup(Session* dataSession, const char* dataFile) {
     bool result = false;
     Transaction* tx = NULL;
     Options* opts = options_new();
-    char insertQuery[4096] = {0};
-    FILE* file = fopen(dataFile, "r");
-    if (!file) handle_error("Failed to open data file.");
+    char* insertQuery = readQueryFile(dataFile, "Failed to open data file.");
 
-    char line[512];
-    while (fgets(line, sizeof(line), file)) strcat(insertQuery, line);
-    fclose(file);
-    
     tx = transaction_new(dataSession, Write, opts);
     if (tx == NULL || FAILED()) {
         handle_error("Transaction failed to start.");
@@ -100,6 +140,7 @@ void dbDatasetSetup(Session* dataSession, const char* dataFile) {
 cleanup:
     concept_map_iterator_drop(insertResult);
     // transaction_close(tx);
+    free(insertQuery);
     options_drop(opts);
 }
 // end::db-dataset-setup[]
@@ -248,12 +289,13 @@ int fetchAllUsers(DatabaseManager* dbManager, const char* dbName) {
     Options* opts = options_new();
     Transaction* tx = NULL;
     StringIterator* queryResult = NULL;
-    Session* session = session_new(dbManager, dbName, Data, opts);
+    Session* session = NULL;
+    PROFILE(PHASE_SESSION_NEW, session = session_new(dbManager, dbName, Data, opts));
     if (session == NULL || FAILED()) {
         fprintf(stderr, "Failed to open session.\n");
         exit(EXIT_FAILURE);
     }
-    tx = transaction_new(session, Read, opts);
+    PROFILE(PHASE_TRANSACTION_NEW, tx = transaction_new(session, Read, opts));
     if (tx == NULL || FAILED()) {
         fprintf(stderr, "Failed to start transaction.\n");
         session_close(session);
@@ -261,7 +303,8 @@ int fetchAllUsers(DatabaseManager* dbManager, const char* dbName) {
     }
 
     const char* query = "match $u isa user; fetch $u: full-name, email;";
-    queryResult = query_fetch(tx, query, opts);
+    prefetchTunerApply(&PREFETCH_TUNER, "fetchAllUsers", opts);
+    PROFILE(PHASE_QUERY_DISPATCH, queryResult = query_fetch(tx, query, opts));
     if (queryResult == NULL || FAILED()) {
         fprintf(stderr, "Query failed or no results.\n");
         transaction_close(tx);
@@ -269,13 +312,19 @@ int fetchAllUsers(DatabaseManager* dbManager, const char* dbName) {
         exit(EXIT_FAILURE);
     }
 
-    char* userJSON = string_iterator_next(queryResult);
+    ProfileDrain drain = {0};
+    char* userJSON = profiledStringNext(queryResult, &drain);
+    double firstAnswer = monotonicSeconds();
     int counter = 1;
     while (userJSON != NULL) {
-        printf("User #%d: ", counter++);
-        printf("%s \n",userJSON);
-        userJSON = string_iterator_next(queryResult);
-    }
+        SinkField field = { NULL, userJSON, " " };
+        sinkRecord(&STDOUT_SINK, "User", counter++, &field, 1);
+        string_free(userJSON);
+        userJSON = profiledStringNext(queryResult, &drain);
+    }
+    profileDrainEnd(&drain);
+    sinkFlush(&STDOUT_SINK);
+    prefetchTunerRecord(&PREFETCH_TUNER, "fetchAllUsers", counter - 1, monotonicSeconds() - firstAnswer);
 cleanup:
     string_iterator_drop(queryResult);
     transaction_close(tx);
@@ -291,13 +340,13 @@ int insertNewUser(DatabaseManager* dbManager, const char* dbName, const char* na
     ConceptMapIterator* response = NULL;
     ConceptMap* conceptMap = NULL;
 
-    session = session_new(dbManager, dbName, Data, opts);
+    PROFILE(PHASE_SESSION_NEW, session = session_new(dbManager, dbName, Data, opts));
     if (session == NULL || FAILED()) {
         fprintf(stderr, "Failed to open session.\n");
         exit(EXIT_FAILURE);
     }
 
-    tx = transaction_new(session, Write, opts);
+    PROFILE(PHASE_TRANSACTION_NEW, tx = transaction_new(session, Write, opts));
     if (tx == NULL || FAILED()) {
         fprintf(stderr, "Failed to start transaction.\n");
         session_close(session);
@@ -306,7 +355,7 @@ int insertNewUser(DatabaseManager* dbManager, const char* dbName, const char* na
 
     char query[512];
     snprintf(query, sizeof(query), "insert $p isa person, has full-name $fn, has email $e; $fn == '%s'; $e == '%s';", name, email);
-    response = query_insert(tx, query, opts);
+    PROFILE(PHASE_QUERY_DISPATCH, response = query_insert(tx, query, opts));
     if (response == NULL || FAILED()) {
         fprintf(stderr, "Failed to execute insert query.\n");
         transaction_close(tx);
@@ -315,19 +364,31 @@ int insertNewUser(DatabaseManager* dbManager, const char* dbName, const char* na
     }
 
     int insertedCount = 0;
-    while ((conceptMap = concept_map_iterator_next(response)) != NULL) {
+    char* iid = NULL;
+    ProfileDrain drain = {0};
+    while ((conceptMap = profiledConceptMapNext(response, &drain)) != NULL) {
+        if (iid == NULL) {
+            Concept* userConcept = concept_map_get(conceptMap, "p");
+            iid = thing_get_iid(userConcept);
+            concept_drop(userConcept);
+        }
         Concept* fnConcept = concept_map_get(conceptMap, "fn");
         Concept* eConcept = concept_map_get(conceptMap, "e");
         const char* fullName = value_get_string(attribute_get_value(fnConcept));
         const char* userEmail = value_get_string(attribute_get_value(eConcept));
-        printf("Added new user. Name: %s, E-mail: %s\n", fullName, userEmail);
+        SinkField fields[] = { { "Name", fullName, NULL }, { "E-mail", userEmail, NULL } };
+        sinkRecord(&STDOUT_SINK, "Added new user.", 0, fields, 2);
         concept_drop(fnConcept);
         concept_drop(eConcept);
         concept_map_drop(conceptMap);
         insertedCount++;
     }
+    profileDrainEnd(&drain);
+    sinkFlush(&STDOUT_SINK);
     concept_map_iterator_drop(response);
-    void_promise_resolve(transaction_commit(tx));
+    PROFILE(PHASE_COMMIT, void_promise_resolve(transaction_commit(tx)));
+    if (!FAILED() && insertedCount > 0 && iid != NULL) notifyUserInserted(iid, name, email);
+    if (iid != NULL) string_free(iid);
     session_close(session);
     return insertedCount;
 }
@@ -336,12 +397,10 @@ int insertNewUser(DatabaseManager* dbManager, const char* dbName, const char* na
 int getFilesByUser(DatabaseManager* dbManager, const char* dbName, const char* name, bool inference) {
     Transaction* tx = NULL;
     Session* session = NULL;
-    ConceptMapIterator* userResult = NULL;
-    ConceptMapIterator* response = NULL;
     ConceptMap* cm = NULL;
     Options* opts = options_new();
 
-    session = session_new(dbManager, dbName, Data, opts);
+    PROFILE(PHASE_SESSION_NEW, session = session_new(dbManager, dbName, Data, opts));
     if (session == NULL || FAILED()) {
         fprintf(stderr, "Failed to open session.\n");
         options_drop(opts);
@@ -349,7 +408,7 @@ int getFilesByUser(DatabaseManager* dbManager, const char* dbName, const char* n
     }
 
     options_set_infer(opts, inference);
-    tx = transaction_new(session, Read, opts);
+    PROFILE(PHASE_TRANSACTION_NEW, tx = transaction_new(session, Read, opts));
     if (tx == NULL || FAILED()) {
         fprintf(stderr, "Failed to start transaction.\n");
         options_drop(opts);
@@ -357,33 +416,55 @@ int getFilesByUser(DatabaseManager* dbManager, const char* dbName, const char* n
         exit(EXIT_FAILURE);
     }
 
-    char query[512];
-    snprintf(query, sizeof(query), "match $u isa user, has full-name '%s'; get;", name);
-    userResult = query_get(tx, query, options_new());
+    char userQuery[512];
+    char filesQuery[512];
+    snprintf(userQuery, sizeof(userQuery), "match $u isa user, has full-name '%s'; get;", name);
+    snprintf(filesQuery, sizeof(filesQuery), "match $fn == '%s'; $u isa user, has full-name $fn; $p($u, $pa) isa permission; $o isa object, has path $fp; $pa($o, $va) isa access;$va isa action, has name 'view_file'; get $fp; sort $fp asc;", name);
+    // Without inference the file lookup is cheap, so it is sent with the user check and overlaps it. With
+    // inference it waits for the check, so an unknown or ambiguous name does not pay for reasoning.
+    const char* shape = inference ? "getFilesByUser/infer" : "getFilesByUser";
+    prefetchTunerApply(&PREFETCH_TUNER, shape, opts);
+    QueryPipeline* pipeline = pipelineNew(tx, opts);
+    PendingQuery* users = NULL;
+    PendingQuery* files = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, {
+        users = pipelineGet(pipeline, userQuery, NULL, NULL);
+        if (!inference) files = pipelineGet(pipeline, filesQuery, NULL, NULL);
+        pipelineAwaitAll(pipeline);
+    });
     int userCount = 0;
-    while (concept_map_iterator_next(userResult) != NULL) { userCount++; }
-    concept_map_iterator_drop(userResult);
+    ProfileDrain drain = {0};
+    while (!users->failed && (cm = profiledConceptMapNext(users->handle.conceptMaps, &drain)) != NULL) {
+        concept_map_drop(cm);
+        userCount++;
+    }
+    profileDrainEnd(&drain);
 
     if (userCount > 1) {
         fprintf(stderr, "Error: Found more than one user with that name.\n");
     } else if (userCount == 1) {
-        snprintf(query, sizeof(query), "match $fn == '%s'; $u isa user, has full-name $fn; $p($u, $pa) isa permission; $o isa object, has path $fp; $pa($o, $va) isa access;$va isa action, has name 'view_file'; get $fp; sort $fp asc;", name);
-        response = query_get(tx, query, options_new());
         int fileCount = 0;
-        while ((cm = concept_map_iterator_next(response)) != NULL) {
+        double firstAnswer = 0;
+        if (files == NULL) PROFILE(PHASE_QUERY_DISPATCH, pipelineResolve(files = pipelineGet(pipeline, filesQuery, NULL, NULL)));
+        while (!files->failed && (cm = profiledConceptMapNext(files->handle.conceptMaps, &drain)) != NULL) {
             Concept* filePathConcept = concept_map_get(cm, "fp");
             const char* filePath = value_get_string(attribute_get_value(filePathConcept));
-            printf("File #%d: %s\n", ++fileCount, filePath);
+            SinkField field = { NULL, filePath, NULL };
+            if (++fileCount == 1) firstAnswer = monotonicSeconds();
+            sinkRecord(&STDOUT_SINK, "File", fileCount, &field, 1);
             concept_drop(filePathConcept);
             concept_map_drop(cm);
         }
-        concept_map_iterator_drop(response);
+        profileDrainEnd(&drain);
+        prefetchTunerRecord(&PREFETCH_TUNER, shape, fileCount, fileCount > 0 ? monotonicSeconds() - firstAnswer : 0);
         if (fileCount == 0) {
-            printf("No files found. Try enabling inference.\n");
+            sinkPrintf(&STDOUT_SINK, "No files found. Try enabling inference.\n");
         }
     } else {
         fprintf(stderr, "Error: No users found with that name.\n");
     }
+    sinkFlush(&STDOUT_SINK);
+    pipelineDrop(pipeline);
 
     transaction_close(tx);
     options_drop(opts);
@@ -392,104 +473,113 @@ int getFilesByUser(DatabaseManager* dbManager, const char* dbName, const char* n
 }
 // end::get[]
 // tag::update[]
+typedef struct {
+    const char* oldPath;
+    const char* newPath;
+} UpdatePathArgs;
+
+long updateFilePathOperation(Transaction* tx, Options* opts, void* context, bool* commit) {
+    UpdatePathArgs* args = (UpdatePathArgs*)context;
+    char query[512];
+    snprintf(query, sizeof(query), "match $f isa file, has path $old_path; $old_path = '%s'; delete $f has $old_path; insert $f has path $new_path; $new_path = '%s';", args->oldPath, args->newPath);
+    ConceptMapIterator* response = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, response = query_update(tx, query, opts));
+    if (response == NULL || check_error()) return -1;
+    long count = 0;
+    ConceptMap* conceptMap = NULL;
+    ProfileDrain drain = {0};
+    while ((conceptMap = profiledConceptMapNext(response, &drain)) != NULL) {
+        concept_map_drop(conceptMap);
+        count++;
+    }
+    profileDrainEnd(&drain);
+    concept_map_iterator_drop(response);
+    *commit = count > 0;
+    return check_error() ? -1 : count;
+}
+
 int16_t updateFilePath(DatabaseManager* dbManager, const char* dbName, const char* oldPath, const char* newPath) {
-    Transaction* tx = NULL;
     Session* session = NULL;
     Options* opts = options_new();
-    ConceptMapIterator* response = NULL;
-    session = session_new(dbManager, dbName, Data, opts);
+    PROFILE(PHASE_SESSION_NEW, session = session_new(dbManager, dbName, Data, opts));
     if (session == NULL || FAILED()) {
         fprintf(stderr, "Failed to open session.\n");
         exit(EXIT_FAILURE);
     }
 
-    tx = transaction_new(session, Write, opts);
-    if (tx == NULL || FAILED()) {
-        fprintf(stderr, "Failed to start transaction.\n");
-        session_close(session);
-        exit(EXIT_FAILURE);
-    }
-
-    char query[512];
-    snprintf(query, sizeof(query), "match $f isa file, has path $old_path; $old_path = '%s'; delete $f has $old_path; insert $f has path $new_path; $new_path = '%s';", oldPath, newPath);
-
-    response = query_update(tx, query, opts);
-    if (response == NULL || FAILED()) {
-        fprintf(stderr, "Query failed or no results.\n");
-        transaction_close(tx);
-        session_close(session);
-        exit(EXIT_FAILURE);
+    UpdatePathArgs args = { oldPath, newPath };
+    long count = runWithRetry(session, "updateFilePath", updateFilePathOperation, &args, &DEFAULT_RETRY_POLICY);
+    if (count < 0) {
+        fprintf(stderr, "Failed to update the file path.\n");
+        count = 0;
+    } else if (count > 0) {
+        notifyFilePathUpdated(oldPath, newPath);
+        sinkPrintf(&STDOUT_SINK, "Total number of paths updated: %ld.\n", count);
+    } else {
+        sinkPrintf(&STDOUT_SINK, "No matched paths: nothing to update.\n");
     }
+    sinkFlush(&STDOUT_SINK);
 
-    int16_t count = 0;
-    while (concept_map_iterator_next(response) != NULL) {
+    session_close(session);
+    options_drop(opts);
+    return (int16_t)count;
+}
+// end::update[]
+// tag::delete[]
+// Deletes the file only when exactly one file has the path, and returns how many matched.
+long deleteFileOperation(Transaction* tx, Options* opts, void* context, bool* commit) {
+    const char* path = (const char*)context;
+    char query[256];
+    snprintf(query, sizeof(query), "match $f isa file, has path '%s'; get;", path);
+    ConceptMapIterator* response = NULL;
+    PROFILE(PHASE_QUERY_DISPATCH, response = query_get(tx, query, opts));
+    if (response == NULL || check_error()) return -1;
+    long count = 0;
+    ConceptMap* conceptMap = NULL;
+    ProfileDrain drain = {0};
+    while ((conceptMap = profiledConceptMapNext(response, &drain)) != NULL) {
+        concept_map_drop(conceptMap);
         count++;
     }
+    profileDrainEnd(&drain);
     concept_map_iterator_drop(response);
+    if (check_error()) return -1;
 
-    if (count > 0) {
-        void_promise_resolve(transaction_commit(tx));
-        printf("Total number of paths updated: %d.\n", count);
-    } else {
-        printf("No matched paths: nothing to update.\n");
+    if (count == 1) {
+        snprintf(query, sizeof(query), "match $f isa file, has path '%s'; delete $f isa file;", path);
+        VoidPromise* promise = NULL;
+        PROFILE(PHASE_QUERY_DISPATCH, promise = query_delete(tx, query, opts));
+        if (promise == NULL || check_error()) return -1;
+        PROFILE(PHASE_QUERY_DISPATCH, void_promise_resolve(promise));
+        if (check_error()) return -1;
     }
-
-    session_close(session);
+    *commit = count == 1;
     return count;
 }
-// end::update[]
-// tag::delete[]
+
 bool deleteFile(DatabaseManager* dbManager, const char* dbName, const char* path) {
     bool result = false;
-    Transaction* tx = NULL;
     Session* session = NULL;
     Options* opts = options_new();
-    ConceptMapIterator* response = NULL;
 
-    session = session_new(dbManager, dbName, Data, opts);
+    PROFILE(PHASE_SESSION_NEW, session = session_new(dbManager, dbName, Data, opts));
     if (session == NULL || FAILED()) {
         fprintf(stderr, "Failed to open session.\n");
         exit(EXIT_FAILURE);
     }
 
-    tx = transaction_new(session, Write, opts);
-    if (tx == NULL || FAILED()) {
-        fprintf(stderr, "Failed to start transaction.\n");
-        session_close(session);
-        exit(EXIT_FAILURE);
-    }
-
-    char query[256];
-    snprintf(query, sizeof(query), "match $f isa file, has path '%s'; get;", path);
-    response = query_get(tx, query, opts);
-    if (response == NULL || FAILED()) {
-        fprintf(stderr, "Query failed or no results.\n");
-        transaction_close(tx);
-        session_close(session);
-        exit(EXIT_FAILURE);
-    }
-
-    int16_t count = 0;
-    while (concept_map_iterator_next(response) != NULL) {
-        count++;
-    }
-    concept_map_iterator_drop(response);
-
-    if (count == 1) { // Delete the file if exactly one was found
-        snprintf(query, sizeof(query), "match $f isa file, has path '%s'; delete $f isa file;", path);
-        if (query_delete(tx, query, opts) == NULL || FAILED()) {
-            fprintf(stderr, "Failed to delete file.\n");
-            transaction_close(tx);
-            session_close(session);
-            exit(EXIT_FAILURE);
-        }
-        void_promise_resolve(transaction_commit(tx));
-        printf("The file has been deleted.\n");
+    long count = runWithRetry(session, "deleteFile", deleteFileOperation, (void*)path, &DEFAULT_RETRY_POLICY);
+    if (count == 1) {
+        notifyFileDeleted(path);
+        sinkPrintf(&STDOUT_SINK, "The file has been deleted.\n");
+        sinkFlush(&STDOUT_SINK);
         result = true;
     } else if (count > 1) fprintf(stderr, "Matched more than one file with the same path.\nNo files were deleted.\n");
-    else fprintf(stderr, "No files matched in the database.\nNo files were deleted.\n");
+    else if (count == 0) fprintf(stderr, "No files matched in the database.\nNo files were deleted.\n");
+    else fprintf(stderr, "Failed to delete file.\n");
 
     session_close(session);
+    options_drop(opts);
     return result;
 }
 // end::delete[]
@@ -541,11 +631,168 @@ bool queries(DatabaseManager* dbManager, const char* dbName) {
     return true;
 }
 // end::queries[]
+// tag::extensions[]
+#ifdef TUTORIAL_EXTENSIONS
+// Puts Kevin Morrison in the Developer role, and the role in the Engineering business unit. Returns
+// Kevin Morrison's IID, to be freed with string_free, or NULL if the insert failed.
+char* insertExampleMemberships(DatabaseManager* dbManager, const char* dbName) {
+    Options* opts = options_new();
+    Session* session = session_new(dbManager, dbName, Data, opts);
+    if (session == NULL || FAILED()) {
+        options_drop(opts);
+        return NULL;
+    }
+    Transaction* tx = transaction_new(session, Write, opts);
+    char* iid = NULL;
+    if (tx != NULL && !FAILED()) {
+        const char* query = "match $p isa person, has email 'kevin.morrison@typedb.com'; "
+            "insert $r isa user-role, has name 'Developer'; $u isa business-unit, has name 'Engineering'; "
+            "(member: $p, group: $r) isa group-membership; (member: $r, group: $u) isa group-membership;";
+        ConceptMapIterator* response = query_insert(tx, query, opts);
+        ConceptMap* cm = response != NULL && !FAILED() ? concept_map_iterator_next(response) : NULL;
+        if (cm != NULL) {
+            iid = conceptMapIid(cm, "p");
+            concept_map_drop(cm);
+        }
+        concept_map_iterator_drop(response);
+        if (iid != NULL && !FAILED()) {
+            void_promise_resolve(transaction_commit(tx));
+            if (FAILED()) {
+                string_free(iid);
+                iid = NULL;
+            }
+        } else transaction_close(tx);
+    }
+    session_close(session);
+    options_drop(opts);
+    return iid;
+}
+
+// Runs the extension modules against the sample data after the six requests above; start the tutorial
+// with --extensions to include this step.
+bool extensions(DatabaseManager* dbManager, const char* dbName) {
+    printf("\nExtension: Rename files in bulk: a chain of renames, a rename onto a path freed by another chain, an unknown path and a malformed line\n");
+    const char mapping[] = "zewhb.java\tsrc/zewhb.java\n"
+        "src/zewhb.java\tsrc/main/zewhb.java\n"
+        "LICENSE\tLICENSE.txt\n"
+        "src/main/zewhb.java\tLICENSE\n"
+        "missing.java\tsrc/missing.java\n"
+        "README.md LICENSE\n";
+    FILE* stream = fmemopen((void*)mapping, strlen(mapping), "r");
+    BulkRenameStats renames = bulkRenameFilePaths(dbManager, dbName, stream, 2, 2);
+    fclose(stream);
+    if (renames.renamed != 4 || renames.unmatched != 1 || renames.failed != 0) return false;
+
+    printf("\nExtension: Delete files in bulk by path prefix\n");
+    BulkDeleteStats deletes = bulkDeleteFiles(dbManager, dbName, "budget_", true, 100, 10, 2);
+    if (deletes.deleted != 2 || deletes.failed != 0) return false;
+
+    printf("\nExtension: Export file paths to CSV and users to NDJSON\n");
+    const char* pathVars[] = {"p"};
+    size_t exportedPaths = exportQueryGet(dbManager, dbName, "match $f isa file, has path $p; get $p; sort $p;", pathVars, 1, false, "tutorial-files.csv", EXPORT_CSV, 2);
+    size_t exportedUsers = exportQueryFetch(dbManager, dbName, "match $u isa user; fetch $u: full-name, email;", "tutorial-users.ndjson");
+    if (exportedPaths == EXPORT_FAILED || exportedUsers == EXPORT_FAILED) return false;
+
+    printf("\nExtension: Fetch all users two at a time, resuming from a cursor after each page\n");
+    if (fetchAllUsersPaged(dbManager, dbName, 2) < 0) return false;
+
+    printf("\nExtension: Find the files Kevin Morrison can view (with inference) from a local permission index\n");
+    PermissionIndex* permissions = permissionIndexBuild(dbManager, dbName, true);
+    if (permissions == NULL) return false;
+    getFilesByUserIndexed(dbManager, dbName, permissions, "Kevin Morrison");
+    permissionIndexFree(permissions);
+
+    printf("\nExtension: Find the groups Kevin Morrison belongs to, directly or through other groups, from the membership closure\n");
+    char* kevin = insertExampleMemberships(dbManager, dbName);
+    if (kevin == NULL) return false;
+    MembershipGraph memberships;
+    long groups = -1;
+    if (membershipGraphLoad(&memberships, dbManager, dbName)) {
+        groups = membershipEffectiveGroups(&memberships, kevin, NULL, NULL);
+        printf("Kevin Morrison belongs to %ld groups.\n", groups);
+        membershipGraphFree(&memberships);
+    }
+    string_free(kevin);
+    if (groups < 2) return false;
+
+    printf("\nExtension: Scan every subject's permissions, with inference, for segregation-of-duty violations\n");
+    SegregationStats segregation = scanSegregationViolations(dbManager, dbName, true, 2);
+    if (segregation.error || segregation.failed != 0) return false;
+
+    printf("\nExtension: Schedule reviews of Kevin Morrison's permissions for yesterday, then expire the overdue ones\n");
+    ReviewIndex reviews;
+    if (!reviewIndexLoad(&reviews, dbManager, dbName)) {
+        reviewIndexFree(&reviews);
+        return false;
+    }
+    int64_t now = (int64_t)time(NULL) * 1000;
+    long scheduled = schedulePermissionReviews(dbManager, dbName, "kevin.morrison@typedb.com", now - 24 * 3600 * 1000);
+    long expired = scheduled > 0 ? expireOverduePermissions(&reviews, dbManager, dbName, now) : -1;
+    reviewIndexFree(&reviews);
+    if (scheduled <= 0 || expired != scheduled) return false;
+
+    printf("\nExtension: Move iopvu.java into src/ and then delete it, addressing the file by the IID a path index holds\n");
+    PathTrie paths;
+    if (!pathTrieLoad(&paths, dbManager, dbName)) {
+        pathTrieFree(&paths);
+        return false;
+    }
+    bool moved = updateFilePathIndexed(dbManager, dbName, &paths, "iopvu.java", "src/iopvu.java") == 1;
+    bool removed = moved && deleteFileIndexed(dbManager, dbName, &paths, "src/iopvu.java");
+    pathTrieFree(&paths);
+    if (!removed) return false;
+
+    printf("\nExtension: Retrieve Kevin Morrison's attributes twice, the second time by the IID cached from the first\n");
+    IidCache users;
+    iidCacheInit(&users);
+    int attributes = getUserAttributesCached(dbManager, dbName, &users, "Kevin Morrison");
+    bool cachedMatch = attributes > 0 && getUserAttributesCached(dbManager, dbName, &users, "Kevin Morrison") == attributes;
+    bool hit = atomic_load(&users.hits) == 1;
+    iidCacheFree(&users);
+    if (!cachedMatch || !hit) return false;
+
+    printf("\nExtension: Materialize the view permissions add-view-permission derives, then check that nothing is left to refresh\n");
+    if (refreshMaterializedPermissions(dbManager, dbName).failed != 0) return false;
+    if (refreshMaterializedPermissions(dbManager, dbName).failed != 0) return false;
+
+    return true;
+}
+#endif
+// end::extensions[]
+// tag::benchmarks[]
+#ifdef TUTORIAL_EXTENSIONS
+void benchmarks(DatabaseManager* dbManager, const char* dbName) {
+    printf("\nBenchmarks\n");
+    benchmarkPrefetch(dbManager, dbName, "match $u isa user; fetch $u: full-name, email;", 10);
+    benchmarkFetchDecoder(DECODER_BENCHMARK_ANSWERS);
+    benchmarkJsonIndex(JSON_INDEX_BENCHMARK_ANSWERS);
+    benchmarkJsonArena(DECODER_BENCHMARK_ANSWERS);
+    benchmarkGroupCommit(dbManager, dbName, 8, 200);
+    benchmarkPermissionIndex(dbManager, dbName, "Kevin Morrison", 1000000);
+    benchmarkAccessBitmaps(1000000, 64);
+    benchmarkDatalog(dbManager, dbName);
+    benchmarkViewMaintenance(dbManager, dbName, 1000);
+    benchmarkMembershipClosure(200000, 8);
+    benchmarkSegregationScan(1000000, 8, 8);
+    benchmarkReviewIndex(1000000, 10000);
+    benchmarkPathTrie(1000000);
+    benchmarkIidCache(dbManager, dbName, "Kevin Morrison", 1000);
+    benchmarkWorkflows(dbManager, dbName, "Kevin Morrison", 2000, 4);
+    printRetryStats();
+}
+#endif
+// end::benchmarks[]
 // tag::main[]
-int main() {
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--extensions") == 0) RUN_EXTENSIONS = true;
+        else if (strcmp(argv[i], "--benchmarks") == 0) RUN_BENCHMARKS = true;
+        else if (strcmp(argv[i], "--profile") == 0) PROFILE_QUERIES = true;
+    }
     bool result = EXIT_FAILURE;
     Connection* connection = NULL;
     DatabaseManager* databaseManager = NULL;
+    if (PROFILE_QUERIES) atexit(profileReport);
     connection = connectToTypeDB(TYPEDB_EDITION, SERVER_ADDR);
     if (!connection || FAILED()) {
         handle_error("Failed to connect to TypeDB.");
@@ -564,6 +811,13 @@ int main() {
         handle_error("Failed to query the database.");
         goto cleanup;
     }
+#ifdef TUTORIAL_EXTENSIONS
+    if (RUN_EXTENSIONS && !extensions(databaseManager, DB_NAME)) {
+        handle_error("Failed to run the extensions.");
+        goto cleanup;
+    }
+    if (RUN_BENCHMARKS) benchmarks(databaseManager, DB_NAME);
+#endif
     result = EXIT_SUCCESS;
 cleanup:
     database_manager_drop(databaseManager);